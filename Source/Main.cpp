@@ -7,13 +7,18 @@
 
   ==============================================================================
 */
-#define MIN_WIDTH 300
+// The spectrum analyzer (320) plus the narrowest the controls beside it can go (380)
+#define MIN_WIDTH 700
 #define MIN_HEIGHT 250
 #define MAX_WIDTH 10000
 #define MAX_HEIGHT 10000
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "sound_file_player.h"
+#include "batch_processor.h"
+#include "callback_benchmark.h"
+#include "headless_renderer.h"
+#include "loudness_analyzer.h"
 //==============================================================================
 class SoundFilePlayerApplication : public JUCEApplication
 {
@@ -25,6 +30,33 @@ public:
 	const String getApplicationVersion() override { return "1.0.0"; }
 
 	void initialise(const String&) override {
+		// Command-line modes run without a window or an audio device
+		auto args = getCommandLineParameterArray();
+
+		if (args.contains("--render")) {
+			setApplicationReturnValue(HeadlessRenderer::runFromCommandLine(args));
+			quit();
+			return;
+		}
+
+		if (args.contains("--batch")) {
+			setApplicationReturnValue(BatchProcessor::runFromCommandLine(args));
+			quit();
+			return;
+		}
+
+		if (args.contains("--benchmark")) {
+			setApplicationReturnValue(CallbackBenchmark::runFromCommandLine(args));
+			quit();
+			return;
+		}
+
+		if (args.contains("--loudness")) {
+			setApplicationReturnValue(LoudnessAnalyzer::runFromCommandLine(args));
+			quit();
+			return;
+		}
+
 		mainWindow.reset(new MainWindow("Sound File Player", new SoundFilePlayerComponent(), *this));
 	}
 
@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+  audio_thread_stats.cpp -- implementation of the audio thread's timing statistics
+
+  ==============================================================================
+*/
+
+#include "audio_thread_stats.h"
+
+namespace {
+	// Smoothing applied to the displayed load (per callback)
+	const float loadSmoothing = 0.05f;
+
+	// A callback this many block-lengths after the previous one means audio was dropped
+	const double missedDeadlineFactor = 1.9;
+
+	double ticksToMicros(int64 ticks) {
+		return Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+	}
+}
+
+//==============================================================================
+
+// Constructor
+AudioThreadStats::AudioThreadStats()
+	: sampleRate_(44100.0),
+	  numSamples_(0),
+	  callbackStartTicks_(0),
+	  previousStartTicks_(0),
+	  stageStartTicks_(0),
+	  smoothedLoad_(0.0f),
+	  resetRequested_(true)
+{
+	for (int stage = 0; stage < NumStages; stage++) {
+		lastMicros_[stage] = 0.0f;
+		worstMicros_[stage] = 0.0f;
+	}
+
+	loadPercent_ = 0.0f;
+	worstLoadPercent_ = 0.0f;
+	worstCallbackMicros_ = 0.0f;
+	numCallbacks_ = 0;
+	numOverruns_ = 0;
+	numMissedDeadlines_ = 0;
+}
+
+
+String AudioThreadStats::getStageName(Stage stage) {
+	switch (stage) {
+		case TransportPull:	return "Transport";
+		case Effects:		return "Effects";
+		case GainNoise:		return "Gain/noise";
+		case Mixer:			return "Layers";
+		default:			return {};
+	}
+}
+
+
+/*
+ * Sets the sample rate used to work out each block's deadline (call before the audio starts)
+ */
+void AudioThreadStats::prepare(double sampleRate) {
+	sampleRate_ = sampleRate > 0.0 ? sampleRate : 44100.0;
+	previousStartTicks_ = 0;
+}
+
+
+/*
+ * Audio thread: marks the start of a callback for a block of numSamples samples
+ */
+void AudioThreadStats::beginCallback(int numSamples) {
+	const int64 now = Time::getHighResolutionTicks();
+
+	// Resets are done here, so that only the audio thread ever writes the figures
+	if (resetRequested_.exchange(false)) {
+		for (int stage = 0; stage < NumStages; stage++)
+			worstMicros_[stage].store(0.0f, std::memory_order_relaxed);
+
+		worstLoadPercent_.store(0.0f, std::memory_order_relaxed);
+		worstCallbackMicros_.store(0.0f, std::memory_order_relaxed);
+		numCallbacks_.store(0, std::memory_order_relaxed);
+		numOverruns_.store(0, std::memory_order_relaxed);
+		numMissedDeadlines_.store(0, std::memory_order_relaxed);
+		previousStartTicks_ = 0;
+	}
+
+	// If this callback started much later than the last block's length, the device had
+	//   nothing to play for a while
+	if (previousStartTicks_ != 0 && numSamples_ > 0) {
+		double gapMicros = ticksToMicros(now - previousStartTicks_);
+		double blockMicros = 1.0e6 * numSamples_ / sampleRate_;
+
+		if (gapMicros > blockMicros * missedDeadlineFactor)
+			numMissedDeadlines_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	numSamples_ = numSamples;
+	previousStartTicks_ = now;
+	callbackStartTicks_ = now;
+	stageStartTicks_ = now;
+}
+
+
+/*
+ * Audio thread: marks the end of a stage (which started where the previous one ended)
+ */
+void AudioThreadStats::endStage(Stage stage) {
+	const int64 now = Time::getHighResolutionTicks();
+	const float micros = (float) ticksToMicros(now - stageStartTicks_);
+
+	lastMicros_[stage].store(micros, std::memory_order_relaxed);
+	storeMax(worstMicros_[stage], micros);
+	stageStartTicks_ = now;
+}
+
+
+/*
+ * Audio thread: marks the end of the callback and updates the load figures
+ */
+void AudioThreadStats::endCallback() {
+	const float micros = (float) ticksToMicros(Time::getHighResolutionTicks() - callbackStartTicks_);
+	const float deadlineMicros = (float) (1.0e6 * numSamples_ / sampleRate_);
+	const float load = deadlineMicros > 0.0f ? 100.0f * micros / deadlineMicros : 0.0f;
+
+	smoothedLoad_ += loadSmoothing * (load - smoothedLoad_);
+	loadPercent_.store(smoothedLoad_, std::memory_order_relaxed);
+	storeMax(worstLoadPercent_, load);
+	storeMax(worstCallbackMicros_, micros);
+
+	if (micros > deadlineMicros)
+		numOverruns_.fetch_add(1, std::memory_order_relaxed);
+
+	numCallbacks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*
+ * Reads the current figures (safe from any thread)
+ */
+AudioThreadStats::Snapshot AudioThreadStats::getSnapshot() const {
+	Snapshot snapshot;
+	snapshot.loadPercent = loadPercent_.load(std::memory_order_relaxed);
+	snapshot.worstLoadPercent = worstLoadPercent_.load(std::memory_order_relaxed);
+	snapshot.worstCallbackMicros = worstCallbackMicros_.load(std::memory_order_relaxed);
+	snapshot.numCallbacks = numCallbacks_.load(std::memory_order_relaxed);
+	snapshot.numOverruns = numOverruns_.load(std::memory_order_relaxed);
+	snapshot.numMissedDeadlines = numMissedDeadlines_.load(std::memory_order_relaxed);
+
+	for (int stage = 0; stage < NumStages; stage++) {
+		snapshot.lastMicros[stage] = lastMicros_[stage].load(std::memory_order_relaxed);
+		snapshot.worstMicros[stage] = worstMicros_[stage].load(std::memory_order_relaxed);
+	}
+
+	return snapshot;
+}
+
+
+/*
+ * Asks the audio thread to clear the worst-case figures and counters at its next callback
+ */
+void AudioThreadStats::reset() {
+	resetRequested_ = true;
+}
+
+
+/*
+ * Raises value to candidate if it's larger (only the audio thread writes, so no CAS loop)
+ */
+void AudioThreadStats::storeMax(std::atomic<float> &value, float candidate) {
+	if (candidate > value.load(std::memory_order_relaxed))
+		value.store(candidate, std::memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+  audio_thread_stats.h -- interface for the audio thread's timing statistics
+	- The audio thread timestamps each stage of the callback; the results are
+	  published as atomics, so the message thread can read them without locks
+	- Tracks callback load against the block's deadline, worst-case times,
+	  overruns and missed deadlines
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Lock-free timing statistics for the audio callback. Only the audio thread
+    writes the figures; other threads read snapshots of them.
+*/
+class AudioThreadStats
+{
+public:
+	// Stages of the callback, timed in this order
+	enum Stage {
+		TransportPull = 0,
+		Effects,
+		GainNoise,
+		Mixer,
+		NumStages
+	};
+
+	struct Snapshot
+	{
+		double loadPercent = 0.0;			// smoothed callback time as a % of the block's duration
+		double worstLoadPercent = 0.0;
+		double lastMicros[NumStages] = {};
+		double worstMicros[NumStages] = {};
+		double worstCallbackMicros = 0.0;
+		int64 numCallbacks = 0;
+		int64 numOverruns = 0;				// callbacks that took longer than their block lasts
+		int64 numMissedDeadlines = 0;		// gaps between callbacks long enough to have dropped audio
+	};
+
+	AudioThreadStats();
+
+	static String getStageName(Stage stage);
+
+	// Sets the rate used to turn block sizes into deadlines
+	void prepare(double sampleRate);
+
+	// Audio thread: mark the start of a callback, the end of each stage, and the end
+	void beginCallback(int numSamples);
+	void endStage(Stage stage);
+	void endCallback();
+
+	// Any thread: read the current figures / ask the audio thread to clear them
+	Snapshot getSnapshot() const;
+	void reset();
+
+private:
+	// Private helper functions
+	static void storeMax(std::atomic<float> &value, float candidate);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	// Audio thread only
+	double sampleRate_;
+	int numSamples_;
+	int64 callbackStartTicks_;
+	int64 previousStartTicks_;
+	int64 stageStartTicks_;
+	float smoothedLoad_;
+
+	// Published figures
+	std::atomic<float> loadPercent_;
+	std::atomic<float> worstLoadPercent_;
+	std::atomic<float> lastMicros_[NumStages];
+	std::atomic<float> worstMicros_[NumStages];
+	std::atomic<float> worstCallbackMicros_;
+	std::atomic<int64> numCallbacks_;
+	std::atomic<int64> numOverruns_;
+	std::atomic<int64> numMissedDeadlines_;
+	std::atomic<bool> resetRequested_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioThreadStats)
+};
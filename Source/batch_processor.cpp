@@ -0,0 +1,272 @@
+/*
+  ==============================================================================
+
+  batch_processor.cpp -- implementation of the player's batch processing mode
+
+  ==============================================================================
+*/
+
+#include "batch_processor.h"
+#include <atomic>
+#include <iostream>
+
+namespace {
+	// How often the waiting thread checks on the pool, and reports progress
+	const int pollIntervalMs = 10;
+	const int progressIntervalMs = 1000;
+
+	// Batch renders default to larger blocks than a sound card would use, since there's no
+	//   latency to keep down
+	const int defaultBlockSize = 4096;
+
+	// Options followed by a value (everything else after "--batch" that isn't an option is
+	//   an input, or the output directory)
+	const char *const valueOptions[] = { "--volume", "--noise", "--block-size", "--sample-rate", "--bits",
+	                                     "--quality", "--threads", "--wildcard" };
+
+	// Gives files that would render to the same output (song.flac & song.wav) outputs that
+	//   keep their own extension (song.flac.wav & song.wav.wav), and drops files listed twice
+	void keepExtensionsOfClashingOutputs(Array<BatchProcessor::Job> &jobs) {
+		HashMap<String, int> inputs, outputs;
+
+		for (int index = 0; index < jobs.size();) {
+			const String input = jobs.getReference(index).input.getFullPathName();
+
+			if (inputs.contains(input)) {
+				jobs.remove(index);
+				continue;
+			}
+
+			inputs.set(input, 1);
+			const String output = jobs.getReference(index++).output.getFullPathName();
+			outputs.set(output, outputs[output] + 1);
+		}
+
+		for (auto &job : jobs)
+			if (outputs[job.output.getFullPathName()] > 1)
+				job.output = job.output.getSiblingFile(job.input.getFileName() + ".wav");
+	}
+
+
+	//==============================================================================
+	/*
+	    Renders one file, writing the outcome to its own slot of the results.
+	*/
+	class RenderJob : public ThreadPoolJob
+	{
+	public:
+		RenderJob(const BatchProcessor::Job &job, const HeadlessRenderer::Settings &settings,
+		          HeadlessRenderer::Result &result, std::atomic<int> &numDone)
+			: ThreadPoolJob("Batch render"), job_(job), settings_(settings), result_(result), numDone_(numDone)
+		{
+		}
+
+		JobStatus runJob() override {
+			if (job_.output == job_.input) {
+				result_.errorMessage = job_.input.getFullPathName() + " would be overwritten by its output";
+			}
+			else if (!job_.output.getParentDirectory().createDirectory()) {
+				result_.errorMessage = "Couldn't create " + job_.output.getParentDirectory().getFullPathName();
+			}
+			else {
+				auto settings = settings_;
+				settings.input = job_.input;
+				settings.output = job_.output;
+				result_ = HeadlessRenderer::render(settings);
+			}
+
+			numDone_.fetch_add(1);
+			return jobHasFinished;
+		}
+
+	private:
+		const BatchProcessor::Job job_;
+		const HeadlessRenderer::Settings &settings_;
+		HeadlessRenderer::Result &result_;
+		std::atomic<int> &numDone_;
+	};
+}
+
+//==============================================================================
+
+/*
+ * Expands the inputs into a sorted list of files for each one. Files already under the output
+ *   directory (from an earlier run into a directory inside the input) are left out.
+ */
+Array<BatchProcessor::Job> BatchProcessor::findJobs(const StringArray &inputs, const File &outputDirectory, bool recursive,
+                                                    const String &wildcard, StringArray &unmatched) {
+	Array<Job> jobs;
+
+	for (auto &input : inputs) {
+		const File path = File::getCurrentWorkingDirectory().getChildFile(input.unquoted());
+
+		if (path.existsAsFile()) {
+			jobs.add({ path, outputDirectory.getChildFile(path.getFileNameWithoutExtension() + ".wav") });
+			continue;
+		}
+
+		const bool isDirectory = path.isDirectory();
+		const File root = isDirectory ? path : path.getParentDirectory();
+		const String pattern = isDirectory ? wildcard : path.getFileName();
+
+		Array<File> files;
+		if (isDirectory || pattern.containsAnyOf("*?"))
+			root.findChildFiles(files, File::findFiles, recursive, pattern);
+		files.sort();
+
+		int numMatched = 0;
+		for (auto &file : files) {
+			if (file.isAChildOf(outputDirectory))
+				continue;
+
+			jobs.add({ file, outputDirectory.getChildFile(file.getRelativePathFrom(root)).withFileExtension("wav") });
+			numMatched++;
+		}
+
+		if (numMatched == 0)
+			unmatched.add(input);
+	}
+
+	keepExtensionsOfClashingOutputs(jobs);
+	return jobs;
+}
+
+
+/*
+ * Queues one job per file on a pool with a thread per core (or settings.numThreads), then
+ *   waits for them all and adds up the results. Each render has its own engine, reader &
+ *   writer, so the jobs share nothing but the settings.
+ */
+BatchProcessor::Result BatchProcessor::process(const Array<Job> &jobs, const Settings &settings,
+                                               std::function<void(int numDone)> onProgress) {
+	Result result;
+	result.numFiles = jobs.size();
+
+	if (jobs.isEmpty())
+		return result;
+
+	Array<HeadlessRenderer::Result> renders;
+	renders.resize(jobs.size());
+	std::atomic<int> numDone(0);
+
+	const int numThreads = settings.numThreads > 0 ? settings.numThreads : SystemStats::getNumCpus();
+	const int64 startTicks = Time::getHighResolutionTicks();
+
+	{
+		ThreadPool pool(jlimit(1, jobs.size(), numThreads));
+
+		for (int index = 0; index < jobs.size(); index++)
+			pool.addJob(new RenderJob(jobs.getReference(index), settings.render, renders.getReference(index), numDone), true);
+
+		uint32 lastProgress = Time::getMillisecondCounter();
+		int lastDone = 0;
+
+		while (pool.getNumJobs() > 0) {
+			Thread::sleep(pollIntervalMs);
+
+			const int done = numDone.load();
+			if (onProgress != nullptr && done != lastDone
+			    && Time::getMillisecondCounter() - lastProgress >= (uint32) progressIntervalMs) {
+				onProgress(done);
+				lastProgress = Time::getMillisecondCounter();
+				lastDone = done;
+			}
+		}
+	}
+
+	result.wallSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+	for (int index = 0; index < renders.size(); index++) {
+		const auto &render = renders.getReference(index);
+
+		if (render.succeeded) {
+			result.numSamples += render.numSamples * render.numChannels;
+			result.audioSeconds += render.audioSeconds;
+		}
+		else {
+			result.numFailed++;
+			result.errors.add(render.errorMessage.isNotEmpty() ? render.errorMessage
+			                                                   : "Couldn't render " + jobs.getReference(index).input.getFullPathName());
+		}
+	}
+
+	return result;
+}
+
+
+/*
+ * Parses the batch options, renders every file found, and prints the failures and the
+ *   throughput to stdout
+ */
+int BatchProcessor::runFromCommandLine(const StringArray &args) {
+	int index = args.indexOf("--batch");
+	StringArray positional;
+
+	for (int i = index + 1; index >= 0 && i < args.size(); i++) {
+		if (!args[i].startsWith("--"))
+			positional.add(args[i]);
+		else
+			for (auto *option : valueOptions)
+				if (args[i] == option)
+					i++;
+	}
+
+	if (positional.size() < 2) {
+		std::cerr << getUsage() << std::endl;
+		return 1;
+	}
+
+	const File outputDirectory = File::getCurrentWorkingDirectory().getChildFile(positional[positional.size() - 1].unquoted());
+	positional.remove(positional.size() - 1);
+
+	if (!outputDirectory.createDirectory()) {
+		std::cerr << "Couldn't create " << outputDirectory.getFullPathName() << std::endl;
+		return 1;
+	}
+
+	AudioFormatManager formatManager;
+	formatManager.registerBasicFormats();
+
+	StringArray unmatched;
+	const auto jobs = findJobs(positional, outputDirectory, args.contains("--recursive"),
+		HeadlessRenderer::getOptionValue(args, "--wildcard", formatManager.getWildcardForAllFormats()), unmatched);
+
+	for (auto &input : unmatched)
+		std::cerr << "No audio files found for " << input << std::endl;
+
+	if (jobs.isEmpty())
+		return 1;
+
+	Settings settings;
+	settings.numThreads = HeadlessRenderer::getOptionValue(args, "--threads", "0").getIntValue();
+	settings.render = HeadlessRenderer::parseSettings(args, defaultBlockSize);
+
+	const int numFiles = jobs.size();
+	std::cout << "Rendering " << numFiles << " files to " << outputDirectory.getFullPathName() << std::endl;
+
+	auto result = process(jobs, settings, [numFiles](int numDone) {
+		std::cout << "  " << numDone << " / " << numFiles << " files" << std::endl;
+	});
+
+	for (auto &error : result.errors)
+		std::cerr << error << std::endl;
+
+	const int numThreads = jlimit(1, numFiles, settings.numThreads > 0 ? settings.numThreads : SystemStats::getNumCpus());
+	std::cout << "Rendered " << (result.numFiles - result.numFailed) << " of " << result.numFiles << " files ("
+	          << numThreads << " threads)" << std::endl
+	          << "  audio:      " << String(result.audioSeconds, 3) << " s (" << result.numSamples << " samples)" << std::endl
+	          << "  wall time:  " << String(result.wallSeconds, 3) << " s" << std::endl
+	          << "  realtime:   " << String(result.getRealtimeFactor(), 1) << "x" << std::endl
+	          << "  throughput: " << String(result.getFilesPerSecond(), 2) << " files/s, "
+	          << String(result.getSamplesPerSecond() / 1.0e6, 2) << " Msamples/s" << std::endl;
+
+	return result.numFailed > 0 ? 1 : 0;
+}
+
+
+String BatchProcessor::getUsage() {
+	return "Usage: SoundFilePlayer --batch <input dir | file | \"dir/*.wav\">... <output dir> [--recursive]\n"
+	       "                       [--wildcard \"*.wav;*.flac\"] [--threads n] [--volume 0-1] [--noise 0-1]\n"
+	       "                       [--block-size n] [--sample-rate hz] [--bits 16|24|32] [--mmap]\n"
+	       "                       [--quality linear|cubic|sinc16|sinc64]";
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+  batch_processor.h -- interface for the player's batch processing mode
+	- Runs every audio file in a directory (or matching a wildcard) through
+	  the player's processing chain and writes each one to a WAV file, keeping
+	  its path relative to the input directory
+	- Files are rendered concurrently on a thread pool with one thread per
+	  core; each one is streamed a block at a time (see headless_renderer.h),
+	  so memory use doesn't depend on how long the files are
+	- Reports throughput in files/s and samples/s
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "headless_renderer.h"
+#include <functional>
+
+//==============================================================================
+/*
+    Renders many files in parallel through HeadlessRenderer.
+*/
+class BatchProcessor
+{
+public:
+	// One file to render
+	struct Job
+	{
+		File input;
+		File output;
+	};
+
+	struct Settings
+	{
+		HeadlessRenderer::Settings render;	// the input & output are set for each file
+		int numThreads = 0;					// 0 = one per CPU core
+	};
+
+	struct Result
+	{
+		int numFiles = 0;
+		int numFailed = 0;
+		int64 numSamples = 0;		// across all channels
+		double audioSeconds = 0.0;
+		double wallSeconds = 0.0;
+		StringArray errors;			// one per failed file
+
+		double getFilesPerSecond() const { return wallSeconds > 0.0 ? (numFiles - numFailed) / wallSeconds : 0.0; }
+		double getSamplesPerSecond() const { return wallSeconds > 0.0 ? (double) numSamples / wallSeconds : 0.0; }
+		double getRealtimeFactor() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+	};
+
+	// Finds the files to render. Each input is a file, a directory (every file in it matching
+	//   the wildcard, searching subdirectories if recursive) or a path ending in a wildcard
+	//   such as "takes/*.wav". Outputs go under the output directory, with the same path
+	//   relative to the input's directory and a .wav extension (appended to the file's own
+	//   extension if two files would otherwise share an output, e.g. song.flac & song.wav).
+	//   Files found more than once are rendered once. Inputs that match nothing are added to
+	//   unmatched.
+	static Array<Job> findJobs(const StringArray &inputs, const File &outputDirectory, bool recursive,
+	                           const String &wildcard, StringArray &unmatched);
+
+	// Renders the jobs on a thread pool, calling onProgress on this thread (at most once a
+	//   second) with the number of files finished so far
+	static Result process(const Array<Job> &jobs, const Settings &settings,
+	                      std::function<void(int numDone)> onProgress = nullptr);
+
+	// Command-line entry point ("--batch <inputs...> <output dir> [options]"); returns the
+	//   process exit code (1 if any file failed)
+	static int runFromCommandLine(const StringArray &args);
+	static String getUsage();
+};
@@ -0,0 +1,288 @@
+/*
+  ==============================================================================
+
+  block_cache_reader.cpp -- implementation of the decoded-PCM block cache
+
+  ==============================================================================
+*/
+
+#include "block_cache_reader.h"
+
+namespace {
+	// How long the prefetch thread waits before checking for work again when idle
+	const int idlePrefetchIntervalMs = 50;
+}
+
+//==============================================================================
+
+// Constructor
+BlockCacheReader::BlockCacheReader(AudioFormatReader *sourceReader, TimeSliceThread &prefetchThread,
+                                   size_t memoryBudgetBytes, int samplesPerBlock, int numPrefetchBlocks)
+	: AudioFormatReader(nullptr, sourceReader->getFormatName()),
+	  source_(sourceReader),
+	  prefetchThread_(prefetchThread),
+	  samplesPerBlock_(jmax(1024, samplesPerBlock)),
+	  numPrefetchBlocks_(jmax(0, numPrefetchBlocks)),
+	  budgetBytes_(memoryBudgetBytes),
+	  bytesPerBlock_(sizeof(float) * (size_t) jmax(1, (int) sourceReader->numChannels) * (size_t) jmax(1024, samplesPerBlock))
+{
+	// Cached data is float, whatever the file's format is
+	sampleRate = source_->sampleRate;
+	bitsPerSample = 32;
+	lengthInSamples = source_->lengthInSamples;
+	numChannels = source_->numChannels;
+	usesFloatingPointData = true;
+	metadataValues = source_->metadataValues;
+
+	stats_.budgetBytes = budgetBytes_;
+	prefetchThread_.addTimeSliceClient(this);
+}
+
+
+// Destructor
+BlockCacheReader::~BlockCacheReader()
+{
+	prefetchThread_.removeTimeSliceClient(this);
+}
+
+
+/*
+ * Copies the requested range out of cached blocks, decoding any block that isn't cached
+ *   yet, then queues the following blocks (and the previous one, for backward scrubbing)
+ */
+bool BlockCacheReader::readSamples(int **destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                   int64 startSampleInFile, int numSamples) {
+	clearSamplesBeyondAvailableLength(destSamples, numDestChannels, startOffsetInDestBuffer,
+	                                  startSampleInFile, numSamples, lengthInSamples);
+
+	int64 lastBlockRead = -1;
+
+	while (numSamples > 0) {
+		const int64 blockIndex = startSampleInFile / samplesPerBlock_;
+		const int offsetInBlock = (int) (startSampleInFile - blockIndex * samplesPerBlock_);
+		const int numThisBlock = jmin(numSamples, samplesPerBlock_ - offsetInBlock);
+
+		if (!copyFromCache(blockIndex, destSamples, numDestChannels, startOffsetInDestBuffer, offsetInBlock, numThisBlock, true)) {
+			Block block;
+			decodeBlock(blockIndex, block);
+			insertBlock(std::move(block));
+
+			if (!copyFromCache(blockIndex, destSamples, numDestChannels, startOffsetInDestBuffer, offsetInBlock, numThisBlock, false))
+				return false;
+		}
+
+		lastBlockRead = blockIndex;
+		startSampleInFile += numThisBlock;
+		startOffsetInDestBuffer += numThisBlock;
+		numSamples -= numThisBlock;
+	}
+
+	if (lastBlockRead >= 0) {
+		for (int i = 1; i <= numPrefetchBlocks_; i++)
+			queuePrefetch(lastBlockRead + i);
+		queuePrefetch(lastBlockRead - 1);
+	}
+
+	return true;
+}
+
+
+/*
+ * Queues the block containing position and its neighbours, nearest first
+ */
+void BlockCacheReader::prefetchAround(int64 position) {
+	const int64 blockIndex = position / samplesPerBlock_;
+	queuePrefetch(blockIndex);
+
+	for (int i = 1; i <= numPrefetchBlocks_; i++)
+		queuePrefetch(blockIndex + i);
+	queuePrefetch(blockIndex - 1);
+}
+
+
+/*
+ * Copies from cached blocks without decoding, allocating or waiting. Returns false (leaving
+ *   the destination partly written) if the cache is busy or any block is missing.
+ */
+bool BlockCacheReader::tryReadCached(float *const *destChannels, int numDestChannels,
+                                     int64 startSampleInFile, int numSamples) {
+	const ScopedTryLock sl(cacheLock_);
+
+	if (!sl.isLocked() || startSampleInFile < 0)
+		return false;
+
+	int destOffset = 0;
+
+	while (numSamples > 0) {
+		const int64 blockIndex = startSampleInFile / samplesPerBlock_;
+		const int offsetInBlock = (int) (startSampleInFile - blockIndex * samplesPerBlock_);
+		const int numThisBlock = jmin(numSamples, samplesPerBlock_ - offsetInBlock);
+		auto found = blockIndex_.find(blockIndex);
+
+		if (found == blockIndex_.end())
+			return false;
+
+		blocks_.splice(blocks_.begin(), blocks_, found->second);
+		const Block &block = *found->second;
+		const int numValid = jlimit(0, numThisBlock, block.numValidSamples - offsetInBlock);
+
+		for (int channel = 0; channel < numDestChannels; channel++) {
+			auto *dest = destChannels[channel] + destOffset;
+			const int sourceChannel = jmin(channel, block.samples.getNumChannels() - 1);
+
+			if (numValid > 0)
+				FloatVectorOperations::copy(dest, block.samples.getReadPointer(sourceChannel, offsetInBlock), numValid);
+			if (numValid < numThisBlock)
+				FloatVectorOperations::clear(dest + numValid, numThisBlock - numValid);
+		}
+
+		startSampleInFile += numThisBlock;
+		destOffset += numThisBlock;
+		numSamples -= numThisBlock;
+	}
+
+	return true;
+}
+
+
+BlockCacheReader::Stats BlockCacheReader::getStats() const {
+	const ScopedLock sl(cacheLock_);
+	return stats_;
+}
+
+
+/*
+ * Clears the hit/miss counters (the cached blocks are kept)
+ */
+void BlockCacheReader::resetStats() {
+	const ScopedLock sl(cacheLock_);
+	stats_.hits = stats_.misses = stats_.prefetches = stats_.evictions = 0;
+}
+
+
+/*
+ * Prefetch thread: decodes one queued block per slice
+ */
+int BlockCacheReader::useTimeSlice() {
+	int64 blockIndex = -1;
+
+	{
+		const ScopedLock sl(cacheLock_);
+		while (!prefetchQueue_.isEmpty() && blockIndex < 0) {
+			const int64 candidate = prefetchQueue_.removeAndReturn(0);
+			if (!isCached(candidate))
+				blockIndex = candidate;
+		}
+	}
+
+	if (blockIndex < 0)
+		return idlePrefetchIntervalMs;
+
+	Block block;
+	decodeBlock(blockIndex, block);
+	insertBlock(std::move(block));
+
+	const ScopedLock sl(cacheLock_);
+	stats_.prefetches++;
+	return 0;
+}
+
+
+/*
+ * Copies part of a cached block into the destination (as floats) and marks the block as
+ *   most recently used. Returns false if the block isn't cached; the hit or miss is only
+ *   counted if countAccess is set (so a miss isn't counted again once it's been decoded).
+ */
+bool BlockCacheReader::copyFromCache(int64 blockIndex, int **destSamples, int numDestChannels, int destOffset,
+                                     int offsetInBlock, int numSamples, bool countAccess) {
+	const ScopedLock sl(cacheLock_);
+	auto found = blockIndex_.find(blockIndex);
+
+	if (found == blockIndex_.end()) {
+		if (countAccess)
+			stats_.misses++;
+		return false;
+	}
+
+	blocks_.splice(blocks_.begin(), blocks_, found->second);
+	const Block &block = *found->second;
+	const int numValid = jlimit(0, numSamples, block.numValidSamples - offsetInBlock);
+
+	for (int channel = 0; channel < numDestChannels; channel++) {
+		if (destSamples[channel] == nullptr)
+			continue;
+
+		auto *dest = reinterpret_cast<float *>(destSamples[channel]) + destOffset;
+
+		if (channel < block.samples.getNumChannels() && numValid > 0)
+			FloatVectorOperations::copy(dest, block.samples.getReadPointer(channel, offsetInBlock), numValid);
+
+		if (numValid < numSamples)
+			FloatVectorOperations::clear(dest + jmax(0, numValid), numSamples - jmax(0, numValid));
+	}
+
+	if (countAccess)
+		stats_.hits++;
+	return true;
+}
+
+
+/*
+ * Decodes a whole block from the source reader
+ */
+void BlockCacheReader::decodeBlock(int64 blockIndex, Block &block) {
+	const int64 start = blockIndex * samplesPerBlock_;
+
+	block.index = blockIndex;
+	block.numValidSamples = (int) jlimit((int64) 0, (int64) samplesPerBlock_, lengthInSamples - start);
+	block.samples.setSize(jmax(1, (int) numChannels), samplesPerBlock_, false, true, false);
+
+	const ScopedLock sl(sourceLock_);
+	source_->read(&block.samples, 0, samplesPerBlock_, start, true, true);
+}
+
+
+/*
+ * Adds a decoded block at the front of the LRU list, evicting from the back to stay
+ *   within the memory budget (the newest block is always kept)
+ */
+void BlockCacheReader::insertBlock(Block &&block) {
+	const ScopedLock sl(cacheLock_);
+
+	if (isCached(block.index))
+		return;
+
+	while (!blocks_.empty() && (blocks_.size() + 1) * bytesPerBlock_ > budgetBytes_) {
+		blockIndex_.erase(blocks_.back().index);
+		blocks_.pop_back();
+		stats_.evictions++;
+	}
+
+	blocks_.push_front(std::move(block));
+	blockIndex_[blocks_.front().index] = blocks_.begin();
+
+	stats_.numBlocks = (int) blocks_.size();
+	stats_.bytesUsed = blocks_.size() * bytesPerBlock_;
+}
+
+
+/*
+ * Adds a block to the prefetch queue if it's in the file and not already cached or queued
+ */
+void BlockCacheReader::queuePrefetch(int64 blockIndex) {
+	if (blockIndex < 0 || blockIndex * samplesPerBlock_ >= lengthInSamples)
+		return;
+
+	const ScopedLock sl(cacheLock_);
+
+	if (!isCached(blockIndex) && !prefetchQueue_.contains(blockIndex))
+		prefetchQueue_.add(blockIndex);
+}
+
+
+/*
+ * True if the block is in the cache (call with cacheLock_ held)
+ */
+bool BlockCacheReader::isCached(int64 blockIndex) const {
+	return blockIndex_.find(blockIndex) != blockIndex_.end();
+}
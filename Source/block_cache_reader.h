@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+  block_cache_reader.h -- interface for the decoded-PCM block cache
+	- An AudioFormatReader that sits between a file's reader and the rest of
+	  the chain, keeping recently decoded blocks as float PCM
+	- Blocks are evicted least-recently-used to stay within a memory budget,
+	  and the neighbours of each block read are prefetched in the background
+	- Seeking back to anywhere that's cached needs no disk access or decoding
+	- Cached ranges can also be read without blocking, for scrubbing
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "scrub_processor.h"
+#include <list>
+#include <unordered_map>
+
+//==============================================================================
+/*
+    Caching wrapper around another AudioFormatReader. Reads of cached blocks are
+    copies; misses decode a whole block from the source reader.
+*/
+class BlockCacheReader : public AudioFormatReader,
+                         public ScrubProcessor::Source,
+                         private TimeSliceClient
+{
+public:
+	struct Stats
+	{
+		int64 hits = 0;
+		int64 misses = 0;
+		int64 prefetches = 0;
+		int64 evictions = 0;
+		int numBlocks = 0;
+		size_t bytesUsed = 0;
+		size_t budgetBytes = 0;
+
+		double getHitRate() const { return hits + misses > 0 ? (double) hits / (double) (hits + misses) : 0.0; }
+	};
+
+	// Takes ownership of sourceReader. Prefetching runs on the given thread.
+	BlockCacheReader(AudioFormatReader *sourceReader, TimeSliceThread &prefetchThread,
+	                 size_t memoryBudgetBytes, int samplesPerBlock = 32768, int numPrefetchBlocks = 2);
+	~BlockCacheReader();
+
+	// Redefinition of AudioFormatReader method
+	bool readSamples(int **destSamples, int numDestChannels, int startOffsetInDestBuffer,
+	                 int64 startSampleInFile, int numSamples) override;
+
+	// Queues the blocks around a position for decoding (e.g. just before a seek)
+	void prefetchAround(int64 position);
+
+	// Redefinition of ScrubProcessor::Source method (succeeds only if every block the range
+	//   covers is already cached)
+	bool tryReadCached(float *const *destChannels, int numDestChannels, int64 startSampleInFile,
+	                   int numSamples) override;
+
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	struct Block
+	{
+		int64 index;
+		AudioBuffer<float> samples;
+		int numValidSamples;
+	};
+
+	typedef std::list<Block> BlockList;
+
+	// Private helper functions
+	int useTimeSlice() override;
+	bool copyFromCache(int64 blockIndex, int **destSamples, int numDestChannels, int destOffset,
+	                   int offsetInBlock, int numSamples, bool countAccess);
+	void decodeBlock(int64 blockIndex, Block &block);
+	void insertBlock(Block &&block);
+	void queuePrefetch(int64 blockIndex);
+	bool isCached(int64 blockIndex) const;
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	std::unique_ptr<AudioFormatReader> source_;
+	TimeSliceThread &prefetchThread_;
+	const int samplesPerBlock_;
+	const int numPrefetchBlocks_;
+	const size_t budgetBytes_;
+	const size_t bytesPerBlock_;
+
+	// The source reader isn't thread-safe, so decoding is serialised
+	CriticalSection sourceLock_;
+
+	// Cached blocks, most recently used at the front, plus an index into the list
+	CriticalSection cacheLock_;
+	BlockList blocks_;
+	std::unordered_map<int64, BlockList::iterator> blockIndex_;
+	Array<int64> prefetchQueue_;
+	Stats stats_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockCacheReader)
+};
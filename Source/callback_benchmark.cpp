@@ -0,0 +1,593 @@
+/*
+  ==============================================================================
+
+  callback_benchmark.cpp -- implementation of the audio callback micro-benchmarks
+
+  ==============================================================================
+*/
+
+#include "callback_benchmark.h"
+#include "compact_sample_store.h"
+#include "gain_noise_processor.h"
+#include "internal_effects.h"
+#include "playback_engine.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+//==============================================================================
+// Allocation counting
+
+namespace {
+	std::atomic<int64> allocationCount { 0 };
+}
+
+#if SFP_BENCHMARK_COUNT_ALLOCATIONS
+
+ // JUCE's buffers allocate with malloc directly, so on glibc malloc itself is replaced and
+ //   does the counting; elsewhere only operator new is counted
+ #if JUCE_LINUX && defined (__GLIBC__)
+  #define SFP_COUNT_IN_MALLOC 1
+
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t num, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+
+	void *malloc(size_t size) noexcept {
+		allocationCount++;
+		return __libc_malloc(size);
+	}
+
+	void *calloc(size_t num, size_t size) noexcept {
+		allocationCount++;
+		return __libc_calloc(num, size);
+	}
+
+	void *realloc(void *ptr, size_t size) noexcept {
+		allocationCount++;
+		return __libc_realloc(ptr, size);
+	}
+}
+ #else
+  #define SFP_COUNT_IN_MALLOC 0
+ #endif
+
+namespace {
+	void *countedAllocate(std::size_t size) noexcept {
+	#if ! SFP_COUNT_IN_MALLOC
+		allocationCount++;
+	#endif
+		return std::malloc(size != 0 ? size : 1);
+	}
+}
+
+void *operator new(std::size_t size) {
+	if (void *ptr = countedAllocate(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+	if (void *ptr = countedAllocate(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return countedAllocate(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return countedAllocate(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+
+#endif
+
+namespace {
+	// Builds an in-memory 24-bit WAV of a few sine tones plus a little noise, and opens it
+	//   the same way a file would be opened (so the benchmark includes PCM decoding)
+	std::unique_ptr<LoadedFile> createSyntheticFile(MemoryBlock &wavData, int numChannels, double sampleRate) {
+		const int numSamples = (int) sampleRate * 2;
+		AudioBuffer<float> audio(numChannels, numSamples);
+		Random random(1234);
+
+		for (int channel = 0; channel < numChannels; channel++) {
+			auto *data = audio.getWritePointer(channel);
+			const double frequency = 110.0 * (channel + 1);
+
+			for (int sample = 0; sample < numSamples; sample++)
+				data[sample] = 0.5f * (float) std::sin(MathConstants<double>::twoPi * frequency * sample / sampleRate)
+				             + 0.05f * (random.nextFloat() - 0.5f);
+		}
+
+		wavData.reset();
+		{
+			WavAudioFormat wav;
+			std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(new MemoryOutputStream(wavData, false),
+				sampleRate, (unsigned int) numChannels, 24, {}, 0));
+			writer->writeFromAudioSampleBuffer(audio, 0, numSamples);
+		}
+
+		auto *reader = WavAudioFormat().createReaderFor(new MemoryInputStream(wavData, false), true);
+		if (reader == nullptr)
+			return nullptr;
+
+		std::unique_ptr<LoadedFile> loaded(new LoadedFile());
+		loaded->sampleRate = reader->sampleRate;
+		loaded->numChannels = (int) reader->numChannels;
+		loaded->lengthInSamples = reader->lengthInSamples;
+		loaded->readerSource.reset(new AudioFormatReaderSource(reader, true));
+		return loaded;
+	}
+
+	// Lets the CSV go to stdout through the same OutputStream interface as a file
+	class StdOutStream : public OutputStream
+	{
+	public:
+		void flush() override { std::cout.flush(); }
+		bool setPosition(int64) override { return false; }
+		int64 getPosition() override { return position_; }
+
+		bool write(const void *data, size_t numBytes) override {
+			std::cout.write((const char *) data, (std::streamsize) numBytes);
+			position_ += (int64) numBytes;
+			return true;
+		}
+
+	private:
+		int64 position_ = 0;
+	};
+
+	double getPercentile(const Array<double> &sortedValues, double percentile) {
+		if (sortedValues.isEmpty())
+			return 0.0;
+
+		int index = jlimit(0, sortedValues.size() - 1, (int) std::ceil(percentile * sortedValues.size()) - 1);
+		return sortedValues[index];
+	}
+
+	// Volume/noise check: channels processed, and the scratch size the processors are prepared
+	//   with (not a multiple of the noise generator's lanes, so larger blocks are processed in
+	//   pieces that leave lanes part-way through)
+	const int gainNoiseChannels = 8;
+	const int gainNoiseScratchSize = 100;
+
+	// Largest difference allowed between the two volume/noise implementations (about -100 dB;
+	//   they only differ in the order of the multiplications)
+	const float gainNoiseTolerance = 1.0e-5f;
+
+	Array<int> parseIntList(const String &text, int minimum = 1) {
+		Array<int> values;
+		for (auto &token : StringArray::fromTokens(text, ",", {}))
+			if (token.trim().isNotEmpty() && token.getIntValue() >= minimum)
+				values.add(token.getIntValue());
+		return values;
+	}
+}
+
+//==============================================================================
+
+String CallbackBenchmark::getCsvHeader() {
+	return "block_size,channels,voices,workers,branches,setting,callbacks,ns_per_sample,mean_us,p50_us,p99_us,max_us,"
+	       "load_percent,allocs_per_callback,max_allocs,worker_percent";
+}
+
+
+String CallbackBenchmark::Measurement::toCsvRow() const {
+	return String(blockSize) + "," + String(numChannels) + "," + String(numVoices) + "," + String(numWorkers) + ","
+		+ String(numBranches) + "," + settingName + "," + String(numCallbacks) + ","
+		+ String(nsPerSample, 3) + "," + String(meanMicros, 3) + "," + String(p50Micros, 3) + ","
+		+ String(p99Micros, 3) + "," + String(maxMicros, 3) + "," + String(loadPercent, 3) + ","
+	#if SFP_BENCHMARK_COUNT_ALLOCATIONS
+		+ String(allocationsPerCallback, 3) + "," + String(maxAllocations)
+	#else
+		+ ","
+	#endif
+		+ "," + String(workerPercent, 1);
+}
+
+
+/*
+ * The volume/noise settings swept by default
+ */
+Array<CallbackBenchmark::ParameterSetting> CallbackBenchmark::getDefaultParameterSettings() {
+	Array<ParameterSetting> settings;
+	settings.add({ "unity", 1.0f, 0.0f, false });
+	settings.add({ "volume", 0.7f, 0.0f, false });
+	settings.add({ "volume_noise", 0.7f, 0.3f, false });
+	settings.add({ "ramping", 0.7f, 0.3f, true });
+	return settings;
+}
+
+
+/*
+ * Times secondsPerRun worth of callbacks for one block size / channel count / setting, with
+ *   numVoices layers mixed in, numWorkers callback workers and numBranches effect branches.
+ *   The first second of callbacks is discarded as a warm-up.
+ */
+CallbackBenchmark::Measurement CallbackBenchmark::measure(const Settings &settings, int blockSize, int numChannels,
+                                                          const ParameterSetting &setting, int numVoices, int numWorkers,
+                                                          int numBranches) {
+	Measurement result;
+	result.blockSize = blockSize;
+	result.numVoices = numVoices;
+	result.numWorkers = numWorkers;
+	result.numBranches = numBranches;
+	result.settingName = setting.name;
+
+	MemoryBlock wavData;
+	std::unique_ptr<LoadedFile> loaded;
+
+	if (settings.input != File()) {
+		AudioFormatManager formatManager;
+		formatManager.registerBasicFormats();
+		loaded = FileLoader::openFile(formatManager, settings.input, LoadOptions());
+	}
+	else {
+		loaded = createSyntheticFile(wavData, numChannels, settings.sampleRate);
+	}
+
+	if (loaded == nullptr)
+		return result;
+
+	const double sampleRate = loaded->sampleRate;
+	numChannels = loaded->numChannels;
+	result.numChannels = numChannels;
+
+	PlaybackEngine engine;
+	engine.getWorkers().setNumWorkers(numWorkers);
+	auto &parameters = engine.getParameters();
+	parameters.setValue(PlayerParameters::Volume, setting.volume);
+	parameters.setValue(PlayerParameters::Noise, setting.noise);
+	engine.prepareToPlay(blockSize, sampleRate);
+	engine.setFile(std::move(loaded));
+	engine.setLooping(true);
+
+	// Every branch runs the same chain of built-in effects
+	for (int branch = 0; branch < numBranches; branch++) {
+		const int index = engine.getEffects().addBranch();
+		String error;
+
+		for (int type = 0; type < InternalEffect::NumTypes; type++)
+			engine.getEffects().addEffect(index, InternalEffect::create((InternalEffect::Type) type), error);
+	}
+
+	// Layers have no read-ahead buffers here (the benchmark runs faster than real time, so
+	//   they'd only underrun), so their decoding is included in the callback time
+	OwnedArray<MemoryBlock> voiceData;
+
+	for (int voice = 0; voice < numVoices; voice++) {
+		auto *data = voiceData.add(new MemoryBlock());
+		if (engine.getMixer().addVoice(createSyntheticFile(*data, 2, sampleRate)))
+			engine.getMixer().getVoice(engine.getMixer().getNumVoices() - 1)->setLooping(true);
+	}
+
+	engine.start();
+
+	AudioBuffer<float> buffer(numChannels, blockSize);
+	const int numWarmUp = jmax(1, (int) (sampleRate / blockSize));
+	const int numCallbacks = jmax(100, (int) (settings.secondsPerRun * sampleRate / blockSize));
+
+	Array<double> times;
+	times.ensureStorageAllocated(numCallbacks);
+	int64 totalAllocations = 0;
+
+	for (int callback = -numWarmUp; callback < numCallbacks; callback++) {
+		if (setting.ramping)
+			parameters.setValue(PlayerParameters::Volume, (callback & 1) ? setting.volume : setting.volume * 0.5f);
+
+		AudioSourceChannelInfo info(&buffer, 0, blockSize);
+		const int64 allocationsBefore = allocationCount.load();
+		const int64 startTicks = Time::getHighResolutionTicks();
+
+		engine.getNextAudioBlock(info);
+
+		const int64 endTicks = Time::getHighResolutionTicks();
+		const int64 allocations = allocationCount.load() - allocationsBefore;
+
+		if (callback >= 0) {
+			times.add(Time::highResolutionTicksToSeconds(endTicks - startTicks) * 1.0e6);
+			totalAllocations += allocations;
+			result.maxAllocations = jmax(result.maxAllocations, allocations);
+		}
+	}
+
+	engine.stop();
+	engine.releaseResources();
+
+	// Summarise the timings
+	double totalMicros = 0.0;
+	for (auto time : times)
+		totalMicros += time;
+
+	times.sort();
+	result.numCallbacks = times.size();
+	result.meanMicros = totalMicros / times.size();
+	result.p50Micros = getPercentile(times, 0.50);
+	result.p99Micros = getPercentile(times, 0.99);
+	result.maxMicros = times.getLast();
+	result.nsPerSample = result.meanMicros * 1000.0 / ((double) blockSize * numChannels);
+	result.loadPercent = 100.0 * result.meanMicros / (1.0e6 * blockSize / sampleRate);
+	result.allocationsPerCallback = (double) totalAllocations / times.size();
+	result.workerPercent = 100.0 * engine.getWorkers().getWorkerShare();
+	return result;
+}
+
+
+/*
+ * Measures every combination of block size, channel count, layer count, worker count,
+ *   branch count and setting, writing one CSV row per combination as it goes
+ */
+void CallbackBenchmark::runSweep(const Settings &settings, OutputStream &csvOutput) {
+	csvOutput << getCsvHeader() << "\n";
+
+	// A file has a fixed channel count, so only the synthetic source sweeps channels
+	Array<int> channelCounts = settings.channelCounts;
+	if (settings.input != File()) {
+		channelCounts.clearQuick();
+		channelCounts.add(0);
+	}
+
+	for (auto numVoices : settings.voiceCounts)
+		for (auto numChannels : channelCounts)
+			for (auto numWorkers : settings.workerCounts)
+				for (auto numBranches : settings.branchCounts)
+					for (auto blockSize : settings.blockSizes)
+						for (auto &setting : settings.parameterSettings) {
+							auto measurement = measure(settings, blockSize, numChannels, setting, numVoices, numWorkers,
+								numBranches);
+							csvOutput << measurement.toCsvRow() << "\n";
+							csvOutput.flush();
+						}
+}
+
+
+/*
+ * Writes every value a 16-bit sample (and, in batches, a 24-bit sample) can take through the
+ *   store and compares the floats read back with those JUCE's readers produce for the same
+ *   left-justified 32-bit input, bit for bit. Then times reading a 1M-sample channel in each
+ *   format, with a plain float copy as the baseline.
+ */
+bool CallbackBenchmark::runSampleStoreBenchmark(double secondsPerFormat, OutputStream &csvOutput) {
+	const int batchSize = 1 << 16;
+	const int timedSamples = 1 << 20;
+	const CompactSampleStore::Format formats[] = { CompactSampleStore::Float32, CompactSampleStore::Int16,
+	                                               CompactSampleStore::Int24 };
+
+	HeapBlock<int> input(batchSize);
+	HeapBlock<float> expected(batchSize), actual(batchSize);
+	bool allExact = true;
+
+	csvOutput << "format,bytes_per_sample,values_checked,mismatches,ns_per_sample,mb_per_second\n";
+
+	for (auto format : formats) {
+		CompactSampleStore store;
+		int64 numChecked = 0, numMismatches = 0;
+
+		// Exactness: the full range of the format, one batch at a time (floats get a sweep of
+		//   the bit patterns of ordinary values)
+		const int numBits = format == CompactSampleStore::Int16 ? 16 : 24;
+		const int64 numValues = (int64) 1 << numBits;
+		store.allocate(format, 1, batchSize);
+
+		for (int64 first = 0; first < numValues; first += batchSize) {
+			const int num = (int) jmin((int64) batchSize, numValues - first);
+
+			for (int i = 0; i < num; i++) {
+				if (format == CompactSampleStore::Float32) {
+					const float value = (float) ((first + i) - numValues / 2) / (float) (numValues / 2);
+					memcpy(input + i, &value, sizeof(float));
+				}
+				else {
+					input[i] = (int) ((uint32) (first + i) << (32 - numBits));
+				}
+			}
+
+			if (format == CompactSampleStore::Float32)
+				memcpy(expected, input, sizeof(float) * (size_t) num);
+			else
+				FloatVectorOperations::convertFixedToFloat(expected, input, 1.0f / (float) 0x7fffffff, num);
+
+			store.write(0, 0, input, num);
+			store.read(0, 0, actual, num);
+
+			for (int i = 0; i < num; i++)
+				if (memcmp(expected + i, actual + i, sizeof(float)) != 0)
+					numMismatches++;
+
+			numChecked += num;
+		}
+
+		// Cost: repeatedly read a channel too large for the caches
+		store.allocate(format, 1, timedSamples);
+		HeapBlock<float> output(timedSamples);
+		int64 numConverted = 0;
+		const int64 startTicks = Time::getHighResolutionTicks();
+		int64 elapsedTicks = 0;
+
+		do {
+			store.read(0, 0, output, timedSamples);
+			numConverted += timedSamples;
+			elapsedTicks = Time::getHighResolutionTicks() - startTicks;
+		} while (Time::highResolutionTicksToSeconds(elapsedTicks) < secondsPerFormat);
+
+		const double seconds = Time::highResolutionTicksToSeconds(elapsedTicks);
+		csvOutput << CompactSampleStore::getFormatName(format) << "," << CompactSampleStore::getBytesPerSample(format) << ","
+			<< numChecked << "," << numMismatches << "," << String(1.0e9 * seconds / numConverted, 3) << ","
+			<< String(numConverted * CompactSampleStore::getBytesPerSample(format) / (seconds * 1024.0 * 1024.0), 1) << "\n";
+		csvOutput.flush();
+
+		allExact = allExact && numMismatches == 0;
+	}
+
+	return allExact;
+}
+
+
+/*
+ * Processes secondsPerRun of random audio a block at a time with two processors seeded alike,
+ *   one through the scalar implementation and one through the vectorized one, and compares
+ *   the outputs sample by sample. The ramping setting alternates the volume every block and
+ *   ramps the noise in over the first, so both parameters ramp.
+ */
+bool CallbackBenchmark::runGainNoiseCheck(const Settings &settings, OutputStream &csvOutput) {
+	bool allMatch = true;
+
+	csvOutput << "setting,block_size,channels,samples_checked,max_difference,scalar_ns_per_sample,"
+	             "vectorized_ns_per_sample,speedup\n";
+
+	for (auto blockSize : settings.blockSizes) {
+		for (auto &setting : settings.parameterSettings) {
+			GainNoiseProcessor scalar, vectorized;
+			scalar.prepare(gainNoiseScratchSize);
+			vectorized.prepare(gainNoiseScratchSize);
+
+			AudioBuffer<float> scalarBuffer(gainNoiseChannels, blockSize), vectorizedBuffer(gainNoiseChannels, blockSize);
+			Random random(1234);
+
+			const int numBlocks = jmax(10, (int) (settings.secondsPerRun * settings.sampleRate / blockSize));
+			int64 scalarTicks = 0, vectorizedTicks = 0;
+			float maxDifference = 0.0f;
+
+			for (int block = 0; block < numBlocks; block++) {
+				PlayerParameters::Ramp volume = { setting.volume, setting.volume };
+				PlayerParameters::Ramp noise = { setting.noise, setting.noise };
+
+				if (setting.ramping) {
+					volume.start = (block & 1) ? setting.volume * 0.5f : setting.volume;
+					volume.end = (block & 1) ? setting.volume : setting.volume * 0.5f;
+					noise.start = block == 0 ? 0.0f : setting.noise;
+				}
+
+				for (int channel = 0; channel < gainNoiseChannels; channel++) {
+					auto *data = scalarBuffer.getWritePointer(channel);
+					for (int sample = 0; sample < blockSize; sample++)
+						data[sample] = random.nextFloat() * 2.0f - 1.0f;
+
+					vectorizedBuffer.copyFrom(channel, 0, scalarBuffer, channel, 0, blockSize);
+				}
+
+				int64 startTicks = Time::getHighResolutionTicks();
+				scalar.processScalar(scalarBuffer, 0, blockSize, volume, noise);
+				scalarTicks += Time::getHighResolutionTicks() - startTicks;
+
+				startTicks = Time::getHighResolutionTicks();
+				vectorized.processVectorized(vectorizedBuffer, 0, blockSize, volume, noise);
+				vectorizedTicks += Time::getHighResolutionTicks() - startTicks;
+
+				for (int channel = 0; channel < gainNoiseChannels; channel++) {
+					const auto *expected = scalarBuffer.getReadPointer(channel);
+					const auto *actual = vectorizedBuffer.getReadPointer(channel);
+
+					for (int sample = 0; sample < blockSize; sample++)
+						maxDifference = jmax(maxDifference, std::abs(expected[sample] - actual[sample]));
+				}
+			}
+
+			const int64 numSamples = (int64) numBlocks * blockSize * gainNoiseChannels;
+			const double scalarNs = 1.0e9 * Time::highResolutionTicksToSeconds(scalarTicks) / numSamples;
+			const double vectorizedNs = 1.0e9 * Time::highResolutionTicksToSeconds(vectorizedTicks) / numSamples;
+
+			csvOutput << setting.name << "," << blockSize << "," << gainNoiseChannels << "," << numSamples << ","
+				<< String(maxDifference, 9) << "," << String(scalarNs, 3) << "," << String(vectorizedNs, 3) << ","
+				<< String(vectorizedNs > 0.0 ? scalarNs / vectorizedNs : 0.0, 2) << "\n";
+			csvOutput.flush();
+
+			allMatch = allMatch && maxDifference <= gainNoiseTolerance;
+		}
+	}
+
+	return allMatch;
+}
+
+
+float CallbackBenchmark::getGainNoiseTolerance() {
+	return gainNoiseTolerance;
+}
+
+
+/*
+ * Parses the benchmark options and runs the sweep (or the sample store or volume/noise run),
+ *   writing CSV to stdout or a file
+ */
+int CallbackBenchmark::runFromCommandLine(const StringArray &args) {
+	Settings settings;
+	settings.parameterSettings = getDefaultParameterSettings();
+
+	for (int i = 0; i < args.size() - 1; i++) {
+		const String &option = args[i];
+		const String value = args[i + 1].unquoted();
+
+		if (option == "--input")
+			settings.input = File::getCurrentWorkingDirectory().getChildFile(value);
+		else if (option == "--block-sizes")
+			settings.blockSizes = parseIntList(value);
+		else if (option == "--channels")
+			settings.channelCounts = parseIntList(value);
+		else if (option == "--voices")
+			settings.voiceCounts = parseIntList(value, 0);
+		else if (option == "--workers")
+			settings.workerCounts = parseIntList(value, 0);
+		else if (option == "--branches")
+			settings.branchCounts = parseIntList(value, 0);
+		else if (option == "--seconds")
+			settings.secondsPerRun = jmax(0.01, value.getDoubleValue());
+		else if (option == "--sample-rate")
+			settings.sampleRate = jmax(8000.0, value.getDoubleValue());
+	}
+
+	if (settings.input != File() && !settings.input.existsAsFile()) {
+		std::cerr << "Couldn't find " << settings.input.getFullPathName() << std::endl << getUsage() << std::endl;
+		return 1;
+	}
+
+	int outputIndex = args.indexOf("--output");
+	std::unique_ptr<OutputStream> output;
+
+	if (outputIndex >= 0 && outputIndex + 1 < args.size()) {
+		File outputFile = File::getCurrentWorkingDirectory().getChildFile(args[outputIndex + 1].unquoted());
+		outputFile.deleteFile();
+		output.reset(outputFile.createOutputStream());
+
+		if (output == nullptr) {
+			std::cerr << "Couldn't write " << outputFile.getFullPathName() << std::endl;
+			return 1;
+		}
+	}
+	else {
+		output.reset(new StdOutStream());
+	}
+
+	if (args.contains("--sample-store"))
+		return runSampleStoreBenchmark(settings.secondsPerRun, *output) ? 0 : 1;
+
+	if (args.contains("--gain-noise")) {
+		if (runGainNoiseCheck(settings, *output))
+			return 0;
+
+		std::cerr << "The vectorized volume/noise output differs from the scalar one by more than "
+		          << getGainNoiseTolerance() << std::endl;
+		return 1;
+	}
+
+#if ! SFP_BENCHMARK_COUNT_ALLOCATIONS
+	std::cerr << "Allocations aren't counted in this build (use the Benchmark configuration)" << std::endl;
+#endif
+
+	runSweep(settings, *output);
+	return 0;
+}
+
+
+String CallbackBenchmark::getUsage() {
+	return "Usage: SoundFilePlayer --benchmark [--input file] [--block-sizes 32,64,...] [--channels 1,2,...]\n"
+	       "                       [--voices 0,16,64] [--workers 0,1,3] [--branches 0,1,4] [--seconds s]\n"
+	       "                       [--sample-rate hz] [--output results.csv]\n"
+	       "       SoundFilePlayer --benchmark --sample-store [--seconds s] [--output results.csv]\n"
+	       "       SoundFilePlayer --benchmark --gain-noise [--block-sizes 32,64,...] [--seconds s] [--output results.csv]";
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+  callback_benchmark.h -- interface for the audio callback micro-benchmarks
+	- Drives PlaybackEngine::getNextAudioBlock directly (standing in for an
+	  audio device) over a sweep of block sizes, channel counts, layer counts,
+	  callback worker counts, effect branch counts and volume/noise settings
+	- Reports ns/sample, callback time percentiles and allocations per
+	  callback as CSV, so runs from different builds can be compared
+	- A separate run checks the compact sample store's conversions against
+	  JUCE's for every 16 and 24-bit value, and times them
+	- Another runs the scalar and vectorized volume/noise stages on the same
+	  input, noise seed & ramps, and checks that their outputs match
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Counts heap allocations by replacing the global allocation functions (operator new
+//   everywhere, and malloc/calloc/realloc on Linux). Off by default, since the replacements
+//   apply to the whole application; the Benchmark build configuration turns it on. Without
+//   it the allocation columns are left empty.
+#ifndef SFP_BENCHMARK_COUNT_ALLOCATIONS
+ #define SFP_BENCHMARK_COUNT_ALLOCATIONS 0
+#endif
+
+//==============================================================================
+/*
+    Micro-benchmark suite for the audio callback path.
+*/
+class CallbackBenchmark
+{
+public:
+	// One volume/noise setting to measure
+	struct ParameterSetting
+	{
+		String name;
+		float volume;
+		float noise;
+		bool ramping;	// alternate the volume every callback so it's always ramping
+	};
+
+	struct Settings
+	{
+		File input;		// empty = synthetic source
+		Array<int> blockSizes { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+		Array<int> channelCounts { 1, 2, 4, 8, 16, 32, 64 };
+		Array<int> voiceCounts { 0 };	// layers mixed in (synthetic stereo files, decoded inline)
+		Array<int> workerCounts { 0 };	// callback workers (see callback_worker_pool.h)
+		Array<int> branchCounts { 0 };	// effect branches, each low-pass -> delay -> reverb (see effect_rack.h)
+		Array<ParameterSetting> parameterSettings;
+		double sampleRate = 48000.0;
+		double secondsPerRun = 1.0;	// audio time processed per configuration
+	};
+
+	// One row of results
+	struct Measurement
+	{
+		int blockSize = 0;
+		int numChannels = 0;
+		int numVoices = 0;
+		int numWorkers = 0;
+		int numBranches = 0;
+		String settingName;
+		int numCallbacks = 0;
+		double nsPerSample = 0.0;	// per channel-sample
+		double meanMicros = 0.0;
+		double p50Micros = 0.0;
+		double p99Micros = 0.0;
+		double maxMicros = 0.0;
+		double loadPercent = 0.0;	// mean callback time as % of the block's duration
+		double allocationsPerCallback = 0.0;
+		int64 maxAllocations = 0;
+		double workerPercent = 0.0;	// % of the work items (channels, effect branches) run on a worker
+
+		String toCsvRow() const;
+	};
+
+	static Array<ParameterSetting> getDefaultParameterSettings();
+
+	// Runs one configuration / the whole sweep
+	static Measurement measure(const Settings &settings, int blockSize, int numChannels, const ParameterSetting &setting,
+	                           int numVoices = 0, int numWorkers = 0, int numBranches = 0);
+	static void runSweep(const Settings &settings, OutputStream &csvOutput);
+
+	// Checks & times the compact sample store's conversions, writing CSV; returns false if
+	//   any conversion differs from JUCE's
+	static bool runSampleStoreBenchmark(double secondsPerFormat, OutputStream &csvOutput);
+
+	// Runs the scalar (reference) and vectorized volume/noise implementations side by side for
+	//   each block size & setting, writing CSV with their largest difference and their speed;
+	//   returns false if any sample differs by more than getGainNoiseTolerance()
+	static bool runGainNoiseCheck(const Settings &settings, OutputStream &csvOutput);
+	static float getGainNoiseTolerance();
+
+	// Command-line entry point ("--benchmark [options]"); returns the process exit code (1 for bad
+	//   options, or for a mismatch with --sample-store or --gain-noise)
+	static int runFromCommandLine(const StringArray &args);
+	static String getUsage();
+	static String getCsvHeader();
+};
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+  callback_worker_pool.cpp -- implementation of the audio callback's worker threads
+
+  ==============================================================================
+*/
+
+#include "callback_worker_pool.h"
+
+namespace {
+	// Workers run just below the audio thread, so they don't hold it up
+	const int workerPriority = 9;
+	const int stopTimeoutMs = 1000;
+}
+
+//==============================================================================
+/*
+    One helper thread: sleeps until it's notified, then takes items until
+    there are none left.
+*/
+class CallbackWorkerPool::Worker : public Thread
+{
+public:
+	Worker(CallbackWorkerPool &owner, int threadIndex)
+		: Thread("Callback worker " + String(threadIndex)),
+		  owner_(owner),
+		  threadIndex_(threadIndex)
+	{
+	}
+
+	void run() override {
+		while (!threadShouldExit()) {
+			wait(-1);
+
+			while (owner_.runNextItem(threadIndex_)) {}
+		}
+	}
+
+private:
+	CallbackWorkerPool &owner_;
+	const int threadIndex_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+
+//==============================================================================
+
+// Constructor
+CallbackWorkerPool::CallbackWorkerPool()
+	: numWorkers_(0),
+	  job_(nullptr),
+	  claim_(0),
+	  numDone_(0),
+	  numItemsRun_(0),
+	  numItemsOnWorkers_(0)
+{
+	for (int worker = 0; worker < maxWorkers; worker++)
+		workers_.add(new Worker(*this, worker + 1));
+}
+
+
+// Destructor
+CallbackWorkerPool::~CallbackWorkerPool()
+{
+	setNumWorkers(0);
+}
+
+
+/*
+ * Starts or stops workers. A worker being stopped is taken out of use first; if it's partway
+ *   through an item it finishes it before it exits.
+ */
+void CallbackWorkerPool::setNumWorkers(int numWorkers) {
+	numWorkers = jlimit(0, (int) maxWorkers, numWorkers);
+
+	if (numWorkers < numWorkers_.load())
+		numWorkers_.store(numWorkers);
+
+	for (int worker = 0; worker < maxWorkers; worker++) {
+		if (worker < numWorkers && !workers_[worker]->isThreadRunning())
+			workers_[worker]->startThread(workerPriority);
+		else if (worker >= numWorkers)
+			workers_[worker]->stopThread(stopTimeoutMs);
+	}
+
+	numWorkers_.store(numWorkers);
+}
+
+
+int CallbackWorkerPool::getNumWorkers() const {
+	return numWorkers_.load();
+}
+
+
+int CallbackWorkerPool::getNumBackgroundWorkers() {
+	return jlimit(1, 16, SystemStats::getNumCpus());
+}
+
+
+/*
+ * Publishes the run in a new generation of the claim word, wakes the workers it needs, then
+ *   takes items alongside them. Once there are none left to claim, the only wait is for
+ *   items a worker is still processing.
+ */
+void CallbackWorkerPool::run(Job &job, int numItems) {
+	jassert (numItems <= 0xffff);
+
+	const int numWorkers = jmin(numWorkers_.load(std::memory_order_relaxed), numItems - 1);
+
+	if (numWorkers <= 0) {
+		for (int item = 0; item < numItems; item++)
+			job.processItem(item, 0);
+
+		numItemsRun_.fetch_add(numItems, std::memory_order_relaxed);
+		return;
+	}
+
+	job_ = &job;
+	numDone_.store(0, std::memory_order_relaxed);
+
+	const uint64 generation = (claim_.load(std::memory_order_relaxed) >> 32) + 1;
+	claim_.store((generation << 32) | ((uint64) numItems << 16), std::memory_order_release);
+
+	for (int worker = 0; worker < numWorkers; worker++)
+		workers_[worker]->notify();
+
+	int numHere = 0;
+	while (runNextItem(0))
+		numHere++;
+
+	while (numDone_.load(std::memory_order_acquire) < numItems) {}
+
+	numItemsRun_.fetch_add(numItems, std::memory_order_relaxed);
+	numItemsOnWorkers_.fetch_add(numItems - numHere, std::memory_order_relaxed);
+}
+
+
+/*
+ * Claims the next item of the current run and processes it. A worker that wakes late, after
+ *   its run has finished, finds nothing to claim; the generation in the claim word stops it
+ *   from claiming an item of a later run with a stale view of it.
+ */
+bool CallbackWorkerPool::runNextItem(int threadIndex) {
+	uint64 claim = claim_.load(std::memory_order_acquire);
+
+	for (;;) {
+		const int numItems = (int) ((claim >> 16) & 0xffff);
+		const int item = (int) (claim & 0xffff);
+
+		if (item >= numItems)
+			return false;
+
+		if (claim_.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			job_->processItem(item, threadIndex);
+			numDone_.fetch_add(1, std::memory_order_release);
+			return true;
+		}
+	}
+}
+
+
+double CallbackWorkerPool::getWorkerShare() const {
+	const int64 numRun = numItemsRun_.load();
+	return numRun > 0 ? (double) numItemsOnWorkers_.load() / (double) numRun : 0.0;
+}
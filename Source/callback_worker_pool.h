@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+  callback_worker_pool.h -- interface for the audio callback's worker threads
+	- A few threads that wait to be handed the independent pieces of one block
+	  (the channels of the volume/noise stage, the branches of the effect
+	  rack), so a stage can run on several cores inside the callback
+	- The audio thread takes items too, claiming them from the same atomic
+	  counter, so it never waits for a worker that hasn't woken up yet - only
+	  for items a worker has already started
+	- Counts how many items the workers took, so the benefit can be measured
+	  (see callback_benchmark.h)
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Splits the items of a block between the audio thread and up to maxWorkers
+    helper threads.
+*/
+class CallbackWorkerPool
+{
+public:
+	enum { maxWorkers = 3 };
+
+	// The work to do for each item
+	class Job
+	{
+	public:
+		virtual ~Job() {}
+
+		// Called once per item, on the audio thread (thread index 0) or a worker (1 to
+		//   maxWorkers). Calls for different items can overlap.
+		virtual void processItem(int item, int threadIndex) = 0;
+	};
+
+	CallbackWorkerPool();
+	~CallbackWorkerPool();
+
+	// Message thread: starts or stops workers (safe while the audio thread is running jobs)
+	void setNumWorkers(int numWorkers);
+	int getNumWorkers() const;
+
+	// Audio thread: runs the job for items [0, numItems) and returns once every item is done.
+	//   With no workers (or one item) it all happens on the calling thread.
+	void run(Job &job, int numItems);
+
+	// Fraction of the items run so far that were processed by a worker
+	double getWorkerShare() const;
+
+	// Threads for work off the audio thread that splits across cores (decoding, opening &
+	//   measuring files): one per core, up to 16
+	static int getNumBackgroundWorkers();
+
+private:
+	class Worker;
+
+	// Private helper functions
+	bool runNextItem(int threadIndex);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	OwnedArray<Worker> workers_;
+	std::atomic<int> numWorkers_;
+
+	// The current run: the job, the claim word (generation in the top 32 bits, the number of
+	//   items in the next 16, the next item to claim in the bottom 16) and the number of items
+	//   finished
+	Job *job_;
+	std::atomic<uint64> claim_;
+	std::atomic<int> numDone_;
+
+	// Items run in total, and by the workers
+	std::atomic<int64> numItemsRun_;
+	std::atomic<int64> numItemsOnWorkers_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackWorkerPool)
+};
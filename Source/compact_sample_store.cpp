@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+  compact_sample_store.cpp -- implementation of the player's in-memory sample store
+
+  ==============================================================================
+*/
+
+#include "compact_sample_store.h"
+
+namespace {
+	// The scale JUCE's readers use (a 32-bit integer over 0x7fffffff, which rounds to 2^-31
+	//   as a float), applied at each width. All three are powers of two, so the conversions
+	//   are exact.
+	const float int16Scale = 1.0f / 32768.0f;
+	const float int32Scale = 1.0f / (float) 0x7fffffff;
+}
+
+//==============================================================================
+
+// Constructor
+CompactSampleStore::CompactSampleStore()
+	: format_(Float32),
+	  numChannels_(0),
+	  numSamples_(0),
+	  bytesPerChannel_(0)
+{
+}
+
+
+// Destructor
+CompactSampleStore::~CompactSampleStore()
+{
+}
+
+
+/*
+ * 16-bit for files of up to 16 bits, packed 24-bit for up to 24 bits, float otherwise
+ */
+CompactSampleStore::Format CompactSampleStore::chooseFormat(const AudioFormatReader &reader) {
+	if (reader.usesFloatingPointData || reader.bitsPerSample <= 0 || reader.bitsPerSample > 24)
+		return Float32;
+
+	return reader.bitsPerSample <= 16 ? Int16 : Int24;
+}
+
+
+int CompactSampleStore::getBytesPerSample(Format format) {
+	switch (format) {
+		case Int16: return 2;
+		case Int24: return 3;
+		default:    return 4;
+	}
+}
+
+
+String CompactSampleStore::getFormatName(Format format) {
+	switch (format) {
+		case Int16: return "16-bit";
+		case Int24: return "24-bit";
+		default:    return "float";
+	}
+}
+
+
+void CompactSampleStore::allocate(Format format, int numChannels, int64 numSamples) {
+	format_ = format;
+	numChannels_ = jmax(1, numChannels);
+	numSamples_ = jmax((int64) 0, numSamples);
+	bytesPerChannel_ = (size_t) getBytesPerSample(format) * (size_t) numSamples_;
+	data_.calloc(jmax((size_t) 1, bytesPerChannel_ * (size_t) numChannels_));
+}
+
+
+CompactSampleStore::Format CompactSampleStore::getFormat() const {
+	return format_;
+}
+
+
+int CompactSampleStore::getNumChannels() const {
+	return numChannels_;
+}
+
+
+int64 CompactSampleStore::getNumSamples() const {
+	return numSamples_;
+}
+
+
+size_t CompactSampleStore::getNumBytes() const {
+	return bytesPerChannel_ * (size_t) numChannels_;
+}
+
+
+/*
+ * Narrows a reader's output to the stored width. The low bits dropped are always zero for a
+ *   file of that width, so nothing is lost.
+ */
+void CompactSampleStore::write(int channel, int64 startSample, const int *source, int numSamples) {
+	jassert (isPositiveAndBelow(channel, numChannels_) && startSample >= 0 && startSample + numSamples <= numSamples_);
+
+	uint8 *base = data_ + bytesPerChannel_ * (size_t) channel;
+
+	switch (format_) {
+		case Int16: {
+			auto *dest = reinterpret_cast<int16 *>(base) + startSample;
+			for (int i = 0; i < numSamples; i++)
+				dest[i] = (int16) (source[i] >> 16);
+			break;
+		}
+
+		case Int24: {
+			auto *dest = base + 3 * startSample;
+			for (int i = 0; i < numSamples; i++) {
+				const uint32 value = (uint32) source[i];
+				dest[3 * i]     = (uint8) (value >> 8);
+				dest[3 * i + 1] = (uint8) (value >> 16);
+				dest[3 * i + 2] = (uint8) (value >> 24);
+			}
+			break;
+		}
+
+		default:
+			memcpy(reinterpret_cast<float *>(base) + startSample, source, sizeof(float) * (size_t) numSamples);
+			break;
+	}
+}
+
+
+void CompactSampleStore::read(int channel, int64 startSample, float *dest, int numSamples) const {
+	const uint8 *base = data_ + bytesPerChannel_ * (size_t) jlimit(0, numChannels_ - 1, channel);
+
+	switch (format_) {
+		case Int16:
+			convertInt16ToFloat(reinterpret_cast<const int16 *>(base) + startSample, dest, numSamples);
+			break;
+
+		case Int24:
+			convertInt24ToFloat(base + 3 * startSample, dest, numSamples);
+			break;
+
+		default:
+			FloatVectorOperations::copy(dest, reinterpret_cast<const float *>(base) + startSample, numSamples);
+			break;
+	}
+}
+
+
+/*
+ * Widening & scaling, vectorized by the compiler (8 or 16 samples per iteration with SSE2/AVX2
+ *   or NEON)
+ */
+void CompactSampleStore::convertInt16ToFloat(const int16 *source, float *dest, int numSamples) {
+	for (int i = 0; i < numSamples; i++)
+		dest[i] = (float) source[i] * int16Scale;
+}
+
+
+/*
+ * Assembles each little-endian sample in the top three bytes of a 32-bit integer (which also
+ *   sign-extends it), then scales as for a 32-bit sample
+ */
+void CompactSampleStore::convertInt24ToFloat(const uint8 *source, float *dest, int numSamples) {
+	for (int i = 0; i < numSamples; i++) {
+		const uint32 value = ((uint32) source[3 * i] << 8) | ((uint32) source[3 * i + 1] << 16)
+		                   | ((uint32) source[3 * i + 2] << 24);
+		dest[i] = (float) (int32) value * int32Scale;
+	}
+}
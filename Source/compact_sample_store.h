@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+  compact_sample_store.h -- interface for the player's in-memory sample store
+	- Holds decoded audio at the file's own width: 16-bit files as 16-bit
+	  samples and 24-bit files as packed 3-byte samples, instead of 32-bit
+	  floats, halving (or better) the memory a resident file takes
+	- Samples are converted to float as they're read, with loops written for
+	  the compiler to vectorize
+	- The conversion is bit-exact with the float samples JUCE's readers
+	  produce for the same file
+	- Floating-point and 32-bit files are kept as floats
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Planar storage for a block of samples. Written from a reader's 32-bit
+    output (one write per region, by any thread), read as float.
+*/
+class CompactSampleStore
+{
+public:
+	enum Format {
+		Float32 = 0,
+		Int16,
+		Int24
+	};
+
+	CompactSampleStore();
+	~CompactSampleStore();
+
+	// The narrowest format that holds a reader's samples exactly
+	static Format chooseFormat(const AudioFormatReader &reader);
+	static int getBytesPerSample(Format format);
+	static String getFormatName(Format format);
+
+	// Allocates (and clears) the store; not thread-safe
+	void allocate(Format format, int numChannels, int64 numSamples);
+
+	Format getFormat() const;
+	int getNumChannels() const;
+	int64 getNumSamples() const;
+	size_t getNumBytes() const;
+
+	// Writes samples as AudioFormatReader::read(int* const*...) delivers them: floats stored
+	//   in ints for Float32, otherwise left-justified 32-bit integers. Different regions can
+	//   be written from different threads at once.
+	void write(int channel, int64 startSample, const int *source, int numSamples);
+
+	// Converts samples to float; doesn't allocate or lock, so it's safe on the audio thread
+	void read(int channel, int64 startSample, float *dest, int numSamples) const;
+
+	// The conversion kernels
+	static void convertInt16ToFloat(const int16 *source, float *dest, int numSamples);
+	static void convertInt24ToFloat(const uint8 *source, float *dest, int numSamples);
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	Format format_;
+	int numChannels_;
+	int64 numSamples_;
+	size_t bytesPerChannel_;
+	HeapBlock<uint8> data_;		// one run of samples per channel
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompactSampleStore)
+};
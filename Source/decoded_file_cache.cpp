@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+  decoded_file_cache.cpp -- implementation of the on-disk decoded audio cache
+
+  ==============================================================================
+*/
+
+#include "decoded_file_cache.h"
+
+namespace {
+	// Samples decoded & written at a time (the writer checks for shutdown between them)
+	const int samplesPerWrite = 65536;
+
+	// Extension of the decoded copies
+	const char *const cacheExtension = ".wav";
+}
+
+//==============================================================================
+/*
+    Decodes one file into a temporary WAV next to its final name, at the
+    file's own bit depth (floats as 32-bit float), then moves it into place.
+*/
+class DecodedFileCache::WriteJob : public ThreadPoolJob
+{
+public:
+	WriteJob(DecodedFileCache &owner, const File &file)
+		: ThreadPoolJob("Decoded cache writer"), owner_(owner), file_(file)
+	{
+	}
+
+	JobStatus runJob() override {
+		if (write())
+			owner_.trimToSize();
+
+		const ScopedLock sl(owner_.lock_);
+		owner_.pending_.removeString(file_.getFullPathName());
+		return jobHasFinished;
+	}
+
+private:
+	bool write() {
+		std::unique_ptr<AudioFormatReader> reader(owner_.formatManager_.createReaderFor(file_));
+
+		if (reader == nullptr)
+			return false;
+
+		const int bitsPerSample = reader->usesFloatingPointData || reader->bitsPerSample > 24 ? 32
+		                        : reader->bitsPerSample > 16 ? 24 : 16;
+		const int64 numBytes = (int64) (bitsPerSample / 8) * reader->numChannels * reader->lengthInSamples;
+
+		// A copy that could never fit isn't worth decoding
+		if (numBytes > owner_.getMaxBytes())
+			return false;
+
+		TemporaryFile temp(owner_.getFileForSource(file_));
+
+		{
+			std::unique_ptr<FileOutputStream> output(temp.getFile().createOutputStream());
+			if (output == nullptr)
+				return false;
+
+			WavAudioFormat wav;
+			std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(output.get(), reader->sampleRate,
+				reader->numChannels, bitsPerSample, {}, 0));
+
+			if (writer == nullptr)
+				return false;
+			output.release();	// now owned by the writer
+
+			for (int64 start = 0; start < reader->lengthInSamples; start += samplesPerWrite) {
+				if (shouldExit())
+					return false;
+
+				const int num = (int) jmin((int64) samplesPerWrite, reader->lengthInSamples - start);
+				if (!writer->writeFromAudioReader(*reader, start, num))
+					return false;
+			}
+		}
+
+		return temp.overwriteTargetFileWithTemporary();
+	}
+
+	DecodedFileCache &owner_;
+	File file_;
+};
+
+
+//==============================================================================
+
+// Constructor
+DecodedFileCache::DecodedFileCache(const File &directory, int64 maxBytes)
+	: directory_(directory),
+	  maxBytes_(maxBytes),
+	  writerPool_(1)
+{
+	directory_.createDirectory();
+	formatManager_.registerBasicFormats();
+}
+
+
+// Destructor
+DecodedFileCache::~DecodedFileCache()
+{
+	writerPool_.removeAllJobs(true, 10000);
+}
+
+
+File DecodedFileCache::getDefaultDirectory() {
+	return File::getSpecialLocation(File::userApplicationDataDirectory)
+		.getChildFile("SoundFilePlayer")
+		.getChildFile("DecodedAudio");
+}
+
+
+const File &DecodedFileCache::getDirectory() const {
+	return directory_;
+}
+
+
+void DecodedFileCache::setMaxBytes(int64 maxBytes) {
+	maxBytes_ = jmax((int64) 0, maxBytes);
+}
+
+
+int64 DecodedFileCache::getMaxBytes() const {
+	return maxBytes_.load();
+}
+
+
+int64 DecodedFileCache::getBytesUsed() const {
+	int64 total = 0;
+
+	for (DirectoryIterator it(directory_, false, String("*") + cacheExtension); it.next();)
+		total += it.getFile().getSize();
+
+	return total;
+}
+
+
+/*
+ * Uncompressed files on a local disk can already be mapped (or streamed cheaply), so only
+ *   compressed files and ones on network or removable drives are copied
+ */
+bool DecodedFileCache::shouldCache(AudioFormatManager &formatManager, const File &file) {
+	auto *format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+	return (format != nullptr && format->isCompressed()) || !file.isOnHardDisk() || file.isOnRemovableDrive();
+}
+
+
+/*
+ * A hit is marked as used by bringing its modification time forward, which is what the
+ *   size limit goes by
+ */
+File DecodedFileCache::findCachedFile(const File &file) {
+	File cached = getFileForSource(file);
+
+	if (!cached.existsAsFile())
+		return {};
+
+	cached.setLastModificationTime(Time::getCurrentTime());
+	return cached;
+}
+
+
+void DecodedFileCache::addFile(const File &file) {
+	if (getFileForSource(file).existsAsFile())
+		return;
+
+	const ScopedLock sl(lock_);
+
+	if (pending_.contains(file.getFullPathName()))
+		return;
+
+	pending_.add(file.getFullPathName());
+	writerPool_.addJob(new WriteJob(*this, file), true);
+}
+
+
+/*
+ * Name of the copy for a file as it is now; the size & modification time are part of the
+ *   key, so a changed file gets a new copy (and the old one ages out)
+ */
+File DecodedFileCache::getFileForSource(const File &file) const {
+	const String key = file.getFullPathName() + "|" + String(file.getSize()) + "|"
+		+ String(file.getLastModificationTime().toMilliseconds());
+
+	return directory_.getChildFile(String::toHexString(key.hashCode64()) + cacheExtension);
+}
+
+
+/*
+ * Deletes the least recently used copies until the cache is within its size limit (a copy
+ *   that's mapped by a playing file may refuse to go, and is left for next time)
+ */
+void DecodedFileCache::trimToSize() {
+	Array<File> files;
+	directory_.findChildFiles(files, File::findFiles, false, String("*") + cacheExtension);
+
+	std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+		return a.getLastModificationTime() < b.getLastModificationTime();
+	});
+
+	int64 total = 0;
+	for (auto &file : files)
+		total += file.getSize();
+
+	for (auto &file : files) {
+		if (total <= getMaxBytes())
+			break;
+
+		const int64 size = file.getSize();
+		if (file.deleteFile())
+			total -= size;
+	}
+}
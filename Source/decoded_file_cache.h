@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+  decoded_file_cache.h -- interface for the on-disk decoded audio cache
+	- Keeps a decoded copy of compressed files (and of files on network or
+	  removable drives) as WAV files, which can be memory-mapped
+	- Copies are keyed by the file's path, size & modification time, so an
+	  edited file is decoded again
+	- Copies are written in the background after a file is first opened, and
+	  the least recently used ones are deleted to stay within a size limit
+	- Reopening a cached file maps the copy instead of decoding it
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Directory of decoded copies. Thread-safe: files can be looked up & added
+    from any loader thread.
+*/
+class DecodedFileCache
+{
+public:
+	DecodedFileCache(const File &directory, int64 maxBytes);
+	~DecodedFileCache();
+
+	// Default location: <app data>/SoundFilePlayer/DecodedAudio
+	static File getDefaultDirectory();
+
+	const File &getDirectory() const;
+
+	// Size limit (applied after each copy is written) and the space the copies take now
+	void setMaxBytes(int64 maxBytes);
+	int64 getMaxBytes() const;
+	int64 getBytesUsed() const;
+
+	// True for files that are worth caching: compressed ones, and ones that aren't on a local
+	//   hard disk
+	static bool shouldCache(AudioFormatManager &formatManager, const File &file);
+
+	// Returns the decoded copy of a file (marking it as recently used), or File() if there isn't
+	//   one yet
+	File findCachedFile(const File &file);
+
+	// Starts writing a decoded copy in the background, unless there's one already
+	void addFile(const File &file);
+
+private:
+	class WriteJob;
+
+	// Private helper functions
+	File getFileForSource(const File &file) const;
+	void trimToSize();
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	File directory_;
+	std::atomic<int64> maxBytes_;
+
+	// Files being written (by path), and the writer
+	CriticalSection lock_;
+	StringArray pending_;
+	AudioFormatManager formatManager_;
+	ThreadPool writerPool_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodedFileCache)
+};
@@ -0,0 +1,459 @@
+/*
+  ==============================================================================
+
+  effect_rack.cpp -- implementation of the player's effect chains
+
+  ==============================================================================
+*/
+
+#include "effect_rack.h"
+#include "internal_effects.h"
+
+namespace {
+	// Smoothing applied to each effect's displayed load (per block)
+	const float loadSmoothing = 0.05f;
+
+	void storeMax(std::atomic<float> &value, float candidate) {
+		if (candidate > value.load(std::memory_order_relaxed))
+			value.store(candidate, std::memory_order_relaxed);
+	}
+}
+
+//==============================================================================
+/*
+    One effect in a branch's graph: presents the file's channel count to the
+    graph, gives the effect the nearest layout it takes (the same count, else
+    stereo, else mono) and times its processing.
+*/
+class EffectRack::HostedEffect : public InternalEffect
+{
+public:
+	HostedEffect(std::unique_ptr<AudioProcessor> effect, int numChannels)
+		: InternalEffect(0.0, numChannels),
+		  effect_(std::move(effect)),
+		  smoothedLoad_(0.0f),
+		  lastMicros_(0.0f),
+		  worstMicros_(0.0f),
+		  loadPercent_(0.0f)
+	{
+		const AudioChannelSet layouts[] = {
+			AudioChannelSet::canonicalChannelSet(numChannels),
+			AudioChannelSet::discreteChannels(numChannels),
+			AudioChannelSet::stereo(),
+			AudioChannelSet::mono()
+		};
+
+		for (const auto &layout : layouts) {
+			auto buses = effect_->getBusesLayout();
+			buses.getChannelSet(true, 0) = layout;
+			buses.getChannelSet(false, 0) = layout;
+
+			if (effect_->setBusesLayout(buses))
+				break;
+		}
+
+		effectChannels_ = jmax(effect_->getTotalNumInputChannels(), effect_->getTotalNumOutputChannels());
+	}
+
+	// Hands the effect back (unprepared), so it can be moved to a rebuilt graph
+	std::unique_ptr<AudioProcessor> releaseEffect() {
+		effect_->releaseResources();
+		return std::move(effect_);
+	}
+
+	EffectRack::Timing getTiming() const {
+		EffectRack::Timing timing;
+		timing.name = getName();
+		timing.lastMicros = lastMicros_.load(std::memory_order_relaxed);
+		timing.worstMicros = worstMicros_.load(std::memory_order_relaxed);
+		timing.loadPercent = loadPercent_.load(std::memory_order_relaxed);
+		return timing;
+	}
+
+	void resetWorst() {
+		worstMicros_.store(0.0f, std::memory_order_relaxed);
+	}
+
+	const String getName() const override {
+		return effect_ != nullptr ? effect_->getName() : String();
+	}
+
+	double getTailLengthSeconds() const override {
+		return effect_ != nullptr ? effect_->getTailLengthSeconds() : 0.0;
+	}
+
+	void prepareToPlay(double sampleRate, int maxBlockSize) override {
+		if (effect_ == nullptr)
+			return;
+
+		effect_->setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+		effect_->prepareToPlay(sampleRate, maxBlockSize);
+		scratch_.setSize(effectChannels_, maxBlockSize);
+	}
+
+	void releaseResources() override {
+		if (effect_ != nullptr)
+			effect_->releaseResources();
+	}
+
+	/*
+	 * An effect with as many channels as the file processes them in place. Otherwise it works
+	 *   on a copy: one with fewer channels gets the first ones (the rest pass through dry), and
+	 *   one with more gets the file's channels repeated, keeping its first ones.
+	 */
+	void processBlock(AudioBuffer<float> &buffer, MidiBuffer &midi) override {
+		const int64 startTicks = Time::getHighResolutionTicks();
+		const int numChannels = buffer.getNumChannels();
+		const int numSamples = buffer.getNumSamples();
+
+		if (effectChannels_ == numChannels) {
+			effect_->processBlock(buffer, midi);
+		}
+		else if (effectChannels_ > 0) {
+			scratch_.setSize(effectChannels_, numSamples, false, false, true);
+			for (int channel = 0; channel < effectChannels_; channel++)
+				scratch_.copyFrom(channel, 0, buffer, channel % numChannels, 0, numSamples);
+
+			effect_->processBlock(scratch_, midi);
+
+			for (int channel = 0; channel < jmin(numChannels, effectChannels_); channel++)
+				buffer.copyFrom(channel, 0, scratch_, channel, 0, numSamples);
+		}
+
+		const float micros = (float) (Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1.0e6);
+		const float blockMicros = (float) (1.0e6 * numSamples / getSampleRate());
+
+		if (blockMicros > 0.0f)
+			smoothedLoad_ += loadSmoothing * (100.0f * micros / blockMicros - smoothedLoad_);
+
+		lastMicros_.store(micros, std::memory_order_relaxed);
+		loadPercent_.store(smoothedLoad_, std::memory_order_relaxed);
+		storeMax(worstMicros_, micros);
+	}
+
+private:
+	std::unique_ptr<AudioProcessor> effect_;
+	int effectChannels_;
+	AudioBuffer<float> scratch_;
+
+	// Only the thread processing the branch writes these (one at a time)
+	float smoothedLoad_;
+	std::atomic<float> lastMicros_;
+	std::atomic<float> worstMicros_;
+	std::atomic<float> loadPercent_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HostedEffect)
+};
+
+
+//==============================================================================
+/*
+    A branch's graph, its chain of nodes (input, the effects in order, output),
+    and the copy of the block it works on when it runs alongside other branches
+*/
+struct EffectRack::Branch
+{
+	std::unique_ptr<AudioProcessorGraph> graph;
+	Array<AudioProcessorGraph::Node::Ptr> chain;
+	AudioBuffer<float> buffer;
+	MidiBuffer midi;
+};
+
+
+//==============================================================================
+
+// Constructor
+EffectRack::EffectRack(CallbackWorkerPool &workers)
+	: workers_(workers),
+	  numChannels_(2),
+	  sampleRate_(44100.0),
+	  maxBlockSize_(512),
+	  needsRebuild_(false),
+	  input_(nullptr)
+{
+	pluginFormats_.addDefaultFormats();
+}
+
+
+// Destructor
+EffectRack::~EffectRack()
+{
+	cancelPendingUpdate();
+}
+
+
+/*
+ * Rebuilds the branches for a new channel count, rate or block size. Plugins are prepared on
+ *   the message thread, so from anywhere else the rebuild is left to it.
+ */
+void EffectRack::prepare(int numChannels, double sampleRate, int maxBlockSize) {
+	const ScopedLock sl(lock_);
+
+	if (numChannels == numChannels_ && sampleRate == sampleRate_ && maxBlockSize == maxBlockSize_)
+		return;
+
+	numChannels_ = numChannels;
+	sampleRate_ = sampleRate;
+	maxBlockSize_ = maxBlockSize;
+	needsRebuild_ = true;
+
+	if (MessageManager::existsAndIsCurrentThread())
+		rebuildIfNeeded();
+	else
+		triggerAsyncUpdate();
+}
+
+
+int EffectRack::getNumBranches() const {
+	return branches_.size();
+}
+
+
+int EffectRack::addBranch() {
+	if (branches_.size() >= maxBranches)
+		return -1;
+
+	const ScopedLock sl(lock_);
+	rebuildIfNeeded();
+
+	auto *branch = new Branch();
+	buildBranch(*branch, {});
+	branches_.add(branch);
+	return branches_.size() - 1;
+}
+
+
+/*
+ * Takes a branch out (its effects are deleted once the audio thread can run again)
+ */
+void EffectRack::removeBranch(int branch) {
+	std::unique_ptr<Branch> removed;
+
+	if (isPositiveAndBelow(branch, branches_.size())) {
+		const ScopedLock sl(lock_);
+		removed.reset(branches_.removeAndReturn(branch));
+	}
+}
+
+
+int EffectRack::getNumEffects(int branch) const {
+	return isPositiveAndBelow(branch, branches_.size()) ? jmax(0, branches_[branch]->chain.size() - 2) : 0;
+}
+
+
+String EffectRack::getEffectName(int branch, int index) const {
+	return isPositiveAndBelow(index, getNumEffects(branch)) ? getEffect(*branches_[branch], index)->getName() : String();
+}
+
+
+/*
+ * Appends an effect to a branch. Anything with an audio input & output will do; the branch's
+ *   graph is rebuilt around it.
+ */
+bool EffectRack::addEffect(int branch, std::unique_ptr<AudioProcessor> effect, String &error) {
+	if (effect == nullptr || !isPositiveAndBelow(branch, branches_.size())) {
+		error = "There's no such effect or branch";
+		return false;
+	}
+
+	if (effect->getBusCount(true) == 0 || effect->getBusCount(false) == 0) {
+		error = effect->getName() + " has no audio input or output";
+		return false;
+	}
+
+	if (getNumEffects(branch) >= maxEffectsPerBranch) {
+		error = "A branch holds up to " + String((int) maxEffectsPerBranch) + " effects";
+		return false;
+	}
+
+	const ScopedLock sl(lock_);
+	rebuildIfNeeded();
+
+	auto effects = takeEffects(*branches_[branch]);
+	effects.push_back(std::move(effect));
+	buildBranch(*branches_[branch], std::move(effects));
+	return true;
+}
+
+
+void EffectRack::removeEffect(int branch, int index) {
+	if (!isPositiveAndBelow(index, getNumEffects(branch)))
+		return;
+
+	std::unique_ptr<AudioProcessor> removed;
+	const ScopedLock sl(lock_);
+	rebuildIfNeeded();
+
+	auto effects = takeEffects(*branches_[branch]);
+	removed = std::move(effects[(size_t) index]);
+	effects.erase(effects.begin() + index);
+	buildBranch(*branches_[branch], std::move(effects));
+}
+
+
+void EffectRack::clear() {
+	OwnedArray<Branch> removed;
+	const ScopedLock sl(lock_);
+	branches_.swapWith(removed);
+}
+
+
+/*
+ * Asks each plugin format that might understand the file for the types in it
+ */
+void EffectRack::findPluginTypes(const File &file, OwnedArray<PluginDescription> &types) {
+	for (int index = 0; index < pluginFormats_.getNumFormats(); index++) {
+		auto *format = pluginFormats_.getFormat(index);
+
+		if (format->fileMightContainThisPluginType(file.getFullPathName()))
+			format->findAllTypesForFile(types, file.getFullPathName());
+	}
+}
+
+
+std::unique_ptr<AudioProcessor> EffectRack::createPlugin(const PluginDescription &type, String &error) {
+	return std::unique_ptr<AudioProcessor>(pluginFormats_.createPluginInstance(type, sampleRate_, maxBlockSize_, error));
+}
+
+
+/*
+ * Audio thread: a single branch processes the block in place; several work on copies of it,
+ *   spread over the callback workers, and their outputs are averaged. The audio passes
+ *   through dry while the branches are being changed.
+ */
+void EffectRack::process(AudioBuffer<float> &buffer) {
+	const ScopedTryLock sl(lock_);
+
+	if (!sl.isLocked() || branches_.isEmpty() || needsRebuild_.load(std::memory_order_relaxed)
+	    || buffer.getNumChannels() != numChannels_ || buffer.getNumSamples() > maxBlockSize_)
+		return;
+
+	if (branches_.size() == 1) {
+		auto &branch = *branches_.getUnchecked(0);
+		branch.midi.clear();
+		branch.graph->processBlock(buffer, branch.midi);
+		return;
+	}
+
+	input_ = &buffer;
+	workers_.run(*this, branches_.size());
+	input_ = nullptr;
+
+	const int numSamples = buffer.getNumSamples();
+	const float gain = 1.0f / (float) branches_.size();
+
+	for (int channel = 0; channel < numChannels_; channel++) {
+		float *dest = buffer.getWritePointer(channel);
+		FloatVectorOperations::copyWithMultiply(dest, branches_.getUnchecked(0)->buffer.getReadPointer(channel),
+			gain, numSamples);
+
+		for (int branch = 1; branch < branches_.size(); branch++)
+			FloatVectorOperations::addWithMultiply(dest, branches_.getUnchecked(branch)->buffer.getReadPointer(channel),
+				gain, numSamples);
+	}
+}
+
+
+/*
+ * Worker pool job: runs one branch's graph on its own copy of the block
+ */
+void EffectRack::processItem(int branch, int) {
+	auto &target = *branches_.getUnchecked(branch);
+	const int numSamples = input_->getNumSamples();
+
+	target.buffer.setSize(numChannels_, numSamples, false, false, true);
+	for (int channel = 0; channel < numChannels_; channel++)
+		target.buffer.copyFrom(channel, 0, *input_, channel, 0, numSamples);
+
+	target.midi.clear();
+	target.graph->processBlock(target.buffer, target.midi);
+}
+
+
+Array<EffectRack::Timing> EffectRack::getTimings() const {
+	Array<Timing> timings;
+
+	for (int branch = 0; branch < branches_.size(); branch++) {
+		for (int index = 0; index < getNumEffects(branch); index++) {
+			auto timing = getEffect(*branches_[branch], index)->getTiming();
+			timing.branch = branch;
+			timings.add(timing);
+		}
+	}
+
+	return timings;
+}
+
+
+void EffectRack::resetTimings() {
+	for (int branch = 0; branch < branches_.size(); branch++)
+		for (int index = 0; index < getNumEffects(branch); index++)
+			getEffect(*branches_[branch], index)->resetWorst();
+}
+
+
+void EffectRack::handleAsyncUpdate() {
+	const ScopedLock sl(lock_);
+	rebuildIfNeeded();
+}
+
+
+/*
+ * Builds a branch's graph: input -> effects -> output, every channel connected straight
+ *   through, prepared at the current settings. Call with the lock held, on the message thread.
+ */
+void EffectRack::buildBranch(Branch &branch, std::vector<std::unique_ptr<AudioProcessor>> effects) {
+	typedef AudioProcessorGraph::AudioGraphIOProcessor IOProcessor;
+
+	branch.chain.clear();
+	branch.graph.reset(new AudioProcessorGraph());
+
+	auto &graph = *branch.graph;
+	graph.setPlayConfigDetails(numChannels_, numChannels_, sampleRate_, maxBlockSize_);
+
+	branch.chain.add(graph.addNode(new IOProcessor(IOProcessor::audioInputNode)));
+	for (auto &effect : effects)
+		branch.chain.add(graph.addNode(new HostedEffect(std::move(effect), numChannels_)));
+	branch.chain.add(graph.addNode(new IOProcessor(IOProcessor::audioOutputNode)));
+
+	for (int node = 1; node < branch.chain.size(); node++)
+		for (int channel = 0; channel < numChannels_; channel++)
+			graph.addConnection({ { branch.chain[node - 1]->nodeID, channel }, { branch.chain[node]->nodeID, channel } });
+
+	graph.prepareToPlay(sampleRate_, maxBlockSize_);
+	branch.buffer.setSize(numChannels_, maxBlockSize_);
+}
+
+
+/*
+ * Takes a branch's effects out of its graph, in order, and deletes the graph
+ */
+std::vector<std::unique_ptr<AudioProcessor>> EffectRack::takeEffects(Branch &branch) {
+	std::vector<std::unique_ptr<AudioProcessor>> effects;
+
+	for (int index = 0; index < branch.chain.size() - 2; index++)
+		effects.push_back(getEffect(branch, index)->releaseEffect());
+
+	branch.chain.clear();
+	branch.graph.reset();
+	return effects;
+}
+
+
+/*
+ * Rebuilds every branch if the settings have changed since they were built (lock held)
+ */
+void EffectRack::rebuildIfNeeded() {
+	if (!needsRebuild_.load())
+		return;
+
+	for (auto *branch : branches_)
+		buildBranch(*branch, takeEffects(*branch));
+
+	needsRebuild_ = false;
+}
+
+
+EffectRack::HostedEffect *EffectRack::getEffect(const Branch &branch, int index) const {
+	return static_cast<HostedEffect *>(branch.chain[index + 1]->getProcessor());
+}
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+  effect_rack.h -- interface for the player's effect chains
+	- Up to four parallel branches, each a chain of effects in its own
+	  AudioProcessorGraph, between the transport and the volume/noise stage;
+	  the branches' outputs are averaged
+	- Effects are the built-in ones (see internal_effects.h) or plugins loaded
+	  through JUCE's plugin formats (LADSPA on Linux, and VST3 where JUCE can
+	  host it)
+	- With several branches, each one runs on whichever thread claims it from
+	  the callback workers (see callback_worker_pool.h), so independent chains
+	  share the block's deadline between cores
+	- Every effect's processing is timed, so the one taking up the callback's
+	  time can be found
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "callback_worker_pool.h"
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+/*
+    Parallel effect chains run on the file's channels. Edited on the message
+    thread; the audio thread passes its audio through untouched while a
+    branch is being changed.
+*/
+class EffectRack : private CallbackWorkerPool::Job,
+                   private AsyncUpdater
+{
+public:
+	enum {
+		maxBranches = 4,
+		maxEffectsPerBranch = 8
+	};
+
+	// Time one effect took over the last block it processed, and the worst so far
+	struct Timing
+	{
+		int branch = 0;
+		String name;
+		double lastMicros = 0.0;
+		double worstMicros = 0.0;
+		double loadPercent = 0.0;		// smoothed time as a % of the blocks' duration
+	};
+
+	explicit EffectRack(CallbackWorkerPool &workers);
+	~EffectRack();
+
+	// Sets the channel count, rate & largest block the effects run at, re-preparing them if
+	//   any of these change. Called off the message thread, the effects are re-prepared on it
+	//   shortly afterwards (until then the audio passes through dry).
+	void prepare(int numChannels, double sampleRate, int maxBlockSize);
+
+	// Editing (message thread). addBranch() returns the new branch's index, or -1 if there's
+	//   no room; addEffect() appends to the end of a branch's chain.
+	int getNumBranches() const;
+	int addBranch();
+	void removeBranch(int branch);
+	int getNumEffects(int branch) const;
+	String getEffectName(int branch, int index) const;
+	bool addEffect(int branch, std::unique_ptr<AudioProcessor> effect, String &error);
+	void removeEffect(int branch, int index);
+	void clear();
+
+	// Plugins (message thread): the types in a plugin file (a file can hold several), and a
+	//   new instance of one
+	void findPluginTypes(const File &file, OwnedArray<PluginDescription> &types);
+	std::unique_ptr<AudioProcessor> createPlugin(const PluginDescription &type, String &error);
+
+	// Audio thread: runs the buffer (which has the prepared channel count) through every
+	//   branch, in place
+	void process(AudioBuffer<float> &buffer);
+
+	// Per-effect timing, in branch order (message thread), and clearing the worst times
+	Array<Timing> getTimings() const;
+	void resetTimings();
+
+private:
+	class HostedEffect;
+	struct Branch;
+
+	// Redefinition of CallbackWorkerPool::Job method (one branch)
+	void processItem(int branch, int threadIndex) override;
+
+	// Redefinition of AsyncUpdater method
+	void handleAsyncUpdate() override;
+
+	// Private helper functions
+	void buildBranch(Branch &branch, std::vector<std::unique_ptr<AudioProcessor>> effects);
+	std::vector<std::unique_ptr<AudioProcessor>> takeEffects(Branch &branch);
+	void rebuildIfNeeded();
+	HostedEffect *getEffect(const Branch &branch, int index) const;
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	CallbackWorkerPool &workers_;
+	AudioPluginFormatManager pluginFormats_;
+
+	// The branches, and the lock held while they're changed (the audio thread only tries it)
+	OwnedArray<Branch> branches_;
+	CriticalSection lock_;
+
+	// What the effects are prepared for, and whether they still need preparing for it
+	int numChannels_;
+	double sampleRate_;
+	int maxBlockSize_;
+	std::atomic<bool> needsRebuild_;
+
+	// The block being processed, while the branches work on it
+	const AudioBuffer<float> *input_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EffectRack)
+};
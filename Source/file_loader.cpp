@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+  file_loader.cpp -- implementation of the player's background file loader
+
+  ==============================================================================
+*/
+
+#include "file_loader.h"
+
+namespace {
+	// Largest share of the machine's memory a file may be decoded into
+	const int maxPreloadMemoryFraction = 4;
+}
+
+//==============================================================================
+
+// Constructor
+FileLoader::FileLoader(AudioFormatManager &formatManager, TimeSliceThread &readAheadThread, Listener &listener)
+	: Thread("File loader"),
+	  formatManager_(formatManager),
+	  readAheadThread_(readAheadThread),
+	  listener_(listener),
+	  expectedBlockSize_(512),
+	  failed_(false),
+	  progress_(0.0),
+	  displayedProgress_(0.0)
+{
+}
+
+
+// Destructor
+FileLoader::~FileLoader()
+{
+	cancel();
+}
+
+
+/*
+ * Starts loading the given file in the background, abandoning any load already in progress
+ */
+void FileLoader::load(const File &file, const LoadOptions &options, int expectedBlockSize) {
+	cancel();
+
+	file_ = file;
+	options_ = options;
+	expectedBlockSize_ = jmax(1, expectedBlockSize);
+	progress_ = displayedProgress_ = 0.0;
+
+	startThread();
+}
+
+
+/*
+ * Stops the current load (if any) and throws away anything it produced
+ */
+void FileLoader::cancel() {
+	stopThread(5000);
+	cancelPendingUpdate();
+
+	const ScopedLock sl(resultLock_);
+	result_.reset();
+	failed_ = false;
+}
+
+
+/*
+ * True from the call to load() until the result has been delivered
+ */
+bool FileLoader::isLoading() const {
+	return isThreadRunning() || isUpdatePending();
+}
+
+
+double &FileLoader::getProgress() {
+	return displayedProgress_;
+}
+
+
+/*
+ * Loader thread: publishes how far the load has got, for the message thread to pick up
+ */
+void FileLoader::setProgress(double progress) {
+	progress_ = progress;
+	triggerAsyncUpdate();
+}
+
+
+/*
+ * Loader thread: builds the reader chain and primes the read-ahead buffer, checking for
+ *   cancellation between each step
+ */
+void FileLoader::run() {
+	auto loaded = openFile(formatManager_, file_, options_, &readAheadThread_);
+	setProgress(0.3);
+
+	if (threadShouldExit())
+		return;
+
+	if (loaded == nullptr) {
+		const ScopedLock sl(resultLock_);
+		failed_ = true;
+		triggerAsyncUpdate();
+		return;
+	}
+
+	loaded->readAheadSource.reset(new ReadAheadSource(loaded->readerSource.get(), readAheadThread_,
+		(int) (options_.readAheadSeconds * loaded->sampleRate), loaded->numChannels));
+	setProgress(0.5);
+
+	if (threadShouldExit())
+		return;
+
+	// Prime the buffer here rather than in setSource(), which would otherwise block the
+	//   message thread while the first part of the file is read
+	loaded->readAheadSource->prepareToPlay(expectedBlockSize_, loaded->sampleRate);
+	setProgress(1.0);
+
+	if (threadShouldExit())
+		return;
+
+	const ScopedLock sl(resultLock_);
+	result_ = std::move(loaded);
+	triggerAsyncUpdate();
+}
+
+
+/*
+ * Creates the reader & reader source for a file, trying the decoded copy in the cache and
+ *   then a memory-mapped reader first, and wrapping an unmapped one in a decode-to-RAM reader
+ *   or a block cache if requested
+ */
+std::unique_ptr<LoadedFile> FileLoader::openFile(AudioFormatManager &formatManager, const File &file,
+                                                 const LoadOptions &options, TimeSliceThread *backgroundThread) {
+	std::unique_ptr<LoadedFile> loaded(new LoadedFile());
+	loaded->file = file;
+
+	AudioFormatReader *reader = nullptr;
+
+	// A decoded copy from an earlier visit is always mapped; otherwise one is made for next time
+	if (options.decodedCache != nullptr && DecodedFileCache::shouldCache(formatManager, file)) {
+		File cached = options.decodedCache->findCachedFile(file);
+
+		if (cached != File())
+			reader = createMemoryMappedReader(formatManager, cached, *loaded);
+
+		if (reader != nullptr)
+			loaded->isFromDecodedCache = true;
+		else
+			options.decodedCache->addFile(file);
+	}
+
+	if (reader == nullptr && options.useMemoryMapping)
+		reader = createMemoryMappedReader(formatManager, file, *loaded);
+
+	if (reader == nullptr)
+		reader = formatManager.createReaderFor(file);
+
+	if (reader == nullptr)
+		return nullptr;
+
+	// The layout comes from the file's own reader (the readers wrapped around it below don't
+	//   pass it on)
+	loaded->channelLayout = reader->getChannelLayout();
+
+	// A mapped file (including a decoded copy) is already in memory, so it needs neither and
+	//   is scrubbed from the mapping; one too large to decode falls back to the cache
+	const size_t memoryLimit = (size_t) SystemStats::getMemorySizeInMegabytes() * 1024 * 1024 / maxPreloadMemoryFraction;
+
+	if (loaded->isMemoryMapped) {
+		loaded->mappedScrubSource.reset(new ScrubProcessor::MappedSource(*static_cast<MemoryMappedAudioFormatReader *>(reader)));
+		loaded->scrubSource = loaded->mappedScrubSource.get();
+	}
+	else if (options.preloadToMemory && PreloadedReader::getBytesNeeded(*reader) <= memoryLimit) {
+		loaded->preloaded = new PreloadedReader(formatManager, file, reader);
+		loaded->scrubSource = loaded->preloaded;
+		reader = loaded->preloaded;
+	}
+	else if (options.blockCacheBytes > 0 && backgroundThread != nullptr) {
+		loaded->blockCache = new BlockCacheReader(reader, *backgroundThread, options.blockCacheBytes);
+		loaded->scrubSource = loaded->blockCache;
+		reader = loaded->blockCache;
+	}
+
+	loaded->sampleRate = reader->sampleRate;
+	loaded->numChannels = (int) reader->numChannels;
+	loaded->lengthInSamples = reader->lengthInSamples;
+	loaded->readerSource.reset(new AudioFormatReaderSource(reader, true));
+	return loaded;
+}
+
+
+/*
+ * Tries to open the file with a memory-mapped reader and map its sample data. Returns
+ *   nullptr if the format can't be mapped (e.g. it's compressed) or the mapping fails, in
+ *   which case the caller falls back to a normal streaming reader.
+ */
+AudioFormatReader *FileLoader::createMemoryMappedReader(AudioFormatManager &formatManager, const File &file,
+                                                         LoadedFile &loaded) {
+	auto *format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+	if (format == nullptr)
+		return nullptr;
+
+	std::unique_ptr<MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(file));
+
+	if (reader == nullptr || !reader->mapEntireFile())
+		return nullptr;
+
+	loaded.isMemoryMapped = true;
+	loaded.mappedBytes = reader->getNumBytesUsed();
+	return reader.release();
+}
+
+
+/*
+ * Message thread: takes up the latest progress, and hands the finished (or failed) load to
+ *   the listener
+ */
+void FileLoader::handleAsyncUpdate() {
+	std::unique_ptr<LoadedFile> loaded;
+	bool failed;
+
+	displayedProgress_ = progress_.load();
+
+	{
+		const ScopedLock sl(resultLock_);
+		loaded = std::move(result_);
+		failed = failed_;
+		failed_ = false;
+	}
+
+	if (loaded != nullptr)
+		listener_.fileLoaded(std::move(loaded));
+	else if (failed)
+		listener_.fileLoadFailed(file_);
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+  file_loader.h -- interface for the player's background file loader
+	- Creates the reader, reader source and read-ahead buffer for a file on
+	  its own thread, and primes the buffer before handing it over
+	- The finished file is delivered to a listener on the message thread
+	- Optionally opens uncompressed files with a memory-mapped reader, falling
+	  back to a streaming reader for formats that don't support it
+	- Optionally puts a decoded-block cache between the reader and the rest of
+	  the chain, for fast seeking (mapped files are already in memory, and are
+	  scrubbed straight from the mapping)
+	- Optionally decodes the whole file into memory in the background instead
+	  (for compressed formats), if there's room for it
+	- Optionally maps a decoded copy of the file from the on-disk cache, or
+	  has one written for next time
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "block_cache_reader.h"
+#include "decoded_file_cache.h"
+#include "preloaded_reader.h"
+#include "read_ahead_source.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Everything needed to play one file. Members are destroyed in reverse order,
+    so the read-ahead buffer goes before the reader source it refers to.
+*/
+struct LoadedFile
+{
+	File file;
+	double sampleRate = 0.0;
+	int numChannels = 0;
+	int64 lengthInSamples = 0;
+
+	// Speaker layout, as the file records it (or JUCE's usual layout for the channel count
+	//   if the format doesn't say)
+	AudioChannelSet channelLayout;
+
+	// Set when the samples are read straight out of a mapped view of the file, or of its
+	//   decoded copy in the cache
+	bool isMemoryMapped = false;
+	bool isFromDecodedCache = false;
+	size_t mappedBytes = 0;
+
+	// Decoded-block cache or decode-to-RAM reader, if either is in use (owned by the
+	//   reader source), and whichever of them (or the mapping itself) can be read for
+	//   scrubbing
+	BlockCacheReader *blockCache = nullptr;
+	PreloadedReader *preloaded = nullptr;
+	std::unique_ptr<ScrubProcessor::MappedSource> mappedScrubSource;
+	ScrubProcessor::Source *scrubSource = nullptr;
+
+	std::unique_ptr<AudioFormatReaderSource> readerSource;
+	std::unique_ptr<ReadAheadSource> readAheadSource;
+
+	// The source to play from: the read-ahead buffer if there is one, otherwise the reader
+	PositionableAudioSource *getPlaybackSource() const {
+		return readAheadSource != nullptr ? (PositionableAudioSource *) readAheadSource.get()
+		                                  : (PositionableAudioSource *) readerSource.get();
+	}
+};
+
+
+//==============================================================================
+/*
+    How files should be opened.
+*/
+struct LoadOptions
+{
+	double readAheadSeconds = 2.0;
+	bool useMemoryMapping = false;
+	size_t blockCacheBytes = 0;		// 0 = no decoded-block cache
+	bool preloadToMemory = false;	// replaces the block cache for files that aren't mapped
+	DecodedFileCache *decodedCache = nullptr;	// not owned; nullptr = no on-disk cache
+};
+
+
+//==============================================================================
+/*
+    Loads one file at a time on a background thread. Starting a new load or
+    calling cancel() abandons the one in progress.
+*/
+class FileLoader : private Thread,
+                   private AsyncUpdater
+{
+public:
+	// Receives the results of a load on the message thread
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+		virtual void fileLoaded(std::unique_ptr<LoadedFile> loadedFile) = 0;
+		virtual void fileLoadFailed(const File &file) = 0;
+	};
+
+	FileLoader(AudioFormatManager &formatManager, TimeSliceThread &readAheadThread, Listener &listener);
+	~FileLoader();
+
+	// Starts loading a file with the given options
+	void load(const File &file, const LoadOptions &options, int expectedBlockSize);
+	void cancel();
+	bool isLoading() const;
+
+	// Progress of the current load, from 0 to 1 (suitable for a ProgressBar). This is the
+	//   message thread's copy, updated as the loader thread finishes each step.
+	double &getProgress();
+
+	// Opens a file synchronously, without a read-ahead buffer (for offline use). The block
+	//   cache is only used if a thread is given for it to prefetch on. Returns nullptr if
+	//   the file can't be read.
+	static std::unique_ptr<LoadedFile> openFile(AudioFormatManager &formatManager, const File &file,
+	                                            const LoadOptions &options,
+	                                            TimeSliceThread *backgroundThread = nullptr);
+
+private:
+	// Redefinitions of Thread & AsyncUpdater methods
+	void run() override;
+	void handleAsyncUpdate() override;
+
+	// Private helper functions
+	void setProgress(double progress);
+	static AudioFormatReader *createMemoryMappedReader(AudioFormatManager &formatManager, const File &file,
+	                                                   LoadedFile &loaded);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	AudioFormatManager &formatManager_;
+	TimeSliceThread &readAheadThread_;
+	Listener &listener_;
+
+	// Request (written before the thread starts)
+	File file_;
+	LoadOptions options_;
+	int expectedBlockSize_;
+
+	// Result (handed from the loader thread to the message thread)
+	CriticalSection resultLock_;
+	std::unique_ptr<LoadedFile> result_;
+	bool failed_;
+
+	// Progress written by the loader thread, and the copy the message thread shows
+	std::atomic<double> progress_;
+	double displayedProgress_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileLoader)
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+  gain_noise_processor.cpp -- implementation of the volume & white noise stage
+
+  ==============================================================================
+*/
+
+#include "gain_noise_processor.h"
+
+namespace {
+	// Noise is only generated when it can actually be heard
+	bool isSilent(const PlayerParameters::Ramp &noise) {
+		return noise.start == 0.0f && noise.end == 0.0f;
+	}
+}
+
+//==============================================================================
+
+// Constructor
+BlockNoiseGenerator::BlockNoiseGenerator(uint32 seed)
+{
+	setSeed(seed);
+}
+
+
+/*
+ * Seeds every lane from a single value (an LCG spreads it out so the lanes don't correlate)
+ */
+void BlockNoiseGenerator::setSeed(uint32 seed) {
+	uint32 state = seed;
+
+	for (int lane = 0; lane < numLanes; lane++) {
+		state = state * 1664525u + 1013904223u;
+		lanes_[lane] = (state != 0) ? state : 1u;
+	}
+}
+
+
+/*
+ * Fills dest with uniform noise in [0, 1). The inner loop has no dependencies between lanes,
+ *   so it compiles to vector shifts/xors; the top 24 bits of each state become the float.
+ */
+void BlockNoiseGenerator::fill(float *dest, int numSamples) {
+	const float scale = 1.0f / 16777216.0f;
+	int sample = 0;
+
+	for (; sample + numLanes <= numSamples; sample += numLanes) {
+		for (int lane = 0; lane < numLanes; lane++) {
+			uint32 x = lanes_[lane];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			lanes_[lane] = x;
+			dest[sample + lane] = (float) (int32) (x >> 8) * scale;
+		}
+	}
+
+	// Leftover samples only advance the lanes they use
+	for (int lane = 0; sample < numSamples; sample++, lane++) {
+		uint32 x = lanes_[lane];
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		lanes_[lane] = x;
+		dest[sample] = (float) (int32) (x >> 8) * scale;
+	}
+}
+
+
+//==============================================================================
+
+// Constructor
+GainNoiseProcessor::GainNoiseProcessor()
+	: capacity_(0)
+{
+	setSeed(0x2545f491);
+}
+
+
+/*
+ * Allocates scratch space for blocks of up to maximumBlockSize samples, for each thread that
+ *   might process a channel. Larger blocks still work - they're just processed in several
+ *   pieces.
+ */
+void GainNoiseProcessor::prepare(int maximumBlockSize) {
+	capacity_ = jmax(1, maximumBlockSize);
+	noise_.allocate((size_t) capacity_ * maxThreads, true);
+	gains_.allocate((size_t) capacity_ * maxThreads, true);
+}
+
+
+/*
+ * Seeds each channel's generator from the one value (the golden ratio spreads the seeds out)
+ */
+void GainNoiseProcessor::setSeed(uint32 seed) {
+	for (int channel = 0; channel < maxChannels; channel++)
+		generators_[channel].setSeed(seed + (uint32) channel * 0x9e3779b9u);
+}
+
+
+/*
+ * Processes the region with the implementation chosen at build time
+ */
+void GainNoiseProcessor::process(AudioBuffer<float> &buffer, int startSample, int numSamples,
+                                 const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise) {
+	for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+		processChannel(buffer.getWritePointer(channel, startSample), channel, numSamples, volume, noise);
+}
+
+
+void GainNoiseProcessor::processChannel(float *data, int channel, int numSamples, const PlayerParameters::Ramp &volume,
+                                        const PlayerParameters::Ramp &noise, int threadIndex) {
+#if SFP_SCALAR_GAIN_NOISE
+	processChannelScalar(data, channel, numSamples, volume, noise, threadIndex);
+#else
+	processChannelVectorized(data, channel, numSamples, volume, noise, threadIndex);
+#endif
+}
+
+
+void GainNoiseProcessor::processVectorized(AudioBuffer<float> &buffer, int startSample, int numSamples,
+                                           const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise) {
+	for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+		processChannelVectorized(buffer.getWritePointer(channel, startSample), channel, numSamples, volume, noise, 0);
+}
+
+
+void GainNoiseProcessor::processScalar(AudioBuffer<float> &buffer, int startSample, int numSamples,
+                                       const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise) {
+	for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+		processChannelScalar(buffer.getWritePointer(channel, startSample), channel, numSamples, volume, noise, 0);
+}
+
+
+/*
+ * Builds one gain per sample in the thread's gains and multiplies the channel by it. When
+ *   neither parameter is ramping the gain is an affine function of the noise, so it's two
+ *   vector ops.
+ */
+void GainNoiseProcessor::processChannelVectorized(float *data, int channel, int numSamples,
+                                                  const PlayerParameters::Ramp &volume,
+                                                  const PlayerParameters::Ramp &noise, int threadIndex) {
+	jassert(capacity_ > 0 && isPositiveAndBelow(threadIndex, (int) maxThreads));
+
+	auto &generator = generators_[channel % maxChannels];
+	float *randomValues = noise_ + (size_t) threadIndex * (size_t) capacity_;
+	float *gains = gains_ + (size_t) threadIndex * (size_t) capacity_;
+
+	for (int offset = 0; offset < numSamples; offset += capacity_) {
+		const int num = jmin(capacity_, numSamples - offset);
+
+		// Volume only: no noise to generate
+		if (isSilent(noise)) {
+			if (!volume.isRamping()) {
+				FloatVectorOperations::multiply(data + offset, volume.end, num);
+			}
+			else {
+				const float step = (volume.end - volume.start) / (float) numSamples;
+				for (int sample = 0; sample < num; sample++)
+					gains[sample] = volume.start + step * (float) (offset + sample);
+
+				FloatVectorOperations::multiply(data + offset, gains, num);
+			}
+			continue;
+		}
+
+		generator.fill(randomValues, num);
+		computeGains(gains, randomValues, offset, num, numSamples, volume, noise);
+		FloatVectorOperations::multiply(data + offset, gains, num);
+	}
+}
+
+
+/*
+ * Reference implementation: one sample at a time, in the same order as the original loop
+ */
+void GainNoiseProcessor::processChannelScalar(float *data, int channel, int numSamples,
+                                              const PlayerParameters::Ramp &volume,
+                                              const PlayerParameters::Ramp &noise, int threadIndex) {
+	jassert(capacity_ > 0 && isPositiveAndBelow(threadIndex, (int) maxThreads));
+
+	auto &generator = generators_[channel % maxChannels];
+	float *randomValues = noise_ + (size_t) threadIndex * (size_t) capacity_;
+
+	const float volumeStep = (volume.end - volume.start) / (float) numSamples;
+	const float noiseStep = (noise.end - noise.start) / (float) numSamples;
+	const bool silent = isSilent(noise);
+
+	for (int offset = 0; offset < numSamples; offset += capacity_) {
+		const int num = jmin(capacity_, numSamples - offset);
+
+		if (!silent)
+			generator.fill(randomValues, num);
+
+		for (int sample = 0; sample < num; sample++) {
+			float index = (float) (offset + sample);
+			float volumeLevel = volume.start + volumeStep * index;
+			float noiseLevel = noise.start + noiseStep * index;
+
+			data[offset + sample] *= volumeLevel;
+			if (!silent)
+				data[offset + sample] *= (1 - noiseLevel + noiseLevel * randomValues[sample]);
+		}
+	}
+}
+
+
+/*
+ * Fills gains for samples [offset, offset + numSamples) of a block of rampLength samples
+ */
+void GainNoiseProcessor::computeGains(float *gains, const float *randomValues, int offset, int numSamples,
+                                      int rampLength, const PlayerParameters::Ramp &volume,
+                                      const PlayerParameters::Ramp &noise) {
+	if (!volume.isRamping() && !noise.isRamping()) {
+		// gain = volume * (1 - noise) + (volume * noise) * random
+		FloatVectorOperations::copyWithMultiply(gains, randomValues, volume.end * noise.end, numSamples);
+		FloatVectorOperations::add(gains, volume.end * (1.0f - noise.end), numSamples);
+		return;
+	}
+
+	const float volumeStep = (volume.end - volume.start) / (float) rampLength;
+	const float noiseStep = (noise.end - noise.start) / (float) rampLength;
+
+	for (int sample = 0; sample < numSamples; sample++) {
+		float index = (float) (offset + sample);
+		float volumeLevel = volume.start + volumeStep * index;
+		float noiseLevel = noise.start + noiseStep * index;
+		gains[sample] = volumeLevel * (1.0f - noiseLevel + noiseLevel * randomValues[sample]);
+	}
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+  gain_noise_processor.h -- interface for the volume & white noise stage
+	- Noise is generated a block at a time by a multi-lane xorshift generator
+	  that the compiler can vectorize
+	- Gain is applied with FloatVectorOperations; a per-sample scalar version
+	  is kept as the reference implementation (and can be forced at build time
+	  with SFP_SCALAR_GAIN_NOISE=1)
+	- Each channel has its own noise generator and each thread its own scratch
+	  space, so different channels can be processed on different threads
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "player_parameters.h"
+
+#ifndef SFP_SCALAR_GAIN_NOISE
+ #define SFP_SCALAR_GAIN_NOISE 0
+#endif
+
+//==============================================================================
+/*
+    Uniform [0, 1) noise generator made of several independent xorshift32
+    generators, interleaved so that each group of samples can be computed in
+    parallel.
+*/
+class BlockNoiseGenerator
+{
+public:
+	enum { numLanes = 8 };
+
+	explicit BlockNoiseGenerator(uint32 seed = 0x2545f491);
+
+	void setSeed(uint32 seed);
+	void fill(float *dest, int numSamples);
+
+private:
+	uint32 lanes_[numLanes];
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockNoiseGenerator)
+};
+
+
+//==============================================================================
+/*
+    Applies the player's volume and noise to a buffer:
+        out = in * volume * (1 - noise + noise * random)
+    where volume and noise ramp linearly across the block.
+*/
+class GainNoiseProcessor
+{
+public:
+	enum {
+		maxChannels = 64,	// channels beyond this share generators with the ones below it
+		maxThreads = 4
+	};
+
+	GainNoiseProcessor();
+
+	// Allocates the scratch buffers for every thread (message thread)
+	void prepare(int maximumBlockSize);
+	void setSeed(uint32 seed);
+
+	// Audio thread: processes the region using the selected implementation
+	void process(AudioBuffer<float> &buffer, int startSample, int numSamples,
+	             const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise);
+
+	// Processes one channel with the scratch space of the given thread (0 to maxThreads - 1).
+	//   Different channels can be processed at the same time on different threads.
+	void processChannel(float *data, int channel, int numSamples, const PlayerParameters::Ramp &volume,
+	                    const PlayerParameters::Ramp &noise, int threadIndex = 0);
+
+	// Explicit implementations (both draw the same noise, so their outputs match)
+	void processVectorized(AudioBuffer<float> &buffer, int startSample, int numSamples,
+	                       const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise);
+	void processScalar(AudioBuffer<float> &buffer, int startSample, int numSamples,
+	                   const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise);
+
+private:
+	// Private helper functions
+	void processChannelVectorized(float *data, int channel, int numSamples, const PlayerParameters::Ramp &volume,
+	                              const PlayerParameters::Ramp &noise, int threadIndex);
+	void processChannelScalar(float *data, int channel, int numSamples, const PlayerParameters::Ramp &volume,
+	                          const PlayerParameters::Ramp &noise, int threadIndex);
+	static void computeGains(float *gains, const float *randomValues, int offset, int numSamples, int rampLength,
+	                         const PlayerParameters::Ramp &volume, const PlayerParameters::Ramp &noise);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	BlockNoiseGenerator generators_[maxChannels];
+	HeapBlock<float> noise_;		// capacity_ samples per thread
+	HeapBlock<float> gains_;
+	int capacity_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainNoiseProcessor)
+};
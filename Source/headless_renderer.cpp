@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+  headless_renderer.cpp -- implementation of the player's offline render mode
+
+  ==============================================================================
+*/
+
+#include "headless_renderer.h"
+#include "playback_engine.h"
+#include <iostream>
+
+namespace {
+	// Parses "linear", "cubic", "sinc16" or "sinc64" (anything else gives the best quality)
+	PolyphaseResampler::Quality parseQuality(const String &name) {
+		if (name == "linear")	return PolyphaseResampler::Linear;
+		if (name == "cubic")	return PolyphaseResampler::Cubic;
+		if (name == "sinc16")	return PolyphaseResampler::Sinc16;
+		return PolyphaseResampler::Sinc64;
+	}
+}
+
+//==============================================================================
+
+/*
+ * Renders settings.input through a PlaybackEngine into settings.output. The file is read
+ *   without a read-ahead buffer: there's no deadline to meet, so blocking reads are fine
+ *   and no block can ever be dropped.
+ */
+HeadlessRenderer::Result HeadlessRenderer::render(const Settings &settings) {
+	Result result;
+
+	AudioFormatManager formatManager;
+	formatManager.registerBasicFormats();
+
+	LoadOptions options;
+	options.useMemoryMapping = settings.useMemoryMapping;
+
+	auto loaded = FileLoader::openFile(formatManager, settings.input, options);
+	if (loaded == nullptr) {
+		result.errorMessage = "Couldn't read " + settings.input.getFullPathName();
+		return result;
+	}
+
+	const double sampleRate = settings.sampleRate > 0.0 ? settings.sampleRate : loaded->sampleRate;
+	const int numChannels = jmax(1, loaded->numChannels);
+	const int blockSize = jmax(1, settings.blockSize);
+	const int64 totalSamples = (int64) (loaded->lengthInSamples * sampleRate / loaded->sampleRate);
+
+	// Create the writer (it takes ownership of the stream if it succeeds)
+	settings.output.deleteFile();
+	std::unique_ptr<FileOutputStream> stream(settings.output.createOutputStream());
+	std::unique_ptr<AudioFormatWriter> writer;
+
+	if (stream != nullptr)
+		writer.reset(WavAudioFormat().createWriterFor(stream.get(), sampleRate, (unsigned int) numChannels,
+		                                              settings.bitsPerSample, {}, 0));
+
+	if (writer == nullptr) {
+		result.errorMessage = "Couldn't write " + settings.output.getFullPathName();
+		return result;
+	}
+	stream.release();
+
+	// Set up the same chain the live player uses
+	PlaybackEngine engine;
+	engine.getParameters().setValue(PlayerParameters::Volume, settings.volume);
+	engine.getParameters().setValue(PlayerParameters::Noise, settings.noise);
+	engine.setResamplerQuality(settings.resamplerQuality);
+	engine.prepareToPlay(blockSize, sampleRate);
+	engine.setFile(std::move(loaded));
+	engine.start(false);
+
+	AudioBuffer<float> buffer(numChannels, blockSize);
+	int64 samplesWritten = 0;
+	const int64 startTicks = Time::getHighResolutionTicks();
+
+	while (samplesWritten < totalSamples) {
+		AudioSourceChannelInfo info(&buffer, 0, blockSize);
+		engine.getNextAudioBlock(info);
+
+		const int numToWrite = (int) jmin((int64) blockSize, totalSamples - samplesWritten);
+		if (!writer->writeFromAudioSampleBuffer(buffer, 0, numToWrite)) {
+			result.errorMessage = "Write failed for " + settings.output.getFullPathName();
+			return result;
+		}
+		samplesWritten += numToWrite;
+	}
+
+	writer->flush();
+	const int64 endTicks = Time::getHighResolutionTicks();
+
+	engine.stop();
+	engine.releaseResources();
+
+	result.succeeded = true;
+	result.numSamples = samplesWritten;
+	result.numChannels = numChannels;
+	result.audioSeconds = (double) samplesWritten / sampleRate;
+	result.wallSeconds = Time::highResolutionTicksToSeconds(endTicks - startTicks);
+	return result;
+}
+
+
+/*
+ * Reads the processing options shared by every command-line mode that renders (everything
+ *   but the input & output)
+ */
+HeadlessRenderer::Settings HeadlessRenderer::parseSettings(const StringArray &args, int defaultBlockSize) {
+	Settings settings;
+	settings.volume = getOptionValue(args, "--volume", "1.0").getFloatValue();
+	settings.noise = getOptionValue(args, "--noise", "0.0").getFloatValue();
+	settings.blockSize = getOptionValue(args, "--block-size", String(defaultBlockSize)).getIntValue();
+	settings.sampleRate = getOptionValue(args, "--sample-rate", "0").getDoubleValue();
+	settings.bitsPerSample = getOptionValue(args, "--bits", "24").getIntValue();
+	settings.useMemoryMapping = args.contains("--mmap");
+	settings.resamplerQuality = parseQuality(getOptionValue(args, "--quality", "sinc64"));
+	return settings;
+}
+
+
+/*
+ * Returns the value following an option (e.g. "--volume 0.5"), or fallback if absent
+ */
+String HeadlessRenderer::getOptionValue(const StringArray &args, const String &option, const String &fallback) {
+	int index = args.indexOf(option);
+	return (index >= 0 && index + 1 < args.size()) ? args[index + 1] : fallback;
+}
+
+
+/*
+ * Parses the render options, renders, and prints the timing report to stdout
+ */
+int HeadlessRenderer::runFromCommandLine(const StringArray &args) {
+	int index = args.indexOf("--render");
+
+	if (index < 0 || index + 2 >= args.size() || args[index + 1].startsWith("--")) {
+		std::cerr << getUsage() << std::endl;
+		return 1;
+	}
+
+	Settings settings = parseSettings(args);
+	settings.input = File::getCurrentWorkingDirectory().getChildFile(args[index + 1].unquoted());
+	settings.output = File::getCurrentWorkingDirectory().getChildFile(args[index + 2].unquoted());
+
+	auto result = render(settings);
+
+	if (!result.succeeded) {
+		std::cerr << result.errorMessage << std::endl;
+		return 1;
+	}
+
+	std::cout << "Rendered " << settings.input.getFileName() << " -> " << settings.output.getFullPathName() << std::endl
+	          << "  audio:      " << String(result.audioSeconds, 3) << " s ("
+	          << result.numSamples << " samples x " << result.numChannels << " ch)" << std::endl
+	          << "  wall time:  " << String(result.wallSeconds, 3) << " s" << std::endl
+	          << "  realtime:   " << String(result.getRealtimeFactor(), 1) << "x" << std::endl
+	          << "  throughput: " << String(result.getSamplesPerSecond() / 1.0e6, 2) << " Msamples/s" << std::endl;
+	return 0;
+}
+
+
+String HeadlessRenderer::getUsage() {
+	return "Usage: SoundFilePlayer --render <input> <output.wav> [--volume 0-1] [--noise 0-1]\n"
+	       "                       [--block-size n] [--sample-rate hz] [--bits 16|24|32] [--mmap]\n"
+	       "                       [--quality linear|cubic|sinc16|sinc64]";
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+  headless_renderer.h -- interface for the player's offline render mode
+	- Pulls a file through the same PlaybackEngine used for live playback,
+	  as fast as possible, and writes the result to a WAV file
+	- Needs no audio device, so it runs on headless machines
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "polyphase_resampler.h"
+
+//==============================================================================
+/*
+    Renders a file through the player's processing chain without an audio device.
+*/
+class HeadlessRenderer
+{
+public:
+	struct Settings
+	{
+		File input;
+		File output;
+		float volume = 1.0f;
+		float noise = 0.0f;
+		int blockSize = 512;
+		double sampleRate = 0.0;	// 0 = use the input file's rate
+		int bitsPerSample = 24;
+		bool useMemoryMapping = false;
+		PolyphaseResampler::Quality resamplerQuality = PolyphaseResampler::Sinc64;
+	};
+
+	struct Result
+	{
+		bool succeeded = false;
+		String errorMessage;
+		int64 numSamples = 0;		// per channel
+		int numChannels = 0;
+		double audioSeconds = 0.0;
+		double wallSeconds = 0.0;
+
+		double getRealtimeFactor() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+		double getSamplesPerSecond() const { return wallSeconds > 0.0 ? (double) (numSamples * numChannels) / wallSeconds : 0.0; }
+	};
+
+	// Renders the input file to the output file with the given settings
+	static Result render(const Settings &settings);
+
+	// Command-line entry point ("--render <input> <output.wav> [options]"); returns the
+	//   process exit code
+	static int runFromCommandLine(const StringArray &args);
+	static String getUsage();
+
+	// Command-line parsing shared with the other modes: the processing options (--volume,
+	//   --noise, --block-size, --sample-rate, --bits, --mmap, --quality), and the value
+	//   following any option
+	static Settings parseSettings(const StringArray &args, int defaultBlockSize = 512);
+	static String getOptionValue(const StringArray &args, const String &option, const String &fallback);
+};
@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+  internal_effects.cpp -- implementation of the player's built-in effects
+
+  ==============================================================================
+*/
+
+#include "internal_effects.h"
+
+namespace {
+	// Filter cutoff, delay time & feedback, and how much of the delay is added to the input
+	const double lowPassHz = 2000.0;
+	const double delaySeconds = 0.375;
+	const float delayFeedback = 0.4f;
+	const float delayMix = 0.35f;
+
+	//==============================================================================
+	/*
+	    Second-order low-pass filter on every channel.
+	*/
+	class LowPassEffect : public InternalEffect
+	{
+	public:
+		LowPassEffect() : InternalEffect(0.0) {}
+
+		const String getName() const override {
+			return getTypeName(LowPass);
+		}
+
+		void prepareToPlay(double sampleRate, int) override {
+			filters_.clear();
+			for (int channel = 0; channel < getTotalNumOutputChannels(); channel++) {
+				auto *filter = filters_.add(new IIRFilter());
+				filter->setCoefficients(IIRCoefficients::makeLowPass(sampleRate, lowPassHz));
+			}
+		}
+
+		void releaseResources() override {
+			filters_.clear();
+		}
+
+		void processBlock(AudioBuffer<float> &buffer, MidiBuffer &) override {
+			const ScopedNoDenormals noDenormals;
+
+			for (int channel = 0; channel < jmin(buffer.getNumChannels(), filters_.size()); channel++)
+				filters_[channel]->processSamples(buffer.getWritePointer(channel), buffer.getNumSamples());
+		}
+
+	private:
+		OwnedArray<IIRFilter> filters_;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LowPassEffect)
+	};
+
+	//==============================================================================
+	/*
+	    Feedback delay on every channel, added to the dry signal.
+	*/
+	class DelayEffect : public InternalEffect
+	{
+	public:
+		DelayEffect() : InternalEffect(delaySeconds * 12.0), position_(0) {}
+
+		const String getName() const override {
+			return getTypeName(Delay);
+		}
+
+		void prepareToPlay(double sampleRate, int) override {
+			line_.setSize(jmax(1, getTotalNumOutputChannels()), jmax(1, roundToInt(delaySeconds * sampleRate)));
+			line_.clear();
+			position_ = 0;
+		}
+
+		void releaseResources() override {
+			line_.setSize(0, 0);
+		}
+
+		void processBlock(AudioBuffer<float> &buffer, MidiBuffer &) override {
+			const ScopedNoDenormals noDenormals;
+			const int length = line_.getNumSamples();
+			int position = position_;
+
+			for (int channel = 0; channel < jmin(buffer.getNumChannels(), line_.getNumChannels()); channel++) {
+				auto *data = buffer.getWritePointer(channel);
+				auto *line = line_.getWritePointer(channel);
+				position = position_;
+
+				for (int sample = 0; sample < buffer.getNumSamples(); sample++) {
+					const float delayed = line[position];
+					line[position] = data[sample] + delayed * delayFeedback;
+					data[sample] += delayed * delayMix;
+
+					if (++position == length)
+						position = 0;
+				}
+			}
+
+			position_ = position;
+		}
+
+	private:
+		AudioBuffer<float> line_;
+		int position_;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayEffect)
+	};
+
+	//==============================================================================
+	/*
+	    JUCE's reverb, run on each pair of channels (and on the last one alone if
+	    there's an odd number).
+	*/
+	class ReverbEffect : public InternalEffect
+	{
+	public:
+		ReverbEffect() : InternalEffect(5.0) {}
+
+		const String getName() const override {
+			return getTypeName(Reverb);
+		}
+
+		void prepareToPlay(double sampleRate, int) override {
+			reverbs_.clear();
+			for (int channel = 0; channel < getTotalNumOutputChannels(); channel += 2) {
+				auto *reverb = reverbs_.add(new juce::Reverb());
+				reverb->setSampleRate(sampleRate);
+				reverb->setParameters(juce::Reverb::Parameters());
+			}
+		}
+
+		void releaseResources() override {
+			reverbs_.clear();
+		}
+
+		void processBlock(AudioBuffer<float> &buffer, MidiBuffer &) override {
+			const ScopedNoDenormals noDenormals;
+			const int numChannels = jmin(buffer.getNumChannels(), reverbs_.size() * 2);
+
+			for (int channel = 0; channel < numChannels; channel += 2) {
+				auto *reverb = reverbs_[channel / 2];
+
+				if (channel + 1 < numChannels)
+					reverb->processStereo(buffer.getWritePointer(channel), buffer.getWritePointer(channel + 1),
+						buffer.getNumSamples());
+				else
+					reverb->processMono(buffer.getWritePointer(channel), buffer.getNumSamples());
+			}
+		}
+
+	private:
+		OwnedArray<juce::Reverb> reverbs_;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReverbEffect)
+	};
+}
+
+//==============================================================================
+
+// Constructor
+InternalEffect::InternalEffect(double tailSeconds, int numChannels)
+	: AudioProcessor(BusesProperties().withInput("Input", AudioChannelSet::canonicalChannelSet(numChannels))
+	                                  .withOutput("Output", AudioChannelSet::canonicalChannelSet(numChannels))),
+	  tailSeconds_(tailSeconds)
+{
+}
+
+
+String InternalEffect::getTypeName(Type type) {
+	switch (type) {
+		case LowPass:	return "Low-pass " + String(lowPassHz / 1000.0, 0) + " kHz";
+		case Delay:		return "Delay " + String(roundToInt(delaySeconds * 1000.0)) + " ms";
+		case Reverb:	return "Reverb";
+		default:		return {};
+	}
+}
+
+
+std::unique_ptr<AudioProcessor> InternalEffect::create(Type type) {
+	switch (type) {
+		case LowPass:	return std::unique_ptr<AudioProcessor>(new LowPassEffect());
+		case Delay:		return std::unique_ptr<AudioProcessor>(new DelayEffect());
+		case Reverb:	return std::unique_ptr<AudioProcessor>(new ReverbEffect());
+		default:		return nullptr;
+	}
+}
+
+
+/*
+ * Any channel count, as long as the output matches the input
+ */
+bool InternalEffect::isBusesLayoutSupported(const BusesLayout &layouts) const {
+	const auto &input = layouts.getMainInputChannelSet();
+	return !input.isDisabled() && input == layouts.getMainOutputChannelSet();
+}
+
+
+double InternalEffect::getTailLengthSeconds() const {
+	return tailSeconds_;
+}
+
+
+bool InternalEffect::acceptsMidi() const {
+	return false;
+}
+
+
+bool InternalEffect::producesMidi() const {
+	return false;
+}
+
+
+AudioProcessorEditor *InternalEffect::createEditor() {
+	return nullptr;
+}
+
+
+bool InternalEffect::hasEditor() const {
+	return false;
+}
+
+
+int InternalEffect::getNumPrograms() {
+	return 1;
+}
+
+
+int InternalEffect::getCurrentProgram() {
+	return 0;
+}
+
+
+void InternalEffect::setCurrentProgram(int) {
+}
+
+
+const String InternalEffect::getProgramName(int) {
+	return {};
+}
+
+
+void InternalEffect::changeProgramName(int, const String &) {
+}
+
+
+void InternalEffect::getStateInformation(MemoryBlock &) {
+}
+
+
+void InternalEffect::setStateInformation(const void *, int) {
+}
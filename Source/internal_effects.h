@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+  internal_effects.h -- interface for the player's built-in effects
+	- AudioProcessors that go in the effect rack alongside plugins (see
+	  effect_rack.h): a low-pass filter, a feedback delay and a reverb, each
+	  with fixed settings
+	- Each one takes any number of channels, as long as there are as many
+	  outputs as inputs
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Base class of the processors the player provides itself: everything but
+    the processing (no editor, MIDI, programs or saved state). The buses start
+    out with numChannels channels.
+*/
+class InternalEffect : public AudioProcessor
+{
+public:
+	enum Type {
+		LowPass = 0,
+		Delay,
+		Reverb,
+		NumTypes
+	};
+
+	static String getTypeName(Type type);
+	static std::unique_ptr<AudioProcessor> create(Type type);
+
+	// Redefinitions of AudioProcessor methods
+	bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
+	double getTailLengthSeconds() const override;
+	bool acceptsMidi() const override;
+	bool producesMidi() const override;
+	AudioProcessorEditor *createEditor() override;
+	bool hasEditor() const override;
+	int getNumPrograms() override;
+	int getCurrentProgram() override;
+	void setCurrentProgram(int index) override;
+	const String getProgramName(int index) override;
+	void changeProgramName(int index, const String &newName) override;
+	void getStateInformation(MemoryBlock &destData) override;
+	void setStateInformation(const void *data, int sizeInBytes) override;
+
+protected:
+	InternalEffect(double tailSeconds, int numChannels = 2);
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	double tailSeconds_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InternalEffect)
+};
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+  level_meter.cpp -- implementation of the player's output level meter
+
+  ==============================================================================
+*/
+
+#include "level_meter.h"
+
+namespace {
+	// Bottom of the scale, and how fast a bar falls back towards it
+	const float minimumDb = -60.0f;
+	const float fallDbPerSecond = 40.0f;
+}
+
+//==============================================================================
+
+// Constructor
+LevelMeter::LevelMeter()
+{
+	for (auto &level : levelsDb_)
+		level = minimumDb;
+}
+
+
+// Destructor
+LevelMeter::~LevelMeter()
+{
+}
+
+
+/*
+ * Moves each bar up to its new peak, or down by no more than the fall rate allows, and
+ *   repaints if anything changed
+ */
+void LevelMeter::pushLevels(const float *peaks, double elapsedSeconds) {
+	const float maxFall = (float) (fallDbPerSecond * elapsedSeconds);
+	bool changed = false;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		const float peakDb = Decibels::gainToDecibels(peaks[channel], minimumDb);
+		const float level = jmax(peakDb, levelsDb_[channel] - maxFall, minimumDb);
+
+		if (level != levelsDb_[channel]) {
+			levelsDb_[channel] = level;
+			changed = true;
+		}
+	}
+
+	if (changed)
+		repaint();
+}
+
+
+bool LevelMeter::isActive() const {
+	for (auto level : levelsDb_)
+		if (level > minimumDb)
+			return true;
+
+	return false;
+}
+
+
+/*
+ * Draws one bar per channel, green up to -6 dB, amber to 0 dB and red for clipping
+ */
+void LevelMeter::paint(Graphics &g) {
+	const int barHeight = (getHeight() - (numChannels - 1)) / numChannels;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		const float proportion = jlimit(0.0f, 1.0f, (levelsDb_[channel] - minimumDb) / -minimumDb);
+		Rectangle<int> bar(0, channel * (barHeight + 1), getWidth(), barHeight);
+
+		g.setColour(Colours::black.withAlpha(0.3f));
+		g.fillRect(bar);
+
+		g.setColour(levelsDb_[channel] >= 0.0f ? Colours::red
+		            : levelsDb_[channel] >= -6.0f ? Colours::orange
+		            : Colours::limegreen);
+		g.fillRect(bar.withWidth(roundToInt(proportion * getWidth())));
+	}
+}
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+  level_meter.h -- interface for the player's output level meter
+	- One horizontal bar per channel, showing the peak level on a dB scale
+	- Bars rise instantly and fall back at a fixed rate, so the meter keeps
+	  moving for a moment after playback stops and then goes idle
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Peak meter fed by its owner (which reads the engine's published levels on
+    each UI refresh) rather than by a timer of its own.
+*/
+class LevelMeter : public Component
+{
+public:
+	enum { numChannels = 2 };
+
+	LevelMeter();
+	~LevelMeter();
+
+	// Takes the peak gain of each channel since the last call, and the time since then
+	void pushLevels(const float *peaks, double elapsedSeconds);
+
+	// True while a bar is still falling back, i.e. the meter needs more refreshes
+	bool isActive() const;
+
+	void paint(Graphics &g) override;
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	float levelsDb_[numChannels];	// displayed levels, floored at the bottom of the scale
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
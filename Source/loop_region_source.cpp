@@ -0,0 +1,317 @@
+/*
+  ==============================================================================
+
+  loop_region_source.cpp -- implementation of the player's sample-accurate loop
+
+  ==============================================================================
+*/
+
+#include "loop_region_source.h"
+
+namespace {
+	// Shortest region that can be looped
+	const int64 minRegionLength = 64;
+}
+
+//==============================================================================
+
+// Constructor
+LoopRegionSource::LoopRegionSource()
+	: input_(nullptr),
+	  hasPending_(false),
+	  position_(0),
+	  residentOffset_(-1),
+	  pendingPosition_(-1)
+{
+}
+
+
+// Destructor
+LoopRegionSource::~LoopRegionSource()
+{
+}
+
+
+/*
+ * The seam fades the last fadeLength samples before the end out while fading in the same
+ *   number of samples leading up to the start (or, with less audio than that before the
+ *   start, from the start itself), with a raised-cosine curve whose gains sum to 1. The
+ *   audio following the seam is rendered after it, up to residentSamples of it.
+ */
+std::unique_ptr<LoopRegionSource::Region> LoopRegionSource::renderRegion(AudioFormatReader &reader, int64 start,
+                                                                         int64 end, int fadeSamples,
+                                                                         int residentSamples) {
+	start = jlimit((int64) 0, reader.lengthInSamples, start);
+	end = jlimit((int64) 0, reader.lengthInSamples, end);
+
+	if (end - start < minRegionLength)
+		return nullptr;
+
+	std::unique_ptr<Region> region(new Region());
+	region->start = start;
+	region->end = end;
+
+	// Keep the fade within a third of the region, so some of every pass is read from the file
+	const int fadeLength = (int) jmin((int64) jmax(0, fadeSamples), (end - start) / 3);
+	const int64 preRoll = jmin((int64) fadeLength, start);
+	region->fadeLength = fadeLength;
+	region->resumePosition = start - preRoll + fadeLength;
+
+	const int headLength = (int) jlimit((int64) 0, (int64) jmax(0, residentSamples),
+	                                    end - fadeLength - region->resumePosition);
+	const int numChannels = jmax(1, (int) reader.numChannels);
+
+	region->resident.setSize(numChannels, jmax(1, fadeLength + headLength));
+	region->resident.clear();
+
+	if (fadeLength > 0) {
+		AudioBuffer<float> incoming(numChannels, fadeLength);
+		reader.read(&region->resident, 0, fadeLength, end - fadeLength, true, true);
+		reader.read(&incoming, 0, fadeLength, start - preRoll, true, true);
+
+		for (int i = 0; i < fadeLength; i++) {
+			const float fadeIn = 0.5f - 0.5f * std::cos(MathConstants<float>::pi * (i + 0.5f) / fadeLength);
+
+			for (int channel = 0; channel < numChannels; channel++) {
+				float *seam = region->resident.getWritePointer(channel);
+				seam[i] = seam[i] * (1.0f - fadeIn) + incoming.getSample(channel, i) * fadeIn;
+			}
+		}
+	}
+
+	if (headLength > 0)
+		reader.read(&region->resident, fadeLength, headLength, region->resumePosition, true, true);
+
+	region->resident.setSize(numChannels, fadeLength + headLength, true, false, true);
+	return region;
+}
+
+
+/*
+ * Changes the input (or just restarts with the same one), dropping any region
+ */
+void LoopRegionSource::setInput(PositionableAudioSource *source) {
+	std::unique_ptr<Region> removedActive, removedPending;
+
+	{
+		const ScopedLock sl(lock_);
+		input_ = source;
+		removedActive = std::move(active_);
+		removedPending = std::move(pending_);
+		hasPending_ = false;
+		position_ = 0;
+		residentOffset_ = -1;
+		pendingPosition_ = -1;
+	}
+}
+
+
+/*
+ * Queues a region (or its removal, with nullptr) for the audio thread to pick up. Anything it
+ *   replaces is deleted here rather than on the audio thread.
+ */
+void LoopRegionSource::setRegion(std::unique_ptr<Region> region) {
+	{
+		const ScopedLock sl(lock_);
+		std::swap(pending_, region);
+		hasPending_ = true;
+
+		// With nothing playing from memory the swap can happen now
+		if (residentOffset_ < 0)
+			adoptPendingRegion();
+	}
+}
+
+
+bool LoopRegionSource::hasRegion() const {
+	const ScopedLock sl(lock_);
+	return hasPending_ ? pending_ != nullptr : active_ != nullptr;
+}
+
+
+void LoopRegionSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+	if (input_ != nullptr)
+		input_->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+
+void LoopRegionSource::releaseResources() {
+	if (input_ != nullptr)
+		input_->releaseResources();
+}
+
+
+/*
+ * Makes any posted jump, then reads the input up to the start of the seam, then plays the resident audio while the
+ *   input's read-ahead buffer moves on to the point after it, then reads the input again
+ */
+void LoopRegionSource::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+	const ScopedLock sl(lock_);
+
+	if (input_ == nullptr) {
+		bufferToFill.clearActiveBufferRegion();
+		return;
+	}
+
+	applyPendingPosition();
+
+	int done = 0;
+
+	while (done < bufferToFill.numSamples) {
+		const AudioSourceChannelInfo rest(bufferToFill.buffer, bufferToFill.startSample + done,
+		                                  bufferToFill.numSamples - done);
+
+		if (residentOffset_ >= 0) {
+			done += copyResident(rest);
+			continue;
+		}
+
+		if (hasPending_)
+			adoptPendingRegion();
+
+		// Without a region the input plays on as it is
+		if (active_ == nullptr) {
+			input_->getNextAudioBlock(rest);
+			break;
+		}
+
+		position_ = input_->getNextReadPosition();
+
+		const int64 seamStart = active_->end - active_->fadeLength;
+		const int64 length = input_->getTotalLength();
+
+		// After a jump past the seam, play on to the end of the file and then loop from the start
+		if (position_ > seamStart) {
+			if (position_ >= length) {
+				position_ = active_->start;
+				input_->setNextReadPosition(position_);
+				continue;
+			}
+
+			const int num = (int) jmin((int64) rest.numSamples, length - position_);
+			input_->getNextAudioBlock(AudioSourceChannelInfo(rest.buffer, rest.startSample, num));
+			done += num;
+			continue;
+		}
+
+		const int numDirect = (int) jmin((int64) rest.numSamples, seamStart - position_);
+
+		if (numDirect > 0) {
+			input_->getNextAudioBlock(AudioSourceChannelInfo(rest.buffer, rest.startSample, numDirect));
+			position_ += numDirect;
+			done += numDirect;
+		}
+
+		if (position_ == seamStart) {
+			// Only the read-ahead buffer's position moves here; its own thread does the seeking
+			input_->setNextReadPosition(active_->resumePosition + active_->resident.getNumSamples() - active_->fadeLength);
+			residentOffset_ = 0;
+		}
+	}
+}
+
+
+/*
+ * Posts a jump for the next block to make (any thread; called by the transport on the audio
+ *   thread, so nothing is locked here)
+ */
+void LoopRegionSource::setNextReadPosition(int64 newPosition) {
+	pendingPosition_.store(jmax((int64) 0, newPosition));
+}
+
+
+/*
+ * The position follows the input, except while the resident audio is playing (or a jump has
+ *   been posted)
+ */
+int64 LoopRegionSource::getNextReadPosition() const {
+	const int64 pending = pendingPosition_.load();
+	if (pending >= 0)
+		return pending;
+
+	const ScopedLock sl(lock_);
+
+	if (residentOffset_ >= 0 || input_ == nullptr)
+		return position_;
+
+	return input_->getNextReadPosition();
+}
+
+
+int64 LoopRegionSource::getTotalLength() const {
+	const ScopedLock sl(lock_);
+	return input_ != nullptr ? input_->getTotalLength() : 0;
+}
+
+
+/*
+ * Looping while there's a region, so the transport doesn't stop at the end of the file
+ */
+bool LoopRegionSource::isLooping() const {
+	const ScopedLock sl(lock_);
+	return active_ != nullptr || (hasPending_ && pending_ != nullptr);
+}
+
+
+/*
+ * Looping is controlled with regions; the input's own setting is left alone
+ */
+void LoopRegionSource::setLooping(bool) {
+}
+
+
+/*
+ * Makes the pending region the active one (call with the lock held). The one it replaces is
+ *   parked in pending_ for the message thread to delete.
+ */
+void LoopRegionSource::adoptPendingRegion() {
+	std::swap(active_, pending_);
+	hasPending_ = false;
+}
+
+
+/*
+ * Makes the posted jump, if there is one (call with the lock held): it goes straight to the
+ *   input, out of the resident audio if it was playing
+ */
+void LoopRegionSource::applyPendingPosition() {
+	const int64 position = pendingPosition_.exchange(-1);
+	if (position < 0)
+		return;
+
+	position_ = position;
+	residentOffset_ = -1;
+
+	if (hasPending_)
+		adoptPendingRegion();
+
+	input_->setNextReadPosition(position_);
+}
+
+
+/*
+ * Plays the resident audio from residentOffset_ (call with the lock held), returning the
+ *   number of samples copied. The position follows the file through the seam and then from
+ *   the resume point; once the resident audio runs out, the input takes over where it ends.
+ */
+int LoopRegionSource::copyResident(const AudioSourceChannelInfo &bufferToFill) {
+	const Region &region = *active_;
+	const int numResident = region.resident.getNumSamples();
+	const int num = jmin(bufferToFill.numSamples, numResident - residentOffset_);
+
+	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); channel++)
+		bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample,
+			region.resident, channel % region.resident.getNumChannels(), residentOffset_, num);
+
+	residentOffset_ += num;
+
+	if (residentOffset_ < region.fadeLength)
+		position_ = region.end - region.fadeLength + residentOffset_;
+	else
+		position_ = region.resumePosition + residentOffset_ - region.fadeLength;
+
+	if (residentOffset_ >= numResident)
+		residentOffset_ = -1;
+
+	return num;
+}
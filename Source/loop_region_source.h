@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+  loop_region_source.h -- interface for the player's sample-accurate loop
+	- Loops any region of the file, from a start to an end sample
+	- The seam (the end of the region crossfaded into its start) and the first
+	  second after it are rendered in advance into a resident buffer, so the
+	  wrap is click-free and the audio thread never waits for a reader to seek:
+	  while the resident audio plays, the read-ahead buffer refills from
+	  beyond it in the background
+	- A new region is picked up at the next point where the current one isn't
+	  being played from memory, so loop points can change without a gap
+	- Jumps are posted without locking (the transport seeks from the audio
+	  thread) and made at the start of the next block
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    A PositionableAudioSource that passes another one through, wrapping at the
+    end of the loop region (if there is one). The input is not owned.
+*/
+class LoopRegionSource : public PositionableAudioSource
+{
+public:
+	// A loop region and its pre-rendered audio
+	struct Region
+	{
+		int64 start = 0;
+		int64 end = 0;
+		int fadeLength = 0;		// samples before the end that are crossfaded
+		int64 resumePosition = 0;	// where playback carries on from after the seam
+		AudioBuffer<float> resident;	// fadeLength samples of seam, then the audio from resumePosition
+	};
+
+	LoopRegionSource();
+	~LoopRegionSource();
+
+	// Renders a region from a reader of the same file (any thread; the reader isn't shared
+	//   with the audio thread). Returns nullptr if the region is too short to loop.
+	static std::unique_ptr<Region> renderRegion(AudioFormatReader &reader, int64 start, int64 end,
+	                                            int fadeSamples, int residentSamples);
+
+	// Message thread. setInput() drops the region straight away (for a new file); setRegion()
+	//   hands one over to be picked up without a gap, or removes it with nullptr.
+	void setInput(PositionableAudioSource *source);
+	void setRegion(std::unique_ptr<Region> region);
+	bool hasRegion() const;
+
+	// Redefinitions of AudioSource methods
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+	void releaseResources() override;
+	void getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) override;
+
+	// Redefinitions of PositionableAudioSource methods
+	void setNextReadPosition(int64 newPosition) override;
+	int64 getNextReadPosition() const override;
+	int64 getTotalLength() const override;
+	bool isLooping() const override;
+	void setLooping(bool shouldLoop) override;
+
+private:
+	// Private helper functions
+	void adoptPendingRegion();
+	void applyPendingPosition();
+	int copyResident(const AudioSourceChannelInfo &bufferToFill);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	// Held by the audio thread for each block, and briefly by the message thread
+	CriticalSection lock_;
+	PositionableAudioSource *input_;
+
+	// The region being looped, and one waiting to replace it (or the replaced one, waiting to
+	//   be deleted by the message thread)
+	std::unique_ptr<Region> active_;
+	std::unique_ptr<Region> pending_;
+	bool hasPending_;
+
+	// Position in the file (kept here while the resident audio plays, and taken from the input
+	//   otherwise), and in the resident buffer while it's being played (-1 otherwise)
+	int64 position_;
+	int residentOffset_;
+
+	// Position posted by setNextReadPosition() for the next block to jump to (-1 for none)
+	std::atomic<int64> pendingPosition_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoopRegionSource)
+};
@@ -0,0 +1,658 @@
+/*
+  ==============================================================================
+
+  loudness_analyzer.cpp -- implementation of the player's loudness measurement
+
+  ==============================================================================
+*/
+
+#include "loudness_analyzer.h"
+#include "callback_worker_pool.h"
+#include "headless_renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+	// BS.1770 blocks are built from 100 ms sub-blocks: 4 make a momentary (400 ms) block, 30
+	//   a short-term (3 s) one
+	const double subBlockSeconds = 0.1;
+	const int subBlocksPerMomentary = 4;
+	const int subBlocksPerShortTerm = 30;
+
+	// Gates, in LUFS (absolute) or LU below the gated mean (relative)
+	const double absoluteGate = -70.0;
+	const double integratedRelativeGate = -10.0;
+	const double rangeRelativeGate = -20.0;
+
+	// Audio run through the filters before each chunk, and samples read at a time
+	const double preRollSeconds = 0.5;
+	const int samplesPerRead = 16384;
+
+	// True-peak interpolator: taps per phase (the interpolated points lag the input by half that)
+	const int truePeakTaps = 12;
+
+	// Figures that may differ between the chunked and the single-pass measurement
+	//   (--loudness --check)
+	const double checkTolerance = 0.05;
+
+	double energyToLoudness(double energy) {
+		return -0.691 + 10.0 * std::log10(energy);
+	}
+
+	double loudnessToEnergy(double loudness) {
+		return std::pow(10.0, (loudness + 0.691) / 10.0);
+	}
+
+	/*
+	 * Mean of the energies above the absolute gate and above the relative gate (relativeGate LU
+	 *   below the mean of those above the absolute gate). Returns 0 if none pass.
+	 */
+	double gatedMean(const Array<double> &energies, double relativeGate) {
+		const double absoluteThreshold = loudnessToEnergy(absoluteGate);
+		double sum = 0.0;
+		int count = 0;
+
+		for (auto energy : energies)
+			if (energy > absoluteThreshold) {
+				sum += energy;
+				count++;
+			}
+
+		if (count == 0)
+			return 0.0;
+
+		const double relativeThreshold = jmax(absoluteThreshold, sum / count * std::pow(10.0, relativeGate / 10.0));
+		sum = 0.0;
+		count = 0;
+
+		for (auto energy : energies)
+			if (energy > relativeThreshold) {
+				sum += energy;
+				count++;
+			}
+
+		return count > 0 ? sum / count : 0.0;
+	}
+
+	/*
+	 * Mean energy of each run of blockLength sub-blocks, stepping one sub-block at a time
+	 */
+	Array<double> getBlockEnergies(const Array<double> &subBlocks, int blockLength) {
+		Array<double> blocks;
+		double sum = 0.0;
+
+		for (int i = 0; i < subBlocks.size(); i++) {
+			sum += subBlocks.getUnchecked(i);
+
+			if (i >= blockLength)
+				sum -= subBlocks.getUnchecked(i - blockLength);
+			if (i >= blockLength - 1)
+				blocks.add(jmax(0.0, sum) / blockLength);
+		}
+
+		return blocks;
+	}
+
+	/*
+	 * Loudness range (EBU Tech 3342): the spread between the 10th and 95th percentiles of the
+	 *   gated short-term loudness
+	 */
+	double getLoudnessRange(const Array<double> &subBlocks) {
+		const auto shortTerm = getBlockEnergies(subBlocks, subBlocksPerShortTerm);
+		const double absoluteThreshold = loudnessToEnergy(absoluteGate);
+		double sum = 0.0;
+		int count = 0;
+
+		for (auto energy : shortTerm)
+			if (energy > absoluteThreshold) {
+				sum += energy;
+				count++;
+			}
+
+		if (count == 0)
+			return 0.0;
+
+		const double relativeThreshold = sum / count * std::pow(10.0, rangeRelativeGate / 10.0);
+		std::vector<double> loudness;
+
+		for (auto energy : shortTerm)
+			if (energy > absoluteThreshold && energy > relativeThreshold)
+				loudness.push_back(energyToLoudness(energy));
+
+		if (loudness.empty())
+			return 0.0;
+
+		std::sort(loudness.begin(), loudness.end());
+		const auto last = (double) (loudness.size() - 1);
+		return loudness[(size_t) std::lround(0.95 * last)] - loudness[(size_t) std::lround(0.10 * last)];
+	}
+
+
+	//==============================================================================
+	/*
+	    Direct form II transposed biquad, in double precision (the K-weighting
+	    high-pass sits at 38 Hz, where single precision loses accuracy).
+	*/
+	struct Biquad
+	{
+		double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+		double z1 = 0.0, z2 = 0.0;
+
+		double process(double x) {
+			const double y = b0 * x + z1;
+			z1 = b1 * x - a1 * y + z2;
+			z2 = b2 * x - a2 * y;
+			return y;
+		}
+	};
+
+
+	//==============================================================================
+	/*
+	    Measures one stretch of a file: K-weighted energy per 100 ms sub-block and
+	    the true peak. Audio pushed with measure == false only primes the filters.
+	*/
+	class ChunkMeter
+	{
+	public:
+		ChunkMeter(double sampleRate, int numChannels, int subBlockLength)
+			: numChannels_(numChannels),
+			  subBlockLength_(subBlockLength),
+			  oversampling_(sampleRate < 96000.0 ? 4 : sampleRate < 192000.0 ? 2 : 1),
+			  history_((size_t) (2 * truePeakTaps * numChannels), true),
+			  historyPosition_(0),
+			  coefficients_((size_t) (truePeakTaps * oversampling_)),
+			  subBlockSum_(0.0),
+			  subBlockCount_(0),
+			  truePeak_(0.0f)
+		{
+			// K-weighting: a high shelf (+4 dB above ~1.5 kHz) then a 38 Hz high-pass, with the
+			//   BS.1770 analogue prototypes mapped to this sample rate
+			{
+				const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+				const double k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+				const double vh = std::pow(10.0, gain / 20.0);
+				const double vb = std::pow(vh, 0.4996667741545416);
+				const double a0 = 1.0 + k / q + k * k;
+
+				shelf_.b0 = (vh + vb * k / q + k * k) / a0;
+				shelf_.b1 = 2.0 * (k * k - vh) / a0;
+				shelf_.b2 = (vh - vb * k / q + k * k) / a0;
+				shelf_.a1 = 2.0 * (k * k - 1.0) / a0;
+				shelf_.a2 = (1.0 - k / q + k * k) / a0;
+			}
+			{
+				const double f0 = 38.13547087602444, q = 0.5003270373238773;
+				const double k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+				const double a0 = 1.0 + k / q + k * k;
+
+				highPass_.b0 = 1.0;
+				highPass_.b1 = -2.0;
+				highPass_.b2 = 1.0;
+				highPass_.a1 = 2.0 * (k * k - 1.0) / a0;
+				highPass_.a2 = (1.0 - k / q + k * k) / a0;
+			}
+
+			for (int channel = 0; channel < numChannels; channel++) {
+				filters_.add(shelf_);
+				filters_.add(highPass_);
+			}
+
+			// Channel weights: 1.41 for the surrounds of a 5.0/5.1 file, nothing for its LFE
+			weights_.insertMultiple(0, 1.0, numChannels);
+			if (numChannels == 5) {
+				weights_.set(3, 1.41);
+				weights_.set(4, 1.41);
+			}
+			else if (numChannels == 6) {
+				weights_.set(3, 0.0);
+				weights_.set(4, 1.41);
+				weights_.set(5, 1.41);
+			}
+
+			// Interpolator: one Hann-windowed sinc per phase, normalised to unity gain. Phase p
+			//   gives the point p / oversampling of a sample after the middle of the history.
+			for (int phase = 0; phase < oversampling_; phase++) {
+				float *taps = coefficients_ + phase * truePeakTaps;
+				const double fraction = phase / (double) oversampling_;
+				double sum = 0.0;
+
+				for (int tap = 0; tap < truePeakTaps; tap++) {
+					const double t = tap - (truePeakTaps / 2 - 1) - fraction;
+					const double window = 0.5 * (1.0 + std::cos(MathConstants<double>::pi * t / (truePeakTaps / 2)));
+					const double sinc = t == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * t) / (MathConstants<double>::pi * t);
+					taps[tap] = (float) (sinc * window);
+					sum += taps[tap];
+				}
+
+				for (int tap = 0; tap < truePeakTaps; tap++)
+					taps[tap] = (float) (taps[tap] / sum);
+			}
+		}
+
+		/*
+		 * Filters the buffer's first numSamples samples. When measuring, their energy goes into
+		 *   sub-blocks and their interpolated peaks into the true peak.
+		 */
+		void process(const AudioBuffer<float> &buffer, int numSamples, bool measure) {
+			weightedSquares_.clearQuick();
+			weightedSquares_.insertMultiple(0, 0.0, numSamples);
+			double *squares = weightedSquares_.getRawDataPointer();
+			const int startPosition = historyPosition_;
+
+			for (int channel = 0; channel < numChannels_; channel++) {
+				const float *samples = buffer.getReadPointer(channel);
+				const double weight = weights_.getUnchecked(channel);
+				auto &shelf = filters_.getReference(2 * channel);
+				auto &highPass = filters_.getReference(2 * channel + 1);
+				historyPosition_ = startPosition;
+
+				for (int i = 0; i < numSamples; i++) {
+					const double y = highPass.process(shelf.process(samples[i]));
+					squares[i] += weight * y * y;
+
+					pushHistory(channel, samples[i]);
+					if (measure)
+						updateTruePeak(channel);
+					historyPosition_ = (historyPosition_ + 1) % truePeakTaps;
+				}
+			}
+
+			if (!measure)
+				return;
+
+			for (int i = 0; i < numSamples; i++) {
+				subBlockSum_ += squares[i];
+
+				if (++subBlockCount_ == subBlockLength_) {
+					subBlocks_.add(subBlockSum_ / subBlockLength_);
+					subBlockSum_ = 0.0;
+					subBlockCount_ = 0;
+				}
+			}
+		}
+
+		/*
+		 * At the end of the file: runs silence through the interpolator so the last few samples'
+		 *   peaks are counted (a partial sub-block is dropped, as BS.1770 gates whole blocks only)
+		 */
+		void flushTruePeak() {
+			for (int i = 0; i < truePeakTaps / 2; i++) {
+				for (int channel = 0; channel < numChannels_; channel++) {
+					pushHistory(channel, 0.0f);
+					updateTruePeak(channel);
+				}
+				historyPosition_ = (historyPosition_ + 1) % truePeakTaps;
+			}
+		}
+
+		const Array<double> &getSubBlocks() const { return subBlocks_; }
+		float getTruePeak() const { return truePeak_; }
+
+	private:
+		// Each channel's history is stored twice over, so the last truePeakTaps samples are
+		//   always contiguous
+		void pushHistory(int channel, float sample) {
+			float *history = history_ + 2 * truePeakTaps * channel;
+			history[historyPosition_] = history[historyPosition_ + truePeakTaps] = sample;
+		}
+
+		void updateTruePeak(int channel) {
+			const float *history = history_ + 2 * truePeakTaps * channel + historyPosition_ + 1;
+
+			for (int phase = 0; phase < oversampling_; phase++) {
+				const float *taps = coefficients_ + phase * truePeakTaps;
+				float sum = 0.0f;
+
+				for (int tap = 0; tap < truePeakTaps; tap++)
+					sum += taps[tap] * history[tap];
+
+				truePeak_ = jmax(truePeak_, std::abs(sum));
+			}
+		}
+
+		const int numChannels_;
+		const int subBlockLength_;
+		const int oversampling_;
+
+		Biquad shelf_, highPass_;
+		Array<Biquad> filters_;				// shelf & high-pass per channel
+		Array<double> weights_;
+
+		HeapBlock<float> history_;
+		int historyPosition_;				// where the next sample goes
+		HeapBlock<float> coefficients_;		// truePeakTaps per phase
+
+		Array<double> weightedSquares_;
+		double subBlockSum_;
+		int subBlockCount_;
+		Array<double> subBlocks_;
+		float truePeak_;
+	};
+
+
+	// What each chunk measured
+	struct ChunkResult
+	{
+		Array<double> subBlocks;
+		float truePeak = 0.0f;
+	};
+
+
+	//==============================================================================
+	/*
+	    One measuring worker. Worker n of N measures chunks n, n + N, n + 2N...
+	    with its own reader.
+	*/
+	class ChunkJob : public ThreadPoolJob
+	{
+	public:
+		ChunkJob(AudioFormatManager &formatManager, const File &file, OwnedArray<ChunkResult> &results,
+		         int64 samplesPerChunk, int subBlockLength, int firstChunk, int chunkStride)
+			: ThreadPoolJob("Loudness measurement"), formatManager_(formatManager), file_(file),
+			  results_(results), samplesPerChunk_(samplesPerChunk), subBlockLength_(subBlockLength),
+			  firstChunk_(firstChunk), chunkStride_(chunkStride)
+		{
+		}
+
+		JobStatus runJob() override {
+			std::unique_ptr<AudioFormatReader> reader(formatManager_.createReaderFor(file_));
+
+			if (reader == nullptr)
+				return jobHasFinished;
+
+			const int numChannels = (int) reader->numChannels;
+			const int64 preRoll = (int64) (preRollSeconds * reader->sampleRate);
+			AudioBuffer<float> buffer(numChannels, samplesPerRead);
+
+			for (int index = firstChunk_; index < results_.size(); index += chunkStride_) {
+				// The last chunk runs to the end of the file
+				const int64 measureStart = (int64) index * samplesPerChunk_;
+				const int64 end = index == results_.size() - 1 ? reader->lengthInSamples : measureStart + samplesPerChunk_;
+				ChunkMeter meter(reader->sampleRate, numChannels, subBlockLength_);
+
+				for (int64 position = jmax((int64) 0, measureStart - preRoll); position < end;) {
+					if (shouldExit())
+						return jobHasFinished;
+
+					const bool measure = position >= measureStart;
+					const int num = (int) jmin((int64) samplesPerRead, (measure ? end : measureStart) - position);
+
+					reader->read(&buffer, 0, num, position, true, true);
+					meter.process(buffer, num, measure);
+					position += num;
+				}
+
+				if (index == results_.size() - 1)
+					meter.flushTruePeak();
+
+				results_[index]->subBlocks = meter.getSubBlocks();
+				results_[index]->truePeak = meter.getTruePeak();
+			}
+
+			return jobHasFinished;
+		}
+
+	private:
+		AudioFormatManager &formatManager_;
+		const File file_;
+		OwnedArray<ChunkResult> &results_;
+		const int64 samplesPerChunk_;
+		const int subBlockLength_;
+		const int firstChunk_;
+		const int chunkStride_;
+	};
+}
+
+//==============================================================================
+/*
+    Measures one queued file with every core, then hands the result to the
+    message thread.
+*/
+class LoudnessAnalyzer::AnalysisJob : public ThreadPoolJob
+{
+public:
+	AnalysisJob(LoudnessAnalyzer &owner, const File &file)
+		: ThreadPoolJob("Loudness analysis"), owner_(owner), file_(file)
+	{
+	}
+
+	JobStatus runJob() override {
+		Result result;
+		const bool measured = measureFile(owner_.formatManager_, file_, result,
+			CallbackWorkerPool::getNumBackgroundWorkers(), 300, [this] { return shouldExit(); });
+
+		if (!shouldExit()) {
+			const ScopedLock sl(owner_.finishedLock_);
+			owner_.finished_.add({ file_, result, measured });
+		}
+
+		owner_.triggerAsyncUpdate();
+		return jobHasFinished;
+	}
+
+private:
+	LoudnessAnalyzer &owner_;
+	const File file_;
+};
+
+
+//==============================================================================
+
+// Constructor
+LoudnessAnalyzer::LoudnessAnalyzer(AudioFormatManager &formatManager, const File &cacheFile, Listener &listener)
+	: formatManager_(formatManager),
+	  listener_(listener),
+	  analysisPool_(1)
+{
+	// Saved straight away on every change: results are added rarely and are costly to redo
+	PropertiesFile::Options options;
+	options.millisecondsBeforeSaving = 0;
+	options.storageFormat = PropertiesFile::storeAsXML;
+
+	cacheFile.getParentDirectory().createDirectory();
+	cache_.reset(new PropertiesFile(cacheFile, options));
+}
+
+
+// Destructor
+LoudnessAnalyzer::~LoudnessAnalyzer()
+{
+	analysisPool_.removeAllJobs(true, 10000);
+	cancelPendingUpdate();
+}
+
+
+File LoudnessAnalyzer::getDefaultCacheFile() {
+	return File::getSpecialLocation(File::userApplicationDataDirectory)
+		.getChildFile("SoundFilePlayer")
+		.getChildFile("Loudness.xml");
+}
+
+
+/*
+ * Looks a file up in the cache. The key covers its size & modification time, so an edited
+ *   file is measured again.
+ */
+bool LoudnessAnalyzer::findCachedResult(const File &file, Result &result) const {
+	const StringArray values = StringArray::fromTokens(cache_->getValue(getKey(file)), ";", {});
+
+	if (values.size() != 4)
+		return false;
+
+	result.hasAudio = values[0].getIntValue() != 0;
+	result.integratedLufs = values[1].getDoubleValue();
+	result.rangeLu = values[2].getDoubleValue();
+	result.truePeakDb = values[3].getDoubleValue();
+	return true;
+}
+
+
+/*
+ * Queues a file for measurement, unless its result is already known or it's already queued
+ */
+void LoudnessAnalyzer::analyse(const File &file) {
+	Result cached;
+
+	if (findCachedResult(file, cached) || isAnalysing(file))
+		return;
+
+	analysing_.add(file.getFullPathName());
+	analysisPool_.addJob(new AnalysisJob(*this, file), true);
+}
+
+
+bool LoudnessAnalyzer::isAnalysing(const File &file) const {
+	return analysing_.contains(file.getFullPathName());
+}
+
+
+/*
+ * Splits the file into chunks of whole sub-blocks (or measures it as one chunk if
+ *   subBlocksPerChunk is 0), measures them on a pool of workers, then joins their sub-blocks
+ *   up to gate the whole file
+ */
+bool LoudnessAnalyzer::measureFile(AudioFormatManager &formatManager, const File &file, Result &result,
+                                   int numWorkers, int subBlocksPerChunk, std::function<bool()> shouldStop) {
+	std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+	if (reader == nullptr || reader->numChannels == 0 || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+		return false;
+
+	const int subBlockLength = jmax(1, roundToInt(reader->sampleRate * subBlockSeconds));
+	const int64 samplesPerChunk = subBlocksPerChunk > 0 ? (int64) subBlockLength * subBlocksPerChunk
+	                                                   : jmax((int64) 1, reader->lengthInSamples);
+	const int numChunks = (int) jmax((int64) 1, (reader->lengthInSamples + samplesPerChunk - 1) / samplesPerChunk);
+	reader.reset();
+
+	OwnedArray<ChunkResult> chunks;
+	for (int i = 0; i < numChunks; i++)
+		chunks.add(new ChunkResult());
+
+	{
+		ThreadPool pool(jlimit(1, numChunks, numWorkers));
+		const int numJobs = pool.getNumThreads();
+
+		for (int i = 0; i < numJobs; i++)
+			pool.addJob(new ChunkJob(formatManager, file, chunks, samplesPerChunk, subBlockLength, i, numJobs), true);
+
+		while (pool.getNumJobs() > 0) {
+			if (shouldStop != nullptr && shouldStop()) {
+				pool.removeAllJobs(true, 10000);
+				return false;
+			}
+
+			Thread::sleep(10);
+		}
+	}
+
+	Array<double> subBlocks;
+	float truePeak = 0.0f;
+
+	for (auto *chunk : chunks) {
+		subBlocks.addArray(chunk->subBlocks);
+		truePeak = jmax(truePeak, chunk->truePeak);
+	}
+
+	const double integrated = gatedMean(getBlockEnergies(subBlocks, subBlocksPerMomentary), integratedRelativeGate);
+
+	result.hasAudio = integrated > 0.0;
+	result.integratedLufs = result.hasAudio ? energyToLoudness(integrated) : absoluteGate;
+	result.rangeLu = getLoudnessRange(subBlocks);
+	result.truePeakDb = Decibels::gainToDecibels((double) truePeak, -100.0);
+	return true;
+}
+
+
+/*
+ * Message thread: caches finished results and tells the listener
+ */
+void LoudnessAnalyzer::handleAsyncUpdate() {
+	Array<Finished> finished;
+
+	{
+		const ScopedLock sl(finishedLock_);
+		finished.swapWith(finished_);
+	}
+
+	for (auto &entry : finished) {
+		analysing_.removeString(entry.file.getFullPathName());
+
+		if (entry.succeeded)
+			cache_->setValue(getKey(entry.file), String((int) entry.result.hasAudio) + ";"
+				+ String(entry.result.integratedLufs, 2) + ";" + String(entry.result.rangeLu, 2) + ";"
+				+ String(entry.result.truePeakDb, 2));
+
+		listener_.loudnessAnalysisFinished(entry.file, entry.succeeded);
+	}
+}
+
+
+String LoudnessAnalyzer::getKey(const File &file) {
+	const String key = file.getFullPathName() + "|" + String(file.getSize()) + "|"
+		+ String(file.getLastModificationTime().toMilliseconds());
+	return "f" + String::toHexString(key.hashCode64());
+}
+
+
+/*
+ * Measures a file and prints the figures & time taken. With --check, it's measured again in
+ *   a single pass on one thread, and the exit code is 1 if the figures differ.
+ */
+int LoudnessAnalyzer::runFromCommandLine(const StringArray &args) {
+	int index = args.indexOf("--loudness");
+
+	if (index < 0 || index + 1 >= args.size() || args[index + 1].startsWith("--")) {
+		std::cerr << getUsage() << std::endl;
+		return 1;
+	}
+
+	const File file = File::getCurrentWorkingDirectory().getChildFile(args[index + 1].unquoted());
+	const int numWorkers = jmax(1, HeadlessRenderer::getOptionValue(args, "--workers",
+		String(CallbackWorkerPool::getNumBackgroundWorkers())).getIntValue());
+
+	AudioFormatManager formatManager;
+	formatManager.registerBasicFormats();
+
+	auto measure = [&](int workers, int subBlocksPerChunk, Result &result) {
+		const double start = Time::getMillisecondCounterHiRes();
+		const bool measured = measureFile(formatManager, file, result, workers, subBlocksPerChunk);
+		const double seconds = (Time::getMillisecondCounterHiRes() - start) * 0.001;
+
+		if (measured)
+			std::cout << "  integrated: " << String(result.integratedLufs, 2) << " LUFS" << (result.hasAudio ? "" : " (silent)") << std::endl
+			          << "  range:      " << String(result.rangeLu, 2) << " LU" << std::endl
+			          << "  true peak:  " << String(result.truePeakDb, 2) << " dBTP" << std::endl
+			          << "  wall time:  " << String(seconds, 3) << " s (" << workers << " workers)" << std::endl;
+		return measured;
+	};
+
+	Result chunked;
+	std::cout << file.getFileName() << std::endl;
+
+	if (!measure(numWorkers, 300, chunked)) {
+		std::cerr << "Couldn't read " << file.getFullPathName() << std::endl;
+		return 1;
+	}
+
+	if (!args.contains("--check"))
+		return 0;
+
+	Result single;
+	std::cout << "single pass:" << std::endl;
+	measure(1, 0, single);
+
+	const bool matches = chunked.hasAudio == single.hasAudio
+		&& std::abs(chunked.integratedLufs - single.integratedLufs) <= checkTolerance
+		&& std::abs(chunked.rangeLu - single.rangeLu) <= checkTolerance
+		&& std::abs(chunked.truePeakDb - single.truePeakDb) <= checkTolerance;
+
+	std::cout << (matches ? "chunked & single-pass figures match" : "chunked & single-pass figures DIFFER") << std::endl;
+	return matches ? 0 : 1;
+}
+
+
+String LoudnessAnalyzer::getUsage() {
+	return "Usage: SoundFilePlayer --loudness <file> [--workers n] [--check]";
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+  loudness_analyzer.h -- interface for the player's loudness measurement
+	- Measures integrated loudness and loudness range (EBU R128 / ITU-R
+	  BS.1770, with the K-weighting filter and both gates) and true peak (4x
+	  oversampled below 96 kHz)
+	- The file is split into 30 s chunks measured in parallel, one worker per
+	  core with its own reader; each chunk first runs half a second of the
+	  audio before it through the filters, so the chunks join up seamlessly
+	- Files are measured one at a time in the background, and the results are
+	  kept in a small cache file keyed by path, size & modification time, so
+	  a file is only ever measured once
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <functional>
+
+//==============================================================================
+/*
+    Background loudness measurement with a persistent cache of results. The
+    listener is called on the message thread as each file is measured.
+*/
+class LoudnessAnalyzer : private AsyncUpdater
+{
+public:
+	struct Result
+	{
+		bool hasAudio = false;			// false if nothing was above the -70 LUFS gate
+		double integratedLufs = 0.0;
+		double rangeLu = 0.0;
+		double truePeakDb = -100.0;
+	};
+
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+
+		// The result (if it succeeded) is in the cache by the time this is called
+		virtual void loudnessAnalysisFinished(const File &file, bool succeeded) = 0;
+	};
+
+	LoudnessAnalyzer(AudioFormatManager &formatManager, const File &cacheFile, Listener &listener);
+	~LoudnessAnalyzer();
+
+	// Default cache: <app data>/SoundFilePlayer/Loudness.xml
+	static File getDefaultCacheFile();
+
+	// Message thread. analyse() queues a file unless it's cached or already queued; the
+	//   listener hears about it once it's been measured, or found to be unreadable.
+	bool findCachedResult(const File &file, Result &result) const;
+	void analyse(const File &file);
+	bool isAnalysing(const File &file) const;
+
+	// Measures a file on the calling thread, spreading the chunks over numWorkers threads
+	//   (a subBlocksPerChunk of 0 measures it in one pass). Returns false if the file can't
+	//   be read or shouldStop() returns true.
+	static bool measureFile(AudioFormatManager &formatManager, const File &file, Result &result,
+	                        int numWorkers, int subBlocksPerChunk = 300,
+	                        std::function<bool()> shouldStop = nullptr);
+
+	// Command-line entry point ("--loudness <file> [options]"); returns the process exit code
+	static int runFromCommandLine(const StringArray &args);
+	static String getUsage();
+
+private:
+	class AnalysisJob;
+
+	// Redefinition of AsyncUpdater method
+	void handleAsyncUpdate() override;
+
+	// Private helper functions
+	static String getKey(const File &file);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	AudioFormatManager &formatManager_;
+	Listener &listener_;
+	std::unique_ptr<PropertiesFile> cache_;
+
+	// Files queued or being measured (message thread), and finished measurements waiting to
+	//   be handed to it
+	struct Finished
+	{
+		File file;
+		Result result;
+		bool succeeded;
+	};
+
+	StringArray analysing_;
+	CriticalSection finishedLock_;
+	Array<Finished> finished_;
+
+	// One file at a time (each one already uses every core)
+	ThreadPool analysisPool_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessAnalyzer)
+};
@@ -0,0 +1,391 @@
+/*
+  ==============================================================================
+
+  mixer_engine.cpp -- implementation of the multi-file layer mixer
+
+  ==============================================================================
+*/
+
+#include "mixer_engine.h"
+#include "callback_worker_pool.h"
+
+//==============================================================================
+
+// Constructor
+MixerVoice::MixerVoice(std::unique_ptr<LoadedFile> loadedFile)
+	: file_(std::move(loadedFile)),
+	  source_(file_->getPlaybackSource()),
+	  playing_(false)
+{
+}
+
+
+// Destructor
+MixerVoice::~MixerVoice()
+{
+}
+
+
+/*
+ * Prepares the voice's chain for the device, putting a resampler in front of the file if
+ *   its rate differs from the device's
+ */
+void MixerVoice::prepare(int samplesPerBlockExpected, double sampleRate) {
+	if (file_->sampleRate != sampleRate) {
+		resampler_.reset(new ResamplingAudioSource(file_->getPlaybackSource(), false, jmax(1, file_->numChannels)));
+		resampler_->setResamplingRatio(file_->sampleRate / sampleRate);
+		source_ = resampler_.get();
+	}
+	else {
+		resampler_.reset();
+		source_ = file_->getPlaybackSource();
+	}
+
+	parameters_.snapToTargets();
+	gainNoise_.prepare(samplesPerBlockExpected);
+	scratch_.setSize(jmax(1, file_->numChannels), jmax(1, samplesPerBlockExpected));
+	source_->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+
+void MixerVoice::release() {
+	source_->releaseResources();
+}
+
+
+/*
+ * Renders the voice one scratch buffer at a time (so a block larger than expected still works)
+ *   and adds it to the output. Output channels beyond the file's repeat its channels.
+ */
+void MixerVoice::mixInto(const AudioSourceChannelInfo &bufferToFill) {
+	if (!playing_.load(std::memory_order_relaxed))
+		return;
+
+	const int capacity = scratch_.getNumSamples();
+	parameters_.startBlock();
+
+	for (int offset = 0; offset < bufferToFill.numSamples; offset += capacity) {
+		const int num = jmin(capacity, bufferToFill.numSamples - offset);
+
+		source_->getNextAudioBlock(AudioSourceChannelInfo(&scratch_, 0, num));
+		gainNoise_.process(scratch_, 0, num,
+			parameters_.getRamp(PlayerParameters::Volume), parameters_.getRamp(PlayerParameters::Noise));
+
+		for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); channel++)
+			FloatVectorOperations::add(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset),
+				scratch_.getReadPointer(channel % scratch_.getNumChannels()), num);
+	}
+}
+
+
+void MixerVoice::setPlaying(bool shouldPlay) {
+	playing_.store(shouldPlay);
+}
+
+
+bool MixerVoice::isPlaying() const {
+	return playing_.load();
+}
+
+
+void MixerVoice::setLooping(bool shouldLoop) {
+	file_->readerSource->setLooping(shouldLoop);
+}
+
+
+/*
+ * Moves the voice to a time in its file (the read-ahead buffer refills from there)
+ */
+void MixerVoice::setPosition(double seconds) {
+	file_->getPlaybackSource()->setNextReadPosition((int64) (seconds * file_->sampleRate));
+}
+
+
+PlayerParameters &MixerVoice::getParameters() {
+	return parameters_;
+}
+
+
+const LoadedFile &MixerVoice::getFile() const {
+	return *file_;
+}
+
+
+//==============================================================================
+/*
+    Opens one file on the load pool: builds the reader chain, gives it a read-ahead
+    buffer on the least busy decode thread and primes it.
+*/
+class MixerEngine::LoadJob : public ThreadPoolJob
+{
+public:
+	LoadJob(MixerEngine &owner, const File &file, const LoadOptions &options, TimeSliceThread &decodeThread,
+	        int blockSize)
+		: ThreadPoolJob("Mixer load"), owner_(owner), file_(file), options_(options),
+		  decodeThread_(decodeThread), blockSize_(blockSize)
+	{
+	}
+
+	JobStatus runJob() override {
+		auto loaded = FileLoader::openFile(owner_.formatManager_, file_, options_, &decodeThread_);
+
+		if (loaded != nullptr && !shouldExit()) {
+			loaded->readAheadSource.reset(new ReadAheadSource(loaded->readerSource.get(), decodeThread_,
+				(int) (options_.readAheadSeconds * loaded->sampleRate), loaded->numChannels));
+			loaded->readAheadSource->prepareToPlay(blockSize_, loaded->sampleRate);
+		}
+
+		if (loaded != nullptr && !shouldExit()) {
+			const ScopedLock sl(owner_.readyLock_);
+			owner_.readyFiles_.add(loaded.release());
+		}
+
+		owner_.numLoading_--;
+		owner_.triggerAsyncUpdate();
+		return jobHasFinished;
+	}
+
+private:
+	MixerEngine &owner_;
+	File file_;
+	LoadOptions options_;
+	TimeSliceThread &decodeThread_;
+	int blockSize_;
+};
+
+
+//==============================================================================
+
+// Constructor
+MixerEngine::MixerEngine()
+	: playing_(false),
+	  playingChanged_(false),
+	  pendingPosition_(-1.0),
+	  blockSize_(512),
+	  sampleRate_(44100.0),
+	  isPrepared_(false),
+	  numLoading_(0)
+{
+	formatManager_.registerBasicFormats();
+	voices_.ensureStorageAllocated(maxVoices);
+}
+
+
+// Destructor
+MixerEngine::~MixerEngine()
+{
+	if (loadPool_ != nullptr)
+		loadPool_->removeAllJobs(true, 10000);
+
+	cancelPendingUpdate();
+	readyFiles_.clear();
+	clearVoices();
+
+	for (auto *thread : decodeThreads_)
+		thread->stopThread(1000);
+}
+
+
+/*
+ * Prepares every voice for the device's block size & rate
+ */
+void MixerEngine::prepare(int samplesPerBlockExpected, double sampleRate) {
+	blockSize_ = samplesPerBlockExpected;
+	sampleRate_ = sampleRate;
+	isPrepared_ = true;
+
+	const ScopedLock sl(voiceLock_);
+
+	for (auto *voice : voices_)
+		voice->prepare(samplesPerBlockExpected, sampleRate);
+}
+
+
+void MixerEngine::release() {
+	isPrepared_ = false;
+
+	const ScopedLock sl(voiceLock_);
+
+	for (auto *voice : voices_)
+		voice->release();
+}
+
+
+/*
+ * Brings the voices up to date with any posted transport change, then adds every playing
+ *   voice into the buffer. If the message thread is adding or removing a voice, the layers
+ *   sit this block out (and the posted changes wait for the next one).
+ */
+void MixerEngine::mixInto(const AudioSourceChannelInfo &bufferToFill) {
+	const ScopedTryLock sl(voiceLock_);
+
+	if (!sl.isLocked())
+		return;
+
+	applyPendingState();
+
+	for (auto *voice : voices_)
+		voice->mixInto(bufferToFill);
+}
+
+
+/*
+ * Starts opening a file on the load pool; it joins the mix once it's primed
+ */
+void MixerEngine::addFile(const File &file, const LoadOptions &options) {
+	if (loadPool_ == nullptr)
+		loadPool_.reset(new ThreadPool(CallbackWorkerPool::getNumBackgroundWorkers()));
+
+	numLoading_++;
+	loadPool_->addJob(new LoadJob(*this, file, options, getLeastBusyDecodeThread(), blockSize_), true);
+	sendChangeMessage();
+}
+
+
+/*
+ * Adds an open file as a new voice, playing if the mixer is. Returns false (and deletes the
+ *   file) if every voice is in use.
+ */
+bool MixerEngine::addVoice(std::unique_ptr<LoadedFile> loadedFile) {
+	if (loadedFile == nullptr || voices_.size() >= maxVoices)
+		return false;
+
+	std::unique_ptr<MixerVoice> voice(new MixerVoice(std::move(loadedFile)));
+
+	// Everything that might block or allocate happens before the voice is visible to the
+	//   audio thread
+	if (isPrepared_)
+		voice->prepare(blockSize_, sampleRate_);
+
+	// A start or stop posted after the state is read here reaches the new voice along with
+	//   the others, at the next block
+	{
+		const ScopedLock sl(voiceLock_);
+		voice->setPlaying(playing_.load());
+		voices_.add(voice.release());
+	}
+
+	sendChangeMessage();
+	return true;
+}
+
+
+/*
+ * Removes a voice from the mix, then deletes it outside the lock
+ */
+void MixerEngine::removeVoice(int index) {
+	std::unique_ptr<MixerVoice> removed;
+
+	{
+		const ScopedLock sl(voiceLock_);
+		removed.reset(voices_.removeAndReturn(index));
+	}
+
+	sendChangeMessage();
+}
+
+
+void MixerEngine::clearVoices() {
+	OwnedArray<MixerVoice> removed;
+
+	{
+		const ScopedLock sl(voiceLock_);
+		removed.swapWith(voices_);
+		voices_.ensureStorageAllocated(maxVoices);
+	}
+
+	sendChangeMessage();
+}
+
+
+int MixerEngine::getNumVoices() const {
+	return voices_.size();
+}
+
+
+/*
+ * Number of files still being opened on the load pool
+ */
+int MixerEngine::getNumLoading() const {
+	return numLoading_.load();
+}
+
+
+MixerVoice *MixerEngine::getVoice(int index) const {
+	return voices_[index];
+}
+
+
+/*
+ * Called from the audio thread's commands, so the change is only posted; the voices are
+ *   walked by the next mixInto(), under the lock it already holds
+ */
+void MixerEngine::setPlaying(bool shouldPlay) {
+	playing_.store(shouldPlay);
+	playingChanged_.store(true);
+}
+
+
+void MixerEngine::setPosition(double seconds) {
+	pendingPosition_.store(jmax(0.0, seconds));
+}
+
+
+/*
+ * Message thread: turns freshly loaded files into voices
+ */
+void MixerEngine::handleAsyncUpdate() {
+	OwnedArray<LoadedFile> ready;
+
+	{
+		const ScopedLock sl(readyLock_);
+		ready.swapWith(readyFiles_);
+	}
+
+	while (!ready.isEmpty())
+		addVoice(std::unique_ptr<LoadedFile>(ready.removeAndReturn(0)));
+
+	sendChangeMessage();
+}
+
+
+/*
+ * Passes the posted play state & position on to every voice (audio thread, with the voice
+ *   lock held)
+ */
+void MixerEngine::applyPendingState() {
+	if (playingChanged_.exchange(false)) {
+		const bool playing = playing_.load();
+
+		for (auto *voice : voices_)
+			voice->setPlaying(playing);
+	}
+
+	const double position = pendingPosition_.exchange(-1.0);
+
+	if (position >= 0.0)
+		for (auto *voice : voices_)
+			voice->setPosition(position);
+}
+
+
+/*
+ * Returns the decode thread with the fewest read-ahead buffers, starting the threads the
+ *   first time one is needed
+ */
+TimeSliceThread &MixerEngine::getLeastBusyDecodeThread() {
+	if (decodeThreads_.isEmpty()) {
+		for (int i = 0; i < CallbackWorkerPool::getNumBackgroundWorkers(); i++) {
+			auto *thread = decodeThreads_.add(new TimeSliceThread("Mixer decode " + String(i + 1)));
+			thread->startThread(8);
+		}
+	}
+
+	auto *leastBusy = decodeThreads_.getFirst();
+
+	for (auto *thread : decodeThreads_)
+		if (thread->getNumClients() < leastBusy->getNumClients())
+			leastBusy = thread;
+
+	return *leastBusy;
+}
@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+  mixer_engine.h -- interface for the multi-file layer mixer
+	- Plays up to 64 files (stems, layered beds) alongside the main file, each
+	  in its own voice with its own reader, read-ahead buffer and volume/noise
+	- Decoding is spread over one read-ahead thread per CPU core, and files are
+	  opened & primed on a pool of the same size, so the audio thread only
+	  copies buffered samples and mixes them with vector operations
+	- Voices whose sample rate differs from the device's are resampled
+	- The audio thread never waits for the voice list: a block that finds it
+	  being changed goes without the layers, and transport changes are posted
+	  for the next block that gets it
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "file_loader.h"
+#include "gain_noise_processor.h"
+#include "player_parameters.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    One layer: a loaded file and its own volume/noise stage.
+*/
+class MixerVoice
+{
+public:
+	explicit MixerVoice(std::unique_ptr<LoadedFile> loadedFile);
+	~MixerVoice();
+
+	// Message thread (with the voice not yet, or no longer, being mixed)
+	void prepare(int samplesPerBlockExpected, double sampleRate);
+	void release();
+
+	// Audio thread: renders the next block into the scratch buffer and adds it to the output
+	void mixInto(const AudioSourceChannelInfo &bufferToFill);
+
+	// Any thread
+	void setPlaying(bool shouldPlay);
+	bool isPlaying() const;
+	void setLooping(bool shouldLoop);
+	void setPosition(double seconds);
+	PlayerParameters &getParameters();
+	const LoadedFile &getFile() const;
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	std::unique_ptr<LoadedFile> file_;
+	std::unique_ptr<ResamplingAudioSource> resampler_;	// only when the rates differ
+	AudioSource *source_;
+
+	PlayerParameters parameters_;
+	GainNoiseProcessor gainNoise_;
+	AudioBuffer<float> scratch_;
+	std::atomic<bool> playing_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MixerVoice)
+};
+
+
+//==============================================================================
+/*
+    The set of layers. mixInto() adds every playing voice to a buffer that
+    already holds the main file's audio. Sends a change message when voices are
+    added or removed.
+*/
+class MixerEngine : public ChangeBroadcaster,
+                    private AsyncUpdater
+{
+public:
+	enum { maxVoices = 64 };
+
+	MixerEngine();
+	~MixerEngine();
+
+	// Audio setup (message thread)
+	void prepare(int samplesPerBlockExpected, double sampleRate);
+	void release();
+
+	// Audio thread
+	void mixInto(const AudioSourceChannelInfo &bufferToFill);
+
+	// Voice handling (message thread). addFile() opens the file in the background; addVoice()
+	//   takes a file that's already open, with or without a read-ahead buffer.
+	void addFile(const File &file, const LoadOptions &options);
+	bool addVoice(std::unique_ptr<LoadedFile> loadedFile);
+	void removeVoice(int index);
+	void clearVoices();
+
+	int getNumVoices() const;
+	int getNumLoading() const;
+	MixerVoice *getVoice(int index) const;
+
+	// Starts/stops/moves every voice together (with the main transport; any thread). These
+	//   only post the change, which the next mixInto() makes, so they never wait for the
+	//   voice lock.
+	void setPlaying(bool shouldPlay);
+	void setPosition(double seconds);
+
+private:
+	class LoadJob;
+
+	// Redefinition of AsyncUpdater method
+	void handleAsyncUpdate() override;
+
+	// Private helper functions
+	void applyPendingState();
+	TimeSliceThread &getLeastBusyDecodeThread();
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	AudioFormatManager formatManager_;
+
+	// Read-ahead threads, one per core (created when the first file is added)
+	OwnedArray<TimeSliceThread> decodeThreads_;
+
+	// Voices being mixed; the lock is held by the audio thread for each block (which skips
+	//   the layers rather than wait for it) and briefly by the message thread to add or
+	//   remove one
+	CriticalSection voiceLock_;
+	OwnedArray<MixerVoice> voices_;
+
+	// Transport state posted for the voices: whether they play (and whether that has changed
+	//   since the voices were last told), and a position to move them to (-1 for none)
+	std::atomic<bool> playing_;
+	std::atomic<bool> playingChanged_;
+	std::atomic<double> pendingPosition_;
+
+	// Audio settings from the last prepare()
+	int blockSize_;
+	double sampleRate_;
+	bool isPrepared_;
+
+	// Files being opened, and opened files waiting to be handed to the message thread
+	std::unique_ptr<ThreadPool> loadPool_;
+	CriticalSection readyLock_;
+	OwnedArray<LoadedFile> readyFiles_;
+	std::atomic<int> numLoading_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MixerEngine)
+};
@@ -0,0 +1,763 @@
+/*
+  ==============================================================================
+
+  playback_engine.cpp -- implementation of the player's audio processing chain
+
+  ==============================================================================
+*/
+
+#include "playback_engine.h"
+
+namespace {
+	// Length of the crossfade at a loop's seam, and of the audio after it kept in memory
+	//   while the read-ahead buffer catches up
+	const double loopFadeSeconds = 0.01;
+	const double loopResidentSeconds = 1.0;
+
+	// Below this many channels, waking the callback workers costs more than they save
+	const int minParallelChannels = 8;
+
+	static_assert (CallbackWorkerPool::maxWorkers < GainNoiseProcessor::maxThreads,
+	               "each worker needs its own gain/noise scratch space");
+
+	// The part of a per-block ramp that covers samples [offset, offset + numSamples)
+	PlayerParameters::Ramp sliceRamp(const PlayerParameters::Ramp &ramp, int offset, int numSamples, int rampLength) {
+		if (offset == 0 && numSamples == rampLength)
+			return ramp;
+
+		const float step = (ramp.end - ramp.start) / (float) rampLength;
+		return { ramp.start + step * (float) offset, ramp.start + step * (float) (offset + numSamples) };
+	}
+}
+
+//==============================================================================
+
+// Constructor
+PlaybackEngine::PlaybackEngine()
+	: workerChannels_(nullptr),
+	  workerNumSamples_(0),
+	  workerGain_{ 1.0f, 1.0f },
+	  workerNoise_{ 0.0f, 0.0f },
+	  effects_(workers_),
+	  renderCapacity_(0),
+	  sampleRate_(0.0),
+	  numChannels_(2),
+	  defaultChannelMap_(true),
+	  expectedBlockSize_(512),
+	  isPrepared_(false),
+	  playingSnapshot_(false),
+	  finishedSnapshot_(false),
+	  positionSnapshot_(0.0),
+	  stateVersion_(0),
+	  commandsSent_(0),
+	  commandsApplied_(0),
+	  running_(false),
+	  fadingIn_(false),
+	  fadingOut_(false),
+	  looping_(false),
+	  loopStart_(0.0),
+	  loopEnd_(0.0)
+{
+	formatManager_.registerBasicFormats();
+
+	for (int channel = 0; channel < maxChannels; channel++)
+		channelMap_[channel].store(channel);
+}
+
+
+// Destructor
+PlaybackEngine::~PlaybackEngine()
+{
+	transportSource_.setSource(nullptr);
+}
+
+
+/*
+ * Prepares the transport, effects & volume/noise stage for the given block size & sample
+ *   rate. The render buffer has room for any file's channels, so a new file never has to
+ *   wait for it.
+ */
+void PlaybackEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+	expectedBlockSize_ = samplesPerBlockExpected;
+	renderCapacity_ = jmax(1, samplesPerBlockExpected);
+	renderBuffer_.setSize(maxChannels, renderCapacity_);
+	sampleRate_ = sampleRate;
+	parameters_.snapToTargets();
+	gainNoise_.prepare(samplesPerBlockExpected);
+	stats_.prepare(sampleRate);
+	{
+		const ScopedLock sl(scrubLock_);
+		scrubber_.prepare(sampleRate, currentFile_ != nullptr ? currentFile_->sampleRate : sampleRate,
+		                  numChannels_.load());
+	}
+	effects_.prepare(numChannels_.load(), sampleRate, renderCapacity_);
+	analyzer_.prepare(sampleRate);
+	mixer_.prepare(samplesPerBlockExpected, sampleRate);
+	transportSource_.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	isPrepared_ = true;
+}
+
+
+/*
+ * Releases the transport's & layers' resources. Commands still queued are applied here, since
+ *   there won't be another block to apply them.
+ */
+void PlaybackEngine::releaseResources() {
+	isPrepared_ = false;
+	applyPendingCommands();
+
+	transportSource_.releaseResources();
+	mixer_.release();
+}
+
+
+/*
+ * Applies any queued transport commands, then processes the next audio block from the audio
+ *   source file (silence when stopped or when no file is loaded) at the file's channel count,
+ *   and routes it to the device's outputs. A block larger than expected is rendered in
+ *   pieces. Starting & stopping fade over one block. Each stage is timed for the stats panel
+ *   (for the last piece, if there are several).
+ */
+void PlaybackEngine::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+	stats_.beginCallback(bufferToFill.numSamples);
+	applyPendingCommands();
+
+	// Only blocks with the file's audio in them are analysed
+	const bool isAudible = scrubber_.isActive() || running_ || fadingOut_;
+
+	// Read the parameters once for this block; each one ramps linearly across the block. The
+	//   normalization gain (that of the file playing, which changes at a gapless advance)
+	//   scales the volume.
+	parameters_.setValue(PlayerParameters::Normalization, playlist_.getCurrentGain());
+	parameters_.startBlock();
+	const auto &volume = parameters_.getRamp(PlayerParameters::Volume);
+	const auto &normalization = parameters_.getRamp(PlayerParameters::Normalization);
+	const PlayerParameters::Ramp gain = { volume.start * normalization.start, volume.end * normalization.end };
+	const PlayerParameters::Ramp fade = { fadingIn_ ? 0.0f : 1.0f, fadingIn_ ? 1.0f : 0.0f };
+
+	const int numChannels = numChannels_.load(std::memory_order_relaxed);
+	const int numSamples = bufferToFill.numSamples;
+	bool pulledTransport = false;
+	jassert (renderCapacity_ > 0);		// prepareToPlay() hasn't been called
+
+	for (int offset = 0; offset < numSamples; offset += renderCapacity_) {
+		const int num = jmin(renderCapacity_, numSamples - offset);
+		renderBuffer_.setSize(numChannels, num, false, false, true);
+		const AudioSourceChannelInfo piece(&renderBuffer_, 0, num);
+
+		// While scrubbing the transport isn't pulled, so it stays where the drag started. If
+		//   the file is being swapped, this piece is silent rather than waiting for the swap.
+		if (scrubber_.isActive()) {
+			const ScopedTryLock sl(scrubLock_);
+
+			if (sl.isLocked())
+				scrubber_.process(renderBuffer_, 0, num);
+			else
+				piece.clearActiveBufferRegion();
+		}
+		else if (running_ || fadingOut_) {
+			transportSource_.getNextAudioBlock(piece);
+			pulledTransport = true;
+
+			if (fadingIn_ || fadingOut_) {
+				const auto pieceFade = sliceRamp(fade, offset, num, numSamples);
+				renderBuffer_.applyGainRamp(0, num, pieceFade.start, pieceFade.end);
+			}
+
+			// The transport stops itself at the end of the file
+			if (!transportSource_.isPlaying())
+				running_ = false;
+		}
+		else {
+			piece.clearActiveBufferRegion();
+		}
+		stats_.endStage(AudioThreadStats::TransportPull);
+
+		// Effects run on the file's channels, before the volume is applied
+		effects_.process(renderBuffer_);
+		stats_.endStage(AudioThreadStats::Effects);
+
+		// Volume & noise, shared with the workers when there are enough channels to be worth
+		//   waking them for
+		workerGain_ = sliceRamp(gain, offset, num, numSamples);
+		workerNoise_ = sliceRamp(parameters_.getRamp(PlayerParameters::Noise), offset, num, numSamples);
+		workerChannels_ = renderBuffer_.getArrayOfWritePointers();
+		workerNumSamples_ = num;
+
+		if (numChannels >= minParallelChannels)
+			workers_.run(*this, numChannels);
+		else
+			gainNoise_.process(renderBuffer_, 0, num, workerGain_, workerNoise_);
+
+		if (isAudible)
+			analyzer_.pushSamples(renderBuffer_, 0, num);
+
+		routeToOutputs(bufferToFill, offset, num);
+		stats_.endStage(AudioThreadStats::GainNoise);
+	}
+
+	if (pulledTransport)
+		fadingIn_ = fadingOut_ = false;
+
+	mixer_.mixInto(bufferToFill);
+	stats_.endStage(AudioThreadStats::Mixer);
+
+	publishLevels(bufferToFill);
+	publishState();
+	stats_.endCallback();
+}
+
+
+/*
+ * Worker pool job: one channel of the volume & noise stage (each channel has its own noise
+ *   generator, and each thread its own scratch space)
+ */
+void PlaybackEngine::processItem(int channel, int threadIndex) {
+	gainNoise_.processChannel(workerChannels_[channel], channel, workerNumSamples_, workerGain_, workerNoise_,
+		threadIndex);
+}
+
+
+/*
+ * Writes the rendered channels to the device's outputs: each output gets the average of the
+ *   channels mapped to it, and silence if there aren't any. By default a mono file plays on
+ *   every output.
+ */
+void PlaybackEngine::routeToOutputs(const AudioSourceChannelInfo &bufferToFill, int offset, int numSamples) {
+	auto &output = *bufferToFill.buffer;
+	const int numOutputs = output.getNumChannels();
+	const int numChannels = renderBuffer_.getNumChannels();
+	const bool useDefault = defaultChannelMap_.load(std::memory_order_relaxed);
+
+	if (useDefault && numChannels == 1) {
+		for (int out = 0; out < numOutputs; out++)
+			output.copyFrom(out, bufferToFill.startSample + offset, renderBuffer_, 0, 0, numSamples);
+		return;
+	}
+
+	int destinations[maxChannels];
+	int numSources[maxChannels] = {};
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		int destination = useDefault ? channel % jmax(1, numOutputs) : channelMap_[channel].load(std::memory_order_relaxed);
+
+		if (destination >= numOutputs)
+			destination = -1;
+		if (destination >= 0)
+			numSources[destination]++;
+
+		destinations[channel] = destination;
+	}
+
+	for (int out = 0; out < numOutputs; out++) {
+		float *dest = output.getWritePointer(out, bufferToFill.startSample + offset);
+
+		if (out >= maxChannels || numSources[out] == 0) {
+			FloatVectorOperations::clear(dest, numSamples);
+			continue;
+		}
+
+		const float gain = 1.0f / (float) numSources[out];
+		bool isFirst = true;
+
+		for (int channel = 0; channel < numChannels; channel++) {
+			if (destinations[channel] != out)
+				continue;
+
+			if (isFirst)
+				FloatVectorOperations::copyWithMultiply(dest, renderBuffer_.getReadPointer(channel), gain, numSamples);
+			else
+				FloatVectorOperations::addWithMultiply(dest, renderBuffer_.getReadPointer(channel), gain, numSamples);
+
+			isFirst = false;
+		}
+	}
+}
+
+
+/*
+ * Swaps in a new file, dropping any queued one. The transport is detached while the
+ *   playlist is changed, so the audio thread sees either the old file or the new one, never
+ *   a half-built chain; the old files' sources are released afterwards.
+ */
+void PlaybackEngine::setFile(std::unique_ptr<LoadedFile> loadedFile) {
+	transportSource_.setSource(nullptr);
+
+	if (loadedFile != nullptr) {
+		numChannels_ = jlimit(1, (int) maxChannels, loadedFile->numChannels);
+		playlist_.setCurrent(loadedFile->getPlaybackSource());
+		loop_.setInput(&playlist_);
+		resampler_.setInput(&loop_, loadedFile->sampleRate, loadedFile->numChannels);
+		transportSource_.setSource(&resampler_);
+	}
+	else {
+		playlist_.setCurrent(nullptr);
+		loop_.setInput(nullptr);
+		resampler_.setInput(nullptr, 0.0, 2);
+		numChannels_ = 2;
+	}
+
+	// Grains and effects are sized for the new file's channels (once the device's rate is known)
+	{
+		const ScopedLock sl(scrubLock_);
+		if (sampleRate_ > 0.0)
+			scrubber_.prepare(sampleRate_, loadedFile != nullptr ? loadedFile->sampleRate : sampleRate_,
+			                  numChannels_.load());
+		scrubber_.setReader(loadedFile != nullptr ? loadedFile->scrubSource : nullptr);
+	}
+
+	if (sampleRate_ > 0.0)
+		effects_.prepare(numChannels_.load(), sampleRate_, renderCapacity_);
+
+	nextFile_.reset();
+	currentFile_ = std::move(loadedFile);
+	defaultChannelMap_ = true;
+	positionSnapshot_ = 0.0;
+	looping_ = false;
+	loopStart_ = loopEnd_ = 0.0;
+}
+
+
+const LoadedFile *PlaybackEngine::getFile() const {
+	return currentFile_.get();
+}
+
+
+/*
+ * Queues a file to follow the current one. The file should already be primed (as the
+ *   FileLoader does), since the audio thread starts it without any further preparation.
+ */
+bool PlaybackEngine::queueNextFile(std::unique_ptr<LoadedFile> loadedFile) {
+	updatePlaylist();
+
+	if (loadedFile == nullptr || currentFile_ == nullptr || loadedFile->sampleRate != currentFile_->sampleRate
+	    || loadedFile->numChannels != currentFile_->numChannels)
+		return false;
+
+	playlist_.setNext(loadedFile->getPlaybackSource());
+	nextFile_ = std::move(loadedFile);
+	return true;
+}
+
+
+const LoadedFile *PlaybackEngine::getNextFile() const {
+	return nextFile_.get();
+}
+
+
+void PlaybackEngine::setNormalization(const LoadedFile &file, float gain) {
+	playlist_.setGain(file.getPlaybackSource(), gain);
+}
+
+
+/*
+ * Once the audio thread has moved on to the queued file, makes it the current file and
+ *   deletes the finished one (which the audio thread no longer touches)
+ */
+bool PlaybackEngine::updatePlaylist() {
+	if (!playlist_.takeAdvance())
+		return false;
+
+	{
+		const ScopedLock sl(scrubLock_);
+		scrubber_.setReader(nextFile_->scrubSource);
+	}
+
+	// Loop points belong to the file that finished (playback can't have moved on while looping)
+	std::unique_ptr<LoadedFile> finishedFile(std::move(currentFile_));
+	currentFile_ = std::move(nextFile_);
+	loopStart_ = loopEnd_ = 0.0;
+	return true;
+}
+
+
+/*
+ * Turns looping of the loop region (the whole file by default) on or off
+ */
+void PlaybackEngine::setLooping(bool shouldLoop) {
+	looping_ = shouldLoop;
+	updateLoopRegion();
+}
+
+
+bool PlaybackEngine::isLooping() const {
+	return looping_;
+}
+
+
+void PlaybackEngine::setLoopPoints(double startSeconds, double endSeconds) {
+	loopStart_ = jmax(0.0, startSeconds);
+	loopEnd_ = jmax(0.0, endSeconds);
+
+	if (looping_)
+		updateLoopRegion();
+}
+
+
+double PlaybackEngine::getLoopStart() const {
+	return loopStart_;
+}
+
+
+double PlaybackEngine::getLoopEnd() const {
+	return loopEnd_;
+}
+
+
+void PlaybackEngine::start(bool fadeIn) {
+	sendCommand({ TransportCommandQueue::Command::Start, 0.0, fadeIn });
+}
+
+
+void PlaybackEngine::stop() {
+	sendCommand({ TransportCommandQueue::Command::Stop, 0.0 });
+}
+
+
+bool PlaybackEngine::isPlaying() const {
+	return playingSnapshot_.load();
+}
+
+
+bool PlaybackEngine::hasStreamFinished() const {
+	return finishedSnapshot_.load();
+}
+
+
+/*
+ * Moves the playback position of the main file and every layer. If the file has a block
+ *   cache, the blocks around the new position are queued first (straight away, on this
+ *   thread), so the read-ahead buffer can refill from memory.
+ */
+void PlaybackEngine::setPosition(double seconds) {
+	if (currentFile_ != nullptr && currentFile_->blockCache != nullptr)
+		currentFile_->blockCache->prefetchAround((int64) (seconds * currentFile_->sampleRate));
+
+	sendCommand({ TransportCommandQueue::Command::Seek, seconds });
+}
+
+
+double PlaybackEngine::getPosition() const {
+	return positionSnapshot_.load();
+}
+
+
+/*
+ * Reads and resets the peaks published since the last call
+ */
+void PlaybackEngine::takePeakLevels(float *peaks) {
+	for (int channel = 0; channel < numMeterChannels; channel++)
+		peaks[channel] = peakLevels_[channel].exchange(0.0f);
+}
+
+
+/*
+ * Returns the number of channels the chain is running at (the file's, up to maxChannels)
+ */
+int PlaybackEngine::getNumChannels() const {
+	return numChannels_.load();
+}
+
+
+/*
+ * Sets the output of each channel (channels past the end of the map are muted; an empty map
+ *   goes back to the default). The audio thread picks the whole map up by the next block.
+ */
+void PlaybackEngine::setChannelMap(const Array<int> &outputForChannel) {
+	if (outputForChannel.isEmpty()) {
+		defaultChannelMap_ = true;
+		return;
+	}
+
+	for (int channel = 0; channel < maxChannels; channel++)
+		channelMap_[channel].store(channel < outputForChannel.size()
+			? jlimit(-1, (int) maxChannels - 1, outputForChannel[channel]) : -1);
+
+	defaultChannelMap_ = false;
+}
+
+
+/*
+ * Returns the output each of the current channels plays on, for a device with numOutputs
+ *   outputs (-1 for channels that aren't heard)
+ */
+Array<int> PlaybackEngine::getChannelMap(int numOutputs) const {
+	Array<int> outputs;
+
+	for (int channel = 0; channel < numChannels_.load(); channel++) {
+		const int output = defaultChannelMap_ ? channel % jmax(1, numOutputs) : channelMap_[channel].load();
+		outputs.add(output < numOutputs ? output : -1);
+	}
+
+	return outputs;
+}
+
+
+bool PlaybackEngine::hasDefaultChannelMap() const {
+	return defaultChannelMap_.load();
+}
+
+
+CallbackWorkerPool &PlaybackEngine::getWorkers() {
+	return workers_;
+}
+
+
+EffectRack &PlaybackEngine::getEffects() {
+	return effects_;
+}
+
+
+double PlaybackEngine::getLength() const {
+	return transportSource_.getLengthInSeconds();
+}
+
+
+/*
+ * True while commands sent from the message thread are waiting for the audio thread, or
+ *   have been applied but their state not yet published
+ */
+bool PlaybackEngine::hasPendingCommands() const {
+	return commandsApplied_.load() != commandsSent_.load();
+}
+
+
+uint32 PlaybackEngine::getStateVersion() const {
+	return stateVersion_.load();
+}
+
+
+PlayerParameters &PlaybackEngine::getParameters() {
+	return parameters_;
+}
+
+
+AudioThreadStats &PlaybackEngine::getStats() {
+	return stats_;
+}
+
+
+int PlaybackEngine::getExpectedBlockSize() const {
+	return expectedBlockSize_;
+}
+
+
+/*
+ * Starts scrubbing from the current position (does nothing without a block cache, a
+ *   preloaded file or a mapped one, since grains are only ever read from memory)
+ */
+void PlaybackEngine::beginScrub() {
+	if (currentFile_ == nullptr || currentFile_->scrubSource == nullptr)
+		return;
+
+	setScrubPosition(getPosition());
+	scrubber_.setActive(true);
+}
+
+
+/*
+ * Posts a new scrub position and prefetches the audio around it
+ */
+void PlaybackEngine::setScrubPosition(double seconds) {
+	if (currentFile_ == nullptr || currentFile_->scrubSource == nullptr)
+		return;
+
+	const int64 position = (int64) (seconds * currentFile_->sampleRate);
+	if (currentFile_->blockCache != nullptr)
+		currentFile_->blockCache->prefetchAround(position);
+	scrubber_.setPosition(position);
+}
+
+
+void PlaybackEngine::endScrub() {
+	scrubber_.setActive(false);
+}
+
+
+bool PlaybackEngine::isScrubbing() const {
+	return scrubber_.isActive();
+}
+
+
+/*
+ * Switches the main file's resampling kernel (takes effect straight away)
+ */
+void PlaybackEngine::setResamplerQuality(PolyphaseResampler::Quality quality) {
+	resampler_.setQuality(quality);
+}
+
+
+const PolyphaseResampler &PlaybackEngine::getResampler() const {
+	return resampler_;
+}
+
+
+MixerEngine &PlaybackEngine::getMixer() {
+	return mixer_;
+}
+
+
+SpectrumAnalyzer &PlaybackEngine::getAnalyzer() {
+	return analyzer_;
+}
+
+
+/*
+ * Returns the current file's block cache statistics (all zero if it has no cache)
+ */
+BlockCacheReader::Stats PlaybackEngine::getBlockCacheStats() const {
+	if (currentFile_ == nullptr || currentFile_->blockCache == nullptr)
+		return {};
+
+	return currentFile_->blockCache->getStats();
+}
+
+
+/*
+ * Returns the number of audio blocks the read-ahead buffer couldn't deliver in time
+ *   for the current file
+ */
+int PlaybackEngine::getBufferUnderruns() const {
+	if (currentFile_ == nullptr || currentFile_->readAheadSource == nullptr)
+		return 0;
+
+	return currentFile_->readAheadSource->getNumUnderruns();
+}
+
+
+/*
+ * Renders the current loop region's seam from a reader of its own and hands it to the loop
+ *   source (or removes the region when not looping). A region too short to loop, or a file
+ *   that can't be reopened, plays without looping.
+ */
+void PlaybackEngine::updateLoopRegion() {
+	if (!looping_ || currentFile_ == nullptr) {
+		loop_.setRegion(nullptr);
+		return;
+	}
+
+	std::unique_ptr<AudioFormatReader> reader(formatManager_.createReaderFor(currentFile_->file));
+
+	if (reader == nullptr) {
+		loop_.setRegion(nullptr);
+		return;
+	}
+
+	const double rate = currentFile_->sampleRate;
+	const int64 start = (int64) (loopStart_ * rate);
+	const int64 end = loopEnd_ > 0.0 ? (int64) (loopEnd_ * rate) : currentFile_->lengthInSamples;
+
+	loop_.setRegion(LoopRegionSource::renderRegion(*reader, start, end, roundToInt(loopFadeSeconds * rate),
+		roundToInt(loopResidentSeconds * rate)));
+}
+
+
+/*
+ * Queues a transport command for the audio thread. With no audio running (or, as a last
+ *   resort, a full queue) it's applied here instead.
+ */
+void PlaybackEngine::sendCommand(const TransportCommandQueue::Command &command) {
+	if (isPrepared_) {
+		// Counted before it's pushed, so the audio thread can't count it as applied first
+		commandsSent_++;
+		if (commands_.push(command))
+			return;
+		commandsSent_--;
+	}
+
+	jassert (!isPrepared_);		// the queue is large enough for any burst of UI actions
+	applyCommand(command);
+	publishState();
+	stateVersion_++;
+}
+
+
+/*
+ * Applies every queued command in order (audio thread, at the start of a block). They only
+ *   count as applied once the resulting state has been published and its version moved on.
+ */
+void PlaybackEngine::applyPendingCommands() {
+	TransportCommandQueue::Command command;
+	uint32 numApplied = 0;
+
+	while (commands_.pop(command)) {
+		applyCommand(command);
+		numApplied++;
+	}
+
+	if (numApplied > 0) {
+		publishState();
+		stateVersion_++;
+		commandsApplied_ += numApplied;
+	}
+}
+
+
+/*
+ * Starting arms the transport (which never waits for the audio thread, unlike stopping it)
+ *   and fades in (if asked to); stopping just stops pulling it, after one block that fades out
+ */
+void PlaybackEngine::applyCommand(const TransportCommandQueue::Command &command) {
+	switch (command.type) {
+		case TransportCommandQueue::Command::Start:
+			if (!transportSource_.isPlaying())
+				transportSource_.start();
+
+			if (!running_) {
+				running_ = true;
+				fadingIn_ = command.fadeIn;
+				fadingOut_ = false;
+			}
+			mixer_.setPlaying(true);
+			break;
+
+		case TransportCommandQueue::Command::Stop:
+			if (running_) {
+				running_ = fadingIn_ = false;
+				fadingOut_ = isPrepared_;
+			}
+			mixer_.setPlaying(false);
+			break;
+
+		case TransportCommandQueue::Command::Seek:
+			transportSource_.setPosition(command.seconds);
+			mixer_.setPosition(command.seconds);
+			break;
+	}
+}
+
+
+/*
+ * Publishes the transport's state & position for the message thread, moving the state
+ *   version on if it has started or stopped
+ */
+void PlaybackEngine::publishState() {
+	const bool playing = running_ && transportSource_.isPlaying();
+
+	finishedSnapshot_ = transportSource_.hasStreamFinished();
+	positionSnapshot_ = transportSource_.getCurrentPosition();
+
+	if (playingSnapshot_.exchange(playing) != playing)
+		stateVersion_++;
+}
+
+
+/*
+ * Raises each channel's published peak to this block's, if it's louder (a mono device shows
+ *   its one channel on both meters). A block landing between the UI's read and reset can
+ *   lose its peak, which a meter never notices.
+ */
+void PlaybackEngine::publishLevels(const AudioSourceChannelInfo &bufferToFill) {
+	const int numChannels = bufferToFill.buffer->getNumChannels();
+
+	if (numChannels == 0)
+		return;
+
+	for (int channel = 0; channel < numMeterChannels; channel++) {
+		const float peak = bufferToFill.buffer->getMagnitude(jmin(channel, numChannels - 1),
+			bufferToFill.startSample, bufferToFill.numSamples);
+
+		if (peak > peakLevels_[channel].load(std::memory_order_relaxed))
+			peakLevels_[channel].store(peak, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+  playback_engine.h -- interface for the player's audio processing chain
+	- Owns the loaded file, the transport and the volume/noise stage
+	- Runs at the file's channel count (up to 64 channels), and routes each
+	  channel to a device output through a channel map
+	- Splits the volume/noise stage of files with many channels, and the effect
+	  rack's branches, between the audio thread and a few workers (see
+	  callback_worker_pool.h)
+	- Holds an optional next file, which playback moves on to gaplessly (see
+	  playlist_source.h)
+	- Loops the whole file or a region of it, with a pre-rendered crossfade at
+	  the seam (see loop_region_source.h)
+	- Runs the transport's output through the effect rack's parallel chains
+	  (see effect_rack.h) before the volume/noise stage
+	- Converts the file's sample rate to the device's with a selectable
+	  resampler (see polyphase_resampler.h)
+	- Mixes any layers (see mixer_engine.h) in after the volume/noise stage
+	- Plays scrub grains instead of the transport while the position is being
+	  dragged (see scrub_processor.h)
+	- Transport actions are queued and applied by the audio thread at the start
+	  of a block (see transport_command_queue.h); the resulting state & position
+	  are published back through atomics, with a version number that moves on
+	  whenever commands are applied or the playing state changes, for the UI to
+	  poll (the audio thread never posts messages)
+	- Publishes the output's peak level per channel for meters, held until the
+	  UI next reads it
+	- Feeds the main file's audio, after volume & noise, to a spectrum analyzer
+	  running on its own thread (see spectrum_analyzer.h)
+	- Independent of the GUI, so the same chain can run inside a live audio
+	  device callback or be pulled offline (see headless_renderer.h)
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "audio_thread_stats.h"
+#include "callback_worker_pool.h"
+#include "effect_rack.h"
+#include "file_loader.h"
+#include "gain_noise_processor.h"
+#include "loop_region_source.h"
+#include "mixer_engine.h"
+#include "player_parameters.h"
+#include "playlist_source.h"
+#include "polyphase_resampler.h"
+#include "scrub_processor.h"
+#include "spectrum_analyzer.h"
+#include "transport_command_queue.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    The player's processing chain: file -> loop -> resampler -> transport (or
+    scrub) -> effects -> volume & noise -> channel map, plus the layer mixer.
+*/
+class PlaybackEngine : public AudioSource,
+                       private CallbackWorkerPool::Job
+{
+public:
+	enum {
+		numMeterChannels = 2,
+		maxChannels = GainNoiseProcessor::maxChannels	// a file's channels beyond this are dropped
+	};
+
+	PlaybackEngine();
+	~PlaybackEngine();
+
+	// Redefinitions of AudioSource methods
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+	void releaseResources() override;
+	void getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) override;
+
+	// File handling (message thread)
+	void setFile(std::unique_ptr<LoadedFile> loadedFile);
+	const LoadedFile *getFile() const;
+
+	// Looping (message thread). The loop points are in seconds; an end of 0 (the default for
+	//   each new file) means the end of the file. Changing them while looping re-renders the
+	//   seam, which playback picks up without a gap.
+	void setLooping(bool shouldLoop);
+	bool isLooping() const;
+	void setLoopPoints(double startSeconds, double endSeconds);
+	double getLoopStart() const;
+	double getLoopEnd() const;
+
+	// Gapless playlist (message thread). queueNextFile() refuses files whose sample rate or
+	//   channel count differs from the current one; updatePlaylist() returns true if playback
+	//   has moved on to the queued file since the last call.
+	bool queueNextFile(std::unique_ptr<LoadedFile> loadedFile);
+	const LoadedFile *getNextFile() const;
+	bool updatePlaylist();
+
+	// Loudness normalization gain for the current or the queued file (message thread). Each
+	//   file keeps its own, so playback moving on to the queued file switches to its gain
+	//   on the audio thread, without waiting for the message thread to notice.
+	void setNormalization(const LoadedFile &file, float gain);
+
+	// Transport control (message thread). While the engine is prepared, start/stop/setPosition
+	//   are applied by the audio thread at the next block; the state & position returned are
+	//   those published by the last block. Starting fades in unless fadeIn is false (offline
+	//   renders start at full level, so the file's first samples come through unchanged).
+	//   getStateVersion() changes each time the published state is worth another look: once
+	//   commands have been applied (and hasPendingCommands() is false) or the transport has
+	//   started/stopped by itself.
+	void start(bool fadeIn = true);
+	void stop();
+	bool isPlaying() const;
+	bool hasStreamFinished() const;
+	void setPosition(double seconds);
+	double getPosition() const;
+	double getLength() const;
+	bool hasPendingCommands() const;
+	uint32 getStateVersion() const;
+
+	// Output metering (message thread): the peak gain of each channel since the last call
+	void takePeakLevels(float *peaks);
+
+	// Channel routing (message thread). The map gives each of the file's channels a device
+	//   output, or -1 for none; an output fed by several channels plays their average. The
+	//   default (restored by an empty map, and for each new file) plays channel n on output
+	//   n, wrapping round when the device has fewer outputs than the file has channels (and
+	//   plays a mono file on every output).
+	int getNumChannels() const;
+	void setChannelMap(const Array<int> &outputForChannel);
+	Array<int> getChannelMap(int numOutputs) const;
+	bool hasDefaultChannelMap() const;
+
+	// Workers shared by the stages that can split a block up (none by default)
+	CallbackWorkerPool &getWorkers();
+
+	// Effect chains run on the file's channels (empty by default)
+	EffectRack &getEffects();
+
+	// Live scrubbing (message thread). Only available when the file is held in memory: by a
+	//   block cache, a preload or a mapping.
+	void beginScrub();
+	void setScrubPosition(double seconds);
+	void endScrub();
+	bool isScrubbing() const;
+
+	// Sample rate conversion of the main file
+	void setResamplerQuality(PolyphaseResampler::Quality quality);
+	const PolyphaseResampler &getResampler() const;
+
+	// Layers played along with the main file
+	MixerEngine &getMixer();
+
+	// Spectrum of the main file's output (inactive until the UI activates it)
+	SpectrumAnalyzer &getAnalyzer();
+
+	// Parameters & statistics
+	PlayerParameters &getParameters();
+	AudioThreadStats &getStats();
+	int getExpectedBlockSize() const;
+	int getBufferUnderruns() const;
+	BlockCacheReader::Stats getBlockCacheStats() const;
+
+private:
+	// Redefinition of CallbackWorkerPool::Job method (one channel of the volume/noise stage)
+	void processItem(int channel, int threadIndex) override;
+
+	// Private helper functions
+	void routeToOutputs(const AudioSourceChannelInfo &bufferToFill, int offset, int numSamples);
+	void sendCommand(const TransportCommandQueue::Command &command);
+	void applyPendingCommands();
+	void applyCommand(const TransportCommandQueue::Command &command);
+	void publishState();
+	void publishLevels(const AudioSourceChannelInfo &bufferToFill);
+	void updateLoopRegion();
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	// Opens a second reader on the current file to render loop seams from
+	AudioFormatManager formatManager_;
+
+	// Parameters shared with the audio thread, and the stage that applies them (with the
+	//   workers it can use, and the piece of the block they're working on)
+	PlayerParameters parameters_;
+	GainNoiseProcessor gainNoise_;
+	CallbackWorkerPool workers_;
+	float *const *workerChannels_;
+	int workerNumSamples_;
+	PlayerParameters::Ramp workerGain_;
+	PlayerParameters::Ramp workerNoise_;
+
+	// Effect chains, prepared for the file's channel count (their branches share the workers)
+	EffectRack effects_;
+
+	// The file's channels are rendered here (sized for maxChannels), then routed to the
+	//   device's outputs through the map
+	AudioBuffer<float> renderBuffer_;
+	int renderCapacity_;
+	double sampleRate_;
+	std::atomic<int> numChannels_;
+	std::atomic<int> channelMap_[maxChannels];
+	std::atomic<bool> defaultChannelMap_;
+
+	// Scrub grains, and the lock that keeps the audio thread off a file being swapped out
+	ScrubProcessor scrubber_;
+	CriticalSection scrubLock_;
+
+	// Layers (started & stopped with the transport)
+	MixerEngine mixer_;
+
+	// Timing of each callback stage
+	AudioThreadStats stats_;
+
+	// Spectrum of the volume & noise stage's output
+	SpectrumAnalyzer analyzer_;
+
+	// Current & queued files, the playlist that joins them, the loop, the rate converter and
+	//   the transport (declared last so it lets go of the files' sources before they're
+	//   deleted). The transport does no rate correction of its own.
+	std::unique_ptr<LoadedFile> currentFile_;
+	std::unique_ptr<LoadedFile> nextFile_;
+	PlaylistSource playlist_;
+	LoopRegionSource loop_;
+	PolyphaseResampler resampler_;
+	AudioTransportSource transportSource_;
+	int expectedBlockSize_;
+
+	// Commands to the transport, and the state it's published back (set while the audio
+	//   thread is running, when it's the one that applies commands)
+	TransportCommandQueue commands_;
+	std::atomic<bool> isPrepared_;
+	std::atomic<bool> playingSnapshot_;
+	std::atomic<bool> finishedSnapshot_;
+	std::atomic<double> positionSnapshot_;
+	std::atomic<uint32> stateVersion_;
+	std::atomic<uint32> commandsSent_;		// written by the message thread only
+	std::atomic<uint32> commandsApplied_;	// moved on once their state has been published
+	std::atomic<float> peakLevels_[numMeterChannels];	// reset to 0 as they're taken
+
+	// Whether the transport is being pulled, and whether the next block fades in or out
+	//   (owned by whichever thread applies commands)
+	bool running_;
+	bool fadingIn_;
+	bool fadingOut_;
+
+	// Loop settings for the current file
+	bool looping_;
+	double loopStart_;
+	double loopEnd_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaybackEngine)
+};
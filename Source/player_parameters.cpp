@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+  player_parameters.cpp -- implementation of the player's real-time parameter layer
+
+  ==============================================================================
+*/
+
+#include "player_parameters.h"
+
+namespace {
+	// Default values, indexed by PlayerParameters::ParameterId
+	const float defaultValues[PlayerParameters::NumParameters] = {
+		1.0f,	// Volume
+		0.0f,	// Noise
+		1.0f	// Normalization
+	};
+}
+
+//==============================================================================
+
+// Constructor
+PlayerParameters::PlayerParameters()
+{
+	for (int id = 0; id < NumParameters; id++) {
+		targets_[id].store(defaultValues[id]);
+		ramps_[id] = { defaultValues[id], defaultValues[id] };
+	}
+}
+
+
+/*
+ * Sets the value the given parameter should move to (called from the message thread)
+ */
+void PlayerParameters::setValue(ParameterId id, float newValue) {
+	targets_[id].store(newValue, std::memory_order_relaxed);
+}
+
+
+/*
+ * Returns the value the given parameter is moving to
+ */
+float PlayerParameters::getValue(ParameterId id) const {
+	return targets_[id].load(std::memory_order_relaxed);
+}
+
+
+/*
+ * Reads every target once and sets up this block's ramps, which start where the previous
+ *   block's ramps ended (called from the audio thread, once per block)
+ */
+void PlayerParameters::startBlock() {
+	for (int id = 0; id < NumParameters; id++) {
+		ramps_[id].start = ramps_[id].end;
+		ramps_[id].end = targets_[id].load(std::memory_order_relaxed);
+	}
+}
+
+
+/*
+ * Returns the given parameter's ramp for the current block
+ */
+const PlayerParameters::Ramp &PlayerParameters::getRamp(ParameterId id) const {
+	return ramps_[id];
+}
+
+
+/*
+ * Drops any ramp in progress so the next block starts at the targets
+ */
+void PlayerParameters::snapToTargets() {
+	for (int id = 0; id < NumParameters; id++) {
+		float target = targets_[id].load(std::memory_order_relaxed);
+		ramps_[id] = { target, target };
+	}
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+  player_parameters.h -- interface for the player's real-time parameter layer
+	- Values are written by the UI as atomics and read once per audio block
+	- Each block gets a linear ramp from the previous value to the new one,
+	  which removes zipper noise when a slider is dragged
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Lock-free parameter snapshot shared between the message thread and the audio
+    thread. To add a parameter, add an ID before NumParameters and give it a
+    default value in player_parameters.cpp - nothing else needs to change.
+*/
+class PlayerParameters
+{
+public:
+	// Parameter IDs
+	enum ParameterId {
+		Volume = 0,
+		Noise,
+		Normalization,		// loudness normalization gain, applied with the volume
+		NumParameters
+	};
+
+	// Start & end value of a parameter across the current audio block
+	struct Ramp {
+		float start;
+		float end;
+
+		bool isRamping() const { return start != end; }
+	};
+
+	PlayerParameters();
+
+	// Message thread: set/get the target value of a parameter
+	void setValue(ParameterId id, float newValue);
+	float getValue(ParameterId id) const;
+
+	// Audio thread: latch every target once, then read the ramps for this block
+	void startBlock();
+	const Ramp &getRamp(ParameterId id) const;
+
+	// Audio thread: jump straight to the targets (e.g. after prepareToPlay)
+	void snapToTargets();
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	std::atomic<float> targets_[NumParameters];
+	Ramp ramps_[NumParameters];
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayerParameters)
+};
@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+  playlist_queue.cpp -- implementation of the player's list of files to play next
+
+  ==============================================================================
+*/
+
+#include "playlist_queue.h"
+
+namespace {
+	// How often the engine is checked for a finished file or an empty "next" slot
+	const int pollIntervalMs = 50;
+}
+
+//==============================================================================
+
+// Constructor
+PlaylistQueue::PlaylistQueue(PlaybackEngine &engine, AudioFormatManager &formatManager,
+                             TimeSliceThread &readAheadThread)
+	: engine_(engine),
+	  loader_(formatManager, readAheadThread, *this),
+	  numSkipped_(0)
+{
+}
+
+
+// Destructor
+PlaylistQueue::~PlaylistQueue()
+{
+	stopTimer();
+	loader_.cancel();
+}
+
+
+/*
+ * Adds files to the end of the list
+ */
+void PlaylistQueue::addFiles(const Array<File> &files, const LoadOptions &options) {
+	options_ = options;
+	pending_.addArray(files);
+	updatePolling();
+	sendChangeMessage();
+}
+
+
+/*
+ * Empties the list and abandons any file being opened or held back (a file already queued
+ *   in the engine still plays)
+ */
+void PlaylistQueue::clear() {
+	loader_.cancel();
+	held_.reset();
+	pending_.clear();
+	numSkipped_ = 0;
+	updatePolling();
+	sendChangeMessage();
+}
+
+
+/*
+ * Sets the check a file has to pass before it's queued in the engine (nullptr for none)
+ */
+void PlaylistQueue::setReadyCheck(std::function<bool(const File &file)> isReady) {
+	isReady_ = isReady;
+}
+
+
+StringArray PlaylistQueue::getUpcomingFileNames() const {
+	StringArray names;
+
+	if (auto *next = engine_.getNextFile())
+		names.add(next->file.getFileName());
+
+	if (held_ != nullptr)
+		names.add(held_->file.getFileName());
+
+	for (auto &file : pending_)
+		names.add(file.getFileName());
+
+	return names;
+}
+
+
+/*
+ * Number of files dropped because they couldn't be opened or didn't match the current
+ *   file's sample rate & channel count
+ */
+int PlaylistQueue::getNumFilesSkipped() const {
+	return numSkipped_;
+}
+
+
+/*
+ * Retires finished files, queues a held-back file once it's ready, and starts opening the
+ *   next one as soon as the engine has room for it - normally right after the previous file
+ *   starts, well before it ends
+ */
+void PlaylistQueue::timerCallback() {
+	if (engine_.updatePlaylist())
+		sendChangeMessage();
+
+	if (held_ != nullptr && (isReady_ == nullptr || isReady_(held_->file))) {
+		queueFile(std::move(held_));
+		sendChangeMessage();
+	}
+
+	if (engine_.getFile() != nullptr && engine_.getNextFile() == nullptr && held_ == nullptr
+	    && !loader_.isLoading() && !pending_.isEmpty())
+		loader_.load(pending_.removeAndReturn(0), options_, engine_.getExpectedBlockSize());
+
+	updatePolling();
+}
+
+
+/*
+ * Called on the message thread once the next file is primed. It's held back if it isn't
+ *   ready yet, and queued by a later poll.
+ */
+void PlaylistQueue::fileLoaded(std::unique_ptr<LoadedFile> loadedFile) {
+	if (isReady_ != nullptr && !isReady_(loadedFile->file))
+		held_ = std::move(loadedFile);
+	else
+		queueFile(std::move(loadedFile));
+
+	updatePolling();
+	sendChangeMessage();
+}
+
+
+void PlaylistQueue::fileLoadFailed(const File &) {
+	numSkipped_++;
+	updatePolling();
+	sendChangeMessage();
+}
+
+
+/*
+ * Hands a file to the engine, counting it as skipped if the engine refuses it
+ */
+void PlaylistQueue::queueFile(std::unique_ptr<LoadedFile> loadedFile) {
+	if (!engine_.queueNextFile(std::move(loadedFile)))
+		numSkipped_++;
+}
+
+
+/*
+ * Polls while a queued file is waiting for playback to reach it, a file is held back, or
+ *   files are still to be opened; stops once the queue has run dry
+ */
+void PlaylistQueue::updatePolling() {
+	if (engine_.getNextFile() != nullptr || held_ != nullptr || !pending_.isEmpty()) {
+		if (!isTimerRunning())
+			startTimer(pollIntervalMs);
+	}
+	else {
+		stopTimer();
+	}
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+  playlist_queue.h -- interface for the player's list of files to play next
+	- Keeps the engine's "next file" slot filled: as soon as it's empty, the
+	  next file in the list is opened & primed on a background thread and
+	  queued behind the current one
+	- Hands finished files back from the engine and tells listeners when
+	  playback has moved on to a new file
+	- Only polls the engine while there's a file queued or still to come, so
+	  an empty queue doesn't keep waking the message thread
+	- Can hold an opened file back from the engine until the owner says it's
+	  ready (e.g. once its loudness has been measured)
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "file_loader.h"
+#include "playback_engine.h"
+
+//==============================================================================
+/*
+    Files waiting to be played after the current one. Sends a change message
+    whenever the current file or the list changes.
+*/
+class PlaylistQueue : public ChangeBroadcaster,
+                      private Timer,
+                      private FileLoader::Listener
+{
+public:
+	PlaylistQueue(PlaybackEngine &engine, AudioFormatManager &formatManager, TimeSliceThread &readAheadThread);
+	~PlaylistQueue();
+
+	// List handling (message thread); the options are used for every file opened from now on
+	void addFiles(const Array<File> &files, const LoadOptions &options);
+	void clear();
+
+	// Files are only queued in the engine once this returns true for them (asked again on
+	//   each poll while one is held back); by default every file is ready straight away
+	void setReadyCheck(std::function<bool(const File &file)> isReady);
+
+	// The files still to come, including the one queued in the engine (or held back)
+	StringArray getUpcomingFileNames() const;
+	int getNumFilesSkipped() const;
+
+private:
+	// Redefinitions of Timer & FileLoader::Listener methods
+	void timerCallback() override;
+	void fileLoaded(std::unique_ptr<LoadedFile> loadedFile) override;
+	void fileLoadFailed(const File &file) override;
+
+	// Private helper functions
+	void queueFile(std::unique_ptr<LoadedFile> loadedFile);
+	void updatePolling();
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	PlaybackEngine &engine_;
+	FileLoader loader_;
+	LoadOptions options_;
+
+	Array<File> pending_;
+	int numSkipped_;
+
+	// An opened file waiting for the ready check, and the check itself
+	std::unique_ptr<LoadedFile> held_;
+	std::function<bool(const File &file)> isReady_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistQueue)
+};
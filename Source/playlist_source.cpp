@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+  playlist_source.cpp -- implementation of the gapless playlist source
+
+  ==============================================================================
+*/
+
+#include "playlist_source.h"
+
+//==============================================================================
+
+// Constructor
+PlaylistSource::PlaylistSource()
+	: current_(nullptr),
+	  next_(nullptr),
+	  advanced_(false),
+	  currentGain_(1.0f),
+	  nextGain_(1.0f),
+	  pendingPosition_(-1),
+	  blockSize_(512),
+	  sampleRate_(44100.0),
+	  isPrepared_(false)
+{
+}
+
+
+// Destructor
+PlaylistSource::~PlaylistSource()
+{
+}
+
+
+/*
+ * Replaces the current item and drops the next one
+ */
+void PlaylistSource::setCurrent(PositionableAudioSource *source) {
+	const ScopedLock sl(lock_);
+	current_ = source;
+	next_ = nullptr;
+	advanced_ = false;
+	currentGain_ = 1.0f;
+	pendingPosition_ = -1;
+}
+
+
+/*
+ * Queues the item to play once the current one ends. It's prepared here, on the calling
+ *   thread, so that starting it later costs the audio thread nothing.
+ */
+void PlaylistSource::setNext(PositionableAudioSource *source) {
+	if (source != nullptr && isPrepared_)
+		source->prepareToPlay(blockSize_, sampleRate_);
+
+	const ScopedLock sl(lock_);
+	next_ = source;
+	nextGain_ = 1.0f;
+}
+
+
+bool PlaylistSource::hasNext() const {
+	const ScopedLock sl(lock_);
+	return next_ != nullptr;
+}
+
+
+bool PlaylistSource::takeAdvance() {
+	return advanced_.exchange(false);
+}
+
+
+/*
+ * Sets an item's gain. Items are matched under the lock, so a gain meant for the item that
+ *   just finished can't land on the one that replaced it.
+ */
+void PlaylistSource::setGain(const PositionableAudioSource *source, float gain) {
+	const ScopedLock sl(lock_);
+
+	if (source == nullptr)
+		return;
+
+	if (source == current_)
+		currentGain_ = gain;
+	else if (source == next_)
+		nextGain_ = gain;
+}
+
+
+float PlaylistSource::getCurrentGain() const {
+	return currentGain_.load(std::memory_order_relaxed);
+}
+
+
+/*
+ * Prepares both items, and remembers the settings for items queued later
+ */
+void PlaylistSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+	blockSize_ = samplesPerBlockExpected;
+	sampleRate_ = sampleRate;
+	isPrepared_ = true;
+
+	const ScopedLock sl(lock_);
+
+	if (current_ != nullptr)
+		current_->prepareToPlay(samplesPerBlockExpected, sampleRate);
+	if (next_ != nullptr)
+		next_->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+
+void PlaylistSource::releaseResources() {
+	isPrepared_ = false;
+
+	const ScopedLock sl(lock_);
+
+	if (current_ != nullptr)
+		current_->releaseResources();
+	if (next_ != nullptr)
+		next_->releaseResources();
+}
+
+
+/*
+ * Plays the current item, from a posted position if there is one. If it ends inside this
+ *   block and another item is queued (and the current one isn't looping), the rest of the
+ *   block comes from the next item, which then becomes current along with its gain.
+ */
+void PlaylistSource::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+	const ScopedLock sl(lock_);
+
+	if (current_ == nullptr) {
+		bufferToFill.clearActiveBufferRegion();
+		return;
+	}
+
+	const int64 position = pendingPosition_.exchange(-1);
+	if (position >= 0)
+		current_->setNextReadPosition(position);
+
+	const int64 remaining = current_->getTotalLength() - current_->getNextReadPosition();
+
+	if (next_ == nullptr || current_->isLooping() || remaining >= bufferToFill.numSamples) {
+		current_->getNextAudioBlock(bufferToFill);
+		return;
+	}
+
+	const int numFromCurrent = (int) jmax((int64) 0, remaining);
+
+	if (numFromCurrent > 0)
+		current_->getNextAudioBlock(AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample, numFromCurrent));
+
+	next_->getNextAudioBlock(AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + numFromCurrent,
+		bufferToFill.numSamples - numFromCurrent));
+
+	current_ = next_;
+	next_ = nullptr;
+	currentGain_.store(nextGain_, std::memory_order_relaxed);
+	advanced_ = true;
+}
+
+
+/*
+ * Posts a position in the current item for the next block to seek to (any thread; nothing
+ *   is locked)
+ */
+void PlaylistSource::setNextReadPosition(int64 newPosition) {
+	pendingPosition_.store(jmax((int64) 0, newPosition));
+}
+
+
+int64 PlaylistSource::getNextReadPosition() const {
+	const int64 pending = pendingPosition_.load();
+	if (pending >= 0)
+		return pending;
+
+	const ScopedLock sl(lock_);
+	return current_ != nullptr ? current_->getNextReadPosition() : 0;
+}
+
+
+int64 PlaylistSource::getTotalLength() const {
+	const ScopedLock sl(lock_);
+	return current_ != nullptr ? current_->getTotalLength() : 0;
+}
+
+
+bool PlaylistSource::isLooping() const {
+	const ScopedLock sl(lock_);
+	return current_ != nullptr && current_->isLooping();
+}
+
+
+void PlaylistSource::setLooping(bool shouldLoop) {
+	const ScopedLock sl(lock_);
+
+	if (current_ != nullptr)
+		current_->setLooping(shouldLoop);
+}
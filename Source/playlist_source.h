@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+  playlist_source.h -- interface for the gapless playlist source
+	- Plays the current item and, when it runs out, carries straight on into
+	  the next one within the same audio block
+	- The next item is opened and primed before it's handed over, so the
+	  switch itself is just a pointer swap: no allocation, I/O or waiting on
+	  the audio thread
+	- The finished item is handed back to the message thread to be deleted
+	- Each item carries its own gain (its loudness normalization), which
+	  becomes current along with the item
+	- Seeks are posted without locking and applied to the current item at the
+	  start of the next block
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    A PositionableAudioSource made of a current item and an optional next item.
+    Neither is owned. Positions & lengths are those of the current item.
+*/
+class PlaylistSource : public PositionableAudioSource
+{
+public:
+	PlaylistSource();
+	~PlaylistSource();
+
+	// Item handling (message thread). setNext() prepares the item before queueing it.
+	void setCurrent(PositionableAudioSource *source);
+	void setNext(PositionableAudioSource *source);
+	bool hasNext() const;
+
+	// Message thread: true (once) after the audio thread has moved on to the next item
+	bool takeAdvance();
+
+	// Item gains: setGain() applies to whichever item (current or next) the source is, and is
+	//   ignored if it's neither; items start at unity. getCurrentGain() is the current item's
+	//   (any thread).
+	void setGain(const PositionableAudioSource *source, float gain);
+	float getCurrentGain() const;
+
+	// Redefinitions of AudioSource methods
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+	void releaseResources() override;
+	void getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) override;
+
+	// Redefinitions of PositionableAudioSource methods
+	void setNextReadPosition(int64 newPosition) override;
+	int64 getNextReadPosition() const override;
+	int64 getTotalLength() const override;
+	bool isLooping() const override;
+	void setLooping(bool shouldLoop) override;
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	// Held by the audio thread for each block, and briefly by the message thread to swap items
+	CriticalSection lock_;
+	PositionableAudioSource *current_;
+	PositionableAudioSource *next_;
+	std::atomic<bool> advanced_;
+	std::atomic<float> currentGain_;
+	float nextGain_;
+
+	// Position posted for the current item by setNextReadPosition() (-1 for none)
+	std::atomic<int64> pendingPosition_;
+
+	// Settings from the last prepareToPlay(), applied to items queued later
+	int blockSize_;
+	double sampleRate_;
+	bool isPrepared_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistSource)
+};
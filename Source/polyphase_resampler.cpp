@@ -0,0 +1,407 @@
+/*
+  ==============================================================================
+
+  polyphase_resampler.cpp -- implementation of the player's sample rate converter
+
+  ==============================================================================
+*/
+
+#include "polyphase_resampler.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// Smoothing applied to the published cost figures
+	const float costSmoothing = 0.05f;
+
+	/*
+	 * Dot product with four independent sums, which the compiler can keep in one vector
+	 *   register (the tap counts are all multiples of two, and usually of four)
+	 */
+	inline float dotProduct(const float *coefficients, const float *samples, int numTaps) {
+		float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+		int tap = 0;
+
+		for (; tap + 4 <= numTaps; tap += 4) {
+			sum0 += coefficients[tap] * samples[tap];
+			sum1 += coefficients[tap + 1] * samples[tap + 1];
+			sum2 += coefficients[tap + 2] * samples[tap + 2];
+			sum3 += coefficients[tap + 3] * samples[tap + 3];
+		}
+
+		for (; tap < numTaps; tap++)
+			sum0 += coefficients[tap] * samples[tap];
+
+		return (sum0 + sum1) + (sum2 + sum3);
+	}
+
+	// Kernel value at distance d (in input samples) from the output position
+	double evaluateKernel(PolyphaseResampler::Quality quality, double d, double cutoff, int halfTaps) {
+		const double x = std::abs(d);
+
+		switch (quality) {
+			case PolyphaseResampler::Linear:
+				return jmax(0.0, 1.0 - x);
+
+			case PolyphaseResampler::Cubic:		// Catmull-Rom
+				if (x < 1.0)
+					return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+				if (x < 2.0)
+					return -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0;
+				return 0.0;
+
+			default: {							// Blackman-windowed sinc
+				if (x >= halfTaps)
+					return 0.0;
+
+				const double arg = MathConstants<double>::pi * 2.0 * cutoff * d;
+				const double sinc = (x < 1.0e-9) ? 1.0 : std::sin(arg) / arg;
+				const double phase = MathConstants<double>::pi * d / halfTaps;
+				const double window = 0.42 + 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+				return 2.0 * cutoff * sinc * window;
+			}
+		}
+	}
+}
+
+//==============================================================================
+
+// Constructor
+PolyphaseResampler::PolyphaseResampler()
+	: input_(nullptr),
+	  inputRate_(44100.0),
+	  outputRate_(44100.0),
+	  ratio_(1.0),
+	  numChannels_(2),
+	  maxBlockSize_(512),
+	  quality_(Sinc16),
+	  numTaps_(0),
+	  numPhases_(0),
+	  numBuffered_(0),
+	  readPosition_(0.0),
+	  pendingPosition_(-1),
+	  microsPerBlock_(0.0f),
+	  loadPercent_(0.0f)
+{
+}
+
+
+// Destructor
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+
+String PolyphaseResampler::getQualityName(Quality quality) {
+	switch (quality) {
+		case Linear:	return "Linear";
+		case Cubic:		return "Cubic";
+		case Sinc16:	return "Sinc (16 taps)";
+		case Sinc64:	return "Sinc (64 taps)";
+		default:		return {};
+	}
+}
+
+
+/*
+ * Sets the source to resample and its rate. The source isn't owned.
+ */
+void PolyphaseResampler::setInput(PositionableAudioSource *source, double inputSampleRate, int numChannels) {
+	input_ = source;
+	pendingPosition_ = -1;
+	inputRate_ = inputSampleRate > 0.0 ? inputSampleRate : outputRate_;
+	numChannels_ = jmax(2, numChannels);
+	configure();
+}
+
+
+/*
+ * Switches kernel; the new table is built before the audio thread is (briefly) held up
+ */
+void PolyphaseResampler::setQuality(Quality newQuality) {
+	quality_ = newQuality;
+	configure();
+}
+
+
+PolyphaseResampler::Quality PolyphaseResampler::getQuality() const {
+	return quality_;
+}
+
+
+double PolyphaseResampler::getInputSampleRate() const {
+	return inputRate_;
+}
+
+
+double PolyphaseResampler::getOutputSampleRate() const {
+	return outputRate_;
+}
+
+
+bool PolyphaseResampler::isBypassed() const {
+	return ratio_ == 1.0;
+}
+
+
+double PolyphaseResampler::getMicrosPerBlock() const {
+	return microsPerBlock_.load(std::memory_order_relaxed);
+}
+
+
+double PolyphaseResampler::getLoadPercent() const {
+	return loadPercent_.load(std::memory_order_relaxed);
+}
+
+
+/*
+ * Rebuilds the configuration for the output rate, and prepares the input for the number of
+ *   input samples a block can need
+ */
+void PolyphaseResampler::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+	outputRate_ = sampleRate;
+	maxBlockSize_ = jmax(1, samplesPerBlockExpected);
+	configure();
+
+	if (input_ != nullptr)
+		input_->prepareToPlay((int) std::ceil(maxBlockSize_ * ratio_) + numTaps_, inputRate_);
+}
+
+
+void PolyphaseResampler::releaseResources() {
+	if (input_ != nullptr)
+		input_->releaseResources();
+}
+
+
+/*
+ * Fills the block, a prepared block size at a time, timing only the filtering itself (not
+ *   the time spent pulling from the input)
+ */
+void PolyphaseResampler::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+	const ScopedLock sl(lock_);
+
+	if (input_ == nullptr) {
+		bufferToFill.clearActiveBufferRegion();
+		return;
+	}
+
+	applyPendingPosition();
+
+	if (ratio_ == 1.0 || numTaps_ == 0) {
+		input_->getNextAudioBlock(bufferToFill);
+		return;
+	}
+
+	int64 filterTicks = 0;
+
+	for (int offset = 0; offset < bufferToFill.numSamples; offset += maxBlockSize_) {
+		const int num = jmin(maxBlockSize_, bufferToFill.numSamples - offset);
+		filterTicks += processChunk(*bufferToFill.buffer, bufferToFill.startSample + offset, num);
+	}
+
+	const float micros = (float) (Time::highResolutionTicksToSeconds(filterTicks) * 1.0e6);
+	const float load = 100.0f * micros / (float) (1.0e6 * bufferToFill.numSamples / outputRate_);
+	const float lastMicros = microsPerBlock_.load(std::memory_order_relaxed);
+	const float lastLoad = loadPercent_.load(std::memory_order_relaxed);
+
+	microsPerBlock_.store(lastMicros + costSmoothing * (micros - lastMicros), std::memory_order_relaxed);
+	loadPercent_.store(lastLoad + costSmoothing * (load - lastLoad), std::memory_order_relaxed);
+}
+
+
+/*
+ * Posts the position for the next block to seek to (any thread, including the audio thread
+ *   between blocks; nothing is locked)
+ */
+void PolyphaseResampler::setNextReadPosition(int64 newPosition) {
+	pendingPosition_.store(jmax((int64) 0, newPosition));
+}
+
+
+/*
+ * The input's position, less the input samples buffered but not yet used, in output samples
+ *   (or the position posted for the next block)
+ */
+int64 PolyphaseResampler::getNextReadPosition() const {
+	const int64 pending = pendingPosition_.load();
+
+	if (pending >= 0)
+		return pending;
+
+	if (input_ == nullptr)
+		return 0;
+
+	if (ratio_ == 1.0)
+		return input_->getNextReadPosition();
+
+	const double unused = (double) numBuffered_ - readPosition_;
+	return jmax((int64) 0, (int64) std::llround(((double) input_->getNextReadPosition() - unused) / ratio_));
+}
+
+
+int64 PolyphaseResampler::getTotalLength() const {
+	return input_ != nullptr ? (int64) ((double) input_->getTotalLength() / ratio_) : 0;
+}
+
+
+bool PolyphaseResampler::isLooping() const {
+	return input_ != nullptr && input_->isLooping();
+}
+
+
+void PolyphaseResampler::setLooping(bool shouldLoop) {
+	if (input_ != nullptr)
+		input_->setLooping(shouldLoop);
+}
+
+
+/*
+ * Builds the polyphase table & history buffer for the current rates and quality, then swaps
+ *   them in. Sinc kernels get wider (and their cutoff lower) when downsampling.
+ */
+void PolyphaseResampler::configure() {
+	const double newRatio = outputRate_ > 0.0 ? inputRate_ / outputRate_ : 1.0;
+
+	if (newRatio == 1.0) {
+		const ScopedLock sl(lock_);
+		ratio_ = 1.0;
+		numTaps_ = 0;
+		table_.free();
+		history_.setSize(1, 1);
+		return;
+	}
+
+	const double stretch = jmax(1.0, newRatio);
+	int newNumTaps = 2, newNumPhases = 256;
+	double cutoff = 0.5;
+
+	switch (quality_) {
+		case Linear:	newNumTaps = 2;		break;
+		case Cubic:		newNumTaps = 4;		break;
+		case Sinc16:
+			newNumTaps = jmin(256, ((int) std::ceil(16 * stretch) + 3) & ~3);
+			newNumPhases = 512;
+			cutoff = 0.5 * 0.90 / stretch;
+			break;
+		default:
+			newNumTaps = jmin(256, ((int) std::ceil(64 * stretch) + 3) & ~3);
+			newNumPhases = 512;
+			cutoff = 0.5 * 0.96 / stretch;
+			break;
+	}
+
+	// One row per phase (plus a final row for interpolating past the last phase), each
+	//   normalised to unity gain at DC
+	const int halfTaps = newNumTaps / 2;
+	HeapBlock<float> newTable((size_t) ((newNumPhases + 1) * newNumTaps));
+
+	for (int phase = 0; phase <= newNumPhases; phase++) {
+		const double fraction = (double) phase / newNumPhases;
+		auto *row = newTable.get() + phase * newNumTaps;
+		double sum = 0.0;
+
+		for (int tap = 0; tap < newNumTaps; tap++) {
+			const double value = evaluateKernel(quality_, (tap - (halfTaps - 1)) - fraction, cutoff, halfTaps);
+			row[tap] = (float) value;
+			sum += value;
+		}
+
+		if (sum != 0.0)
+			for (int tap = 0; tap < newNumTaps; tap++)
+				row[tap] = (float) (row[tap] / sum);
+	}
+
+	const int capacity = (int) std::ceil(maxBlockSize_ * newRatio) + newNumTaps + 4;
+	AudioBuffer<float> newHistory(numChannels_, capacity);
+
+	const ScopedLock sl(lock_);
+	ratio_ = newRatio;
+	numTaps_ = newNumTaps;
+	numPhases_ = newNumPhases;
+	table_.swapWith(newTable);
+	std::swap(history_, newHistory);
+	resetHistory();
+}
+
+
+/*
+ * Seeks the input to the matching input position and starts the filter from silence, if a
+ *   position has been posted (call with the lock held, at the start of a block)
+ */
+void PolyphaseResampler::applyPendingPosition() {
+	const int64 position = pendingPosition_.exchange(-1);
+
+	if (position < 0)
+		return;
+
+	input_->setNextReadPosition((int64) std::llround((double) position * ratio_));
+	resetHistory();
+}
+
+
+/*
+ * Empties the history, leaving the zeros the first output sample's left-hand taps need (call
+ *   with the lock held)
+ */
+void PolyphaseResampler::resetHistory() {
+	const int lead = jmax(0, numTaps_ / 2 - 1);
+	history_.clear();
+	numBuffered_ = lead;
+	readPosition_ = lead;
+}
+
+
+/*
+ * Pulls the input samples this chunk needs into the history, filters them into the output
+ *   and drops the samples no longer needed. Returns the ticks spent filtering.
+ */
+int64 PolyphaseResampler::processChunk(AudioBuffer<float> &output, int startSample, int numSamples) {
+	const int halfTaps = numTaps_ / 2;
+	const int needed = (int) std::floor(readPosition_ + (numSamples - 1) * ratio_) + halfTaps + 1;
+
+	if (needed > numBuffered_) {
+		const int numToPull = jmin(needed, history_.getNumSamples()) - numBuffered_;
+		input_->getNextAudioBlock(AudioSourceChannelInfo(&history_, numBuffered_, numToPull));
+		numBuffered_ += numToPull;
+	}
+
+	const int64 startTicks = Time::getHighResolutionTicks();
+
+	for (int channel = 0; channel < output.getNumChannels(); channel++) {
+		const float *history = history_.getReadPointer(channel % history_.getNumChannels());
+		float *dest = output.getWritePointer(channel, startSample);
+
+		for (int sample = 0; sample < numSamples; sample++) {
+			const double position = readPosition_ + sample * ratio_;
+			const int index = (int) position;
+			const double phase = (position - index) * numPhases_;
+			const int row = (int) phase;
+			const float fraction = (float) (phase - row);
+
+			const float *coefficients = table_.get() + row * numTaps_;
+			const float *samples = history + index - (halfTaps - 1);
+			const float a = dotProduct(coefficients, samples, numTaps_);
+			const float b = dotProduct(coefficients + numTaps_, samples, numTaps_);
+			dest[sample] = a + fraction * (b - a);
+		}
+	}
+
+	const int64 endTicks = Time::getHighResolutionTicks();
+
+	// Keep only what the next output sample's left-hand taps still need
+	readPosition_ += numSamples * ratio_;
+	const int numToDiscard = jmin(numBuffered_, (int) readPosition_ - (halfTaps - 1));
+
+	if (numToDiscard > 0) {
+		for (int channel = 0; channel < history_.getNumChannels(); channel++) {
+			float *data = history_.getWritePointer(channel);
+			std::memmove(data, data + numToDiscard, sizeof(float) * (size_t) (numBuffered_ - numToDiscard));
+		}
+
+		numBuffered_ -= numToDiscard;
+		readPosition_ -= numToDiscard;
+	}
+
+	return endTicks - startTicks;
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+  polyphase_resampler.h -- interface for the player's sample rate converter
+	- Converts the file's rate to the device's with a choice of kernels, from
+	  linear interpolation up to a 64-tap windowed sinc
+	- Every kernel is stored as a polyphase table, so each output sample is a
+	  pair of short dot products written for the compiler to vectorize
+	- When downsampling, the sinc kernels are widened to keep out aliasing
+	- Passes audio straight through when the rates match, and measures how
+	  long the filtering takes otherwise
+	- A new read position is only posted by setNextReadPosition(); the next
+	  block applies it, so seeking never waits on the filter's lock
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    A PositionableAudioSource that resamples another one. Positions & lengths
+    are in output samples, so it can sit directly under an AudioTransportSource
+    that doesn't do any rate correction of its own.
+*/
+class PolyphaseResampler : public PositionableAudioSource
+{
+public:
+	enum Quality {
+		Linear = 0,
+		Cubic,
+		Sinc16,
+		Sinc64,
+		NumQualities
+	};
+
+	PolyphaseResampler();
+	~PolyphaseResampler();
+
+	static String getQualityName(Quality quality);
+
+	// Message thread. setInput() should only be called while nothing is pulling audio.
+	void setInput(PositionableAudioSource *source, double inputSampleRate, int numChannels);
+	void setQuality(Quality newQuality);
+	Quality getQuality() const;
+
+	// Conversion figures: the rates, whether filtering is bypassed, and the time spent
+	//   filtering (smoothed, per block and as a % of the block's duration)
+	double getInputSampleRate() const;
+	double getOutputSampleRate() const;
+	bool isBypassed() const;
+	double getMicrosPerBlock() const;
+	double getLoadPercent() const;
+
+	// Redefinitions of AudioSource methods
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+	void releaseResources() override;
+	void getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) override;
+
+	// Redefinitions of PositionableAudioSource methods
+	void setNextReadPosition(int64 newPosition) override;
+	int64 getNextReadPosition() const override;
+	int64 getTotalLength() const override;
+	bool isLooping() const override;
+	void setLooping(bool shouldLoop) override;
+
+private:
+	// Private helper functions
+	void configure();
+	void resetHistory();
+	void applyPendingPosition();
+	int64 processChunk(AudioBuffer<float> &output, int startSample, int numSamples);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	PositionableAudioSource *input_;
+	double inputRate_;
+	double outputRate_;
+	double ratio_;				// input samples per output sample
+	int numChannels_;
+	int maxBlockSize_;
+	Quality quality_;
+
+	// Filter state (rebuilt by configure(), swapped in under the lock)
+	CriticalSection lock_;
+	HeapBlock<float> table_;	// (numPhases_ + 1) rows of numTaps_ coefficients
+	int numTaps_;
+	int numPhases_;
+	AudioBuffer<float> history_;
+	int numBuffered_;
+	double readPosition_;		// fractional index of the next output sample in history_
+
+	// Position posted by setNextReadPosition() for the next block to seek to (-1 for none)
+	std::atomic<int64> pendingPosition_;
+
+	// Published cost of the filtering
+	std::atomic<float> microsPerBlock_;
+	std::atomic<float> loadPercent_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler)
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+  preloaded_reader.cpp -- implementation of the player's decode-to-RAM reader
+
+  ==============================================================================
+*/
+
+#include "preloaded_reader.h"
+#include "callback_worker_pool.h"
+
+//==============================================================================
+/*
+    One decode worker. Worker n of N decodes chunks n, n + N, n + 2N... with its
+    own reader, so together the workers move through the file from the start.
+*/
+class PreloadedReader::DecodeJob : public ThreadPoolJob
+{
+public:
+	DecodeJob(PreloadedReader &owner, int firstChunk, int chunkStride)
+		: ThreadPoolJob("Preload decode"), owner_(owner), firstChunk_(firstChunk), chunkStride_(chunkStride)
+	{
+	}
+
+	JobStatus runJob() override {
+		std::unique_ptr<AudioFormatReader> reader(owner_.formatManager_.createReaderFor(owner_.file_));
+
+		// Without a reader of its own this worker's chunks keep coming from the streaming reader
+		if (reader == nullptr)
+			return jobHasFinished;
+
+		// The reader's raw 32-bit output, which the store narrows to its own width
+		const int numChannels = owner_.samples_.getNumChannels();
+		HeapBlock<int> chunk((size_t) numChannels * (size_t) owner_.samplesPerChunk_);
+		HeapBlock<int *> channels((size_t) numChannels);
+
+		for (int channel = 0; channel < numChannels; channel++)
+			channels[channel] = chunk + (size_t) channel * (size_t) owner_.samplesPerChunk_;
+
+		for (int index = firstChunk_; index < owner_.numChunks_; index += chunkStride_) {
+			if (shouldExit())
+				return jobHasFinished;
+
+			const int64 start = (int64) index * owner_.samplesPerChunk_;
+			const int num = (int) jmin((int64) owner_.samplesPerChunk_, owner_.lengthInSamples - start);
+
+			reader->read(channels, numChannels, start, num, true);
+
+			for (int channel = 0; channel < numChannels; channel++)
+				owner_.samples_.write(channel, start, channels[channel], num);
+
+			owner_.chunkReady_[index].store(true, std::memory_order_release);
+			owner_.numChunksDone_++;
+		}
+
+		return jobHasFinished;
+	}
+
+private:
+	PreloadedReader &owner_;
+	const int firstChunk_;
+	const int chunkStride_;
+};
+
+
+//==============================================================================
+
+// Constructor
+PreloadedReader::PreloadedReader(AudioFormatManager &formatManager, const File &file,
+                                 AudioFormatReader *streamingReader, int samplesPerChunk)
+	: AudioFormatReader(nullptr, streamingReader->getFormatName()),
+	  formatManager_(formatManager),
+	  file_(file),
+	  samplesPerChunk_(jmax(4096, samplesPerChunk)),
+	  numChunks_(0),
+	  numChunksDone_(0),
+	  source_(streamingReader),
+	  decodePool_(CallbackWorkerPool::getNumBackgroundWorkers())
+{
+	// Decoded data is float, whatever the file's format is
+	sampleRate = source_->sampleRate;
+	bitsPerSample = 32;
+	lengthInSamples = source_->lengthInSamples;
+	numChannels = source_->numChannels;
+	usesFloatingPointData = true;
+	metadataValues = source_->metadataValues;
+
+	numChunks_ = (int) ((lengthInSamples + samplesPerChunk_ - 1) / samplesPerChunk_);
+	samples_.allocate(CompactSampleStore::chooseFormat(*source_), (int) numChannels, lengthInSamples);
+
+	chunkReady_.reset(new std::atomic<bool>[(size_t) jmax(1, numChunks_)]);
+	for (int i = 0; i < numChunks_; i++)
+		chunkReady_[i].store(false);
+
+	const int numJobs = jmin(decodePool_.getNumThreads(), jmax(1, numChunks_));
+	for (int i = 0; i < numJobs; i++)
+		decodePool_.addJob(new DecodeJob(*this, i, numJobs), true);
+}
+
+
+// Destructor
+PreloadedReader::~PreloadedReader()
+{
+	decodePool_.removeAllJobs(true, 10000);
+}
+
+
+/*
+ * Memory needed to decode the whole file at its own sample width
+ */
+size_t PreloadedReader::getBytesNeeded(const AudioFormatReader &reader) {
+	return (size_t) CompactSampleStore::getBytesPerSample(CompactSampleStore::chooseFormat(reader))
+		* (size_t) jmax(1, (int) reader.numChannels) * (size_t) jmax((int64) 1, reader.lengthInSamples);
+}
+
+
+double PreloadedReader::getProgress() const {
+	return numChunks_ > 0 ? numChunksDone_.load() / (double) numChunks_ : 1.0;
+}
+
+
+bool PreloadedReader::isFullyDecoded() const {
+	return numChunksDone_.load() >= numChunks_;
+}
+
+
+size_t PreloadedReader::getNumBytesUsed() const {
+	return samples_.getNumBytes();
+}
+
+
+CompactSampleStore::Format PreloadedReader::getStoreFormat() const {
+	return samples_.getFormat();
+}
+
+
+/*
+ * Copies decoded chunks out of memory; any chunk that isn't decoded yet is read from the
+ *   streaming reader instead
+ */
+bool PreloadedReader::readSamples(int **destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                  int64 startSampleInFile, int numSamples) {
+	clearSamplesBeyondAvailableLength(destSamples, numDestChannels, startOffsetInDestBuffer,
+	                                  startSampleInFile, numSamples, lengthInSamples);
+
+	if (numSamples <= 0)
+		return true;
+
+	float *dest[64] = {};
+	numDestChannels = jmin(numDestChannels, (int) numElementsInArray(dest));
+
+	for (int channel = 0; channel < numDestChannels; channel++)
+		if (destSamples[channel] != nullptr)
+			dest[channel] = reinterpret_cast<float *>(destSamples[channel]) + startOffsetInDestBuffer;
+
+	while (numSamples > 0) {
+		const int64 chunkIndex = startSampleInFile / samplesPerChunk_;
+		const int numThisChunk = (int) jmin((int64) numSamples, (chunkIndex + 1) * samplesPerChunk_ - startSampleInFile);
+
+		if (chunkReady_[(size_t) chunkIndex].load(std::memory_order_acquire)) {
+			for (int channel = 0; channel < numDestChannels; channel++)
+				if (dest[channel] != nullptr && channel < samples_.getNumChannels())
+					samples_.read(channel, startSampleInFile, dest[channel], numThisChunk);
+		}
+		else {
+			readFromSource(dest, numDestChannels, startSampleInFile, numThisChunk);
+		}
+
+		for (int channel = 0; channel < numDestChannels; channel++)
+			if (dest[channel] != nullptr)
+				dest[channel] += numThisChunk;
+
+		startSampleInFile += numThisChunk;
+		numSamples -= numThisChunk;
+	}
+
+	return true;
+}
+
+
+/*
+ * Copies a decoded range without decoding, allocating or waiting. Returns false if any
+ *   part of it isn't decoded yet.
+ */
+bool PreloadedReader::tryReadCached(float *const *destChannels, int numDestChannels,
+                                    int64 startSampleInFile, int numSamples) {
+	if (startSampleInFile < 0 || !isRangeDecoded(startSampleInFile, numSamples))
+		return false;
+
+	const int numValid = (int) jlimit((int64) 0, (int64) numSamples, lengthInSamples - startSampleInFile);
+
+	for (int channel = 0; channel < numDestChannels; channel++) {
+		// read() gives channels beyond the file's its last channel
+		if (numValid > 0)
+			samples_.read(channel, startSampleInFile, destChannels[channel], numValid);
+		if (numValid < numSamples)
+			FloatVectorOperations::clear(destChannels[channel] + numValid, numSamples - numValid);
+	}
+
+	return true;
+}
+
+
+/*
+ * True if every chunk overlapping the range (within the file) has been decoded
+ */
+bool PreloadedReader::isRangeDecoded(int64 startSampleInFile, int numSamples) const {
+	const int64 end = jmin(lengthInSamples, startSampleInFile + numSamples);
+
+	for (int64 chunk = startSampleInFile / samplesPerChunk_; chunk * samplesPerChunk_ < end; chunk++)
+		if (!chunkReady_[(size_t) chunk].load(std::memory_order_acquire))
+			return false;
+
+	return true;
+}
+
+
+/*
+ * Reads a range that hasn't been decoded yet from the streaming reader
+ */
+void PreloadedReader::readFromSource(float *const *destChannels, int numDestChannels, int64 startSampleInFile,
+                                     int numSamples) {
+	const ScopedLock sl(sourceLock_);
+
+	sourceScratch_.setSize(samples_.getNumChannels(), numSamples, false, false, true);
+	source_->read(&sourceScratch_, 0, numSamples, startSampleInFile, true, true);
+
+	for (int channel = 0; channel < numDestChannels; channel++)
+		if (destChannels[channel] != nullptr && channel < sourceScratch_.getNumChannels())
+			FloatVectorOperations::copy(destChannels[channel], sourceScratch_.getReadPointer(channel), numSamples);
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+  preloaded_reader.h -- interface for the player's decode-to-RAM reader
+	- An AudioFormatReader that decodes a whole file into memory, meant for
+	  compressed formats (FLAC, Ogg Vorbis) that are otherwise decoded while
+	  they play
+	- Integer files are held at their own width (16 or 24-bit) and converted
+	  to float as they're read
+	- The file is split into chunks that are decoded in parallel, one worker
+	  per core with its own reader, earliest chunks first
+	- Playback can start at once: ranges that aren't decoded yet are read from
+	  the original reader, and once the decode finishes playing costs no
+	  decoding at all
+	- Decoded ranges can also be read without blocking, for scrubbing
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "compact_sample_store.h"
+#include "scrub_processor.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Reader over a file being decoded into memory. Takes ownership of the
+    streaming reader it's given, which is used until each chunk is ready.
+*/
+class PreloadedReader : public AudioFormatReader,
+                        public ScrubProcessor::Source
+{
+public:
+	PreloadedReader(AudioFormatManager &formatManager, const File &file, AudioFormatReader *streamingReader,
+	                int samplesPerChunk = 65536);
+	~PreloadedReader();
+
+	// Memory needed to hold a file decoded
+	static size_t getBytesNeeded(const AudioFormatReader &reader);
+
+	// Decode progress, from 0 to 1, and the memory & sample format holding the decoded audio
+	double getProgress() const;
+	bool isFullyDecoded() const;
+	size_t getNumBytesUsed() const;
+	CompactSampleStore::Format getStoreFormat() const;
+
+	// Redefinition of AudioFormatReader method
+	bool readSamples(int **destSamples, int numDestChannels, int startOffsetInDestBuffer,
+	                 int64 startSampleInFile, int numSamples) override;
+
+	// Redefinition of ScrubProcessor::Source method (succeeds only if the whole range is decoded)
+	bool tryReadCached(float *const *destChannels, int numDestChannels, int64 startSampleInFile,
+	                   int numSamples) override;
+
+private:
+	class DecodeJob;
+
+	// Private helper functions
+	bool isRangeDecoded(int64 startSampleInFile, int numSamples) const;
+	void readFromSource(float *const *destChannels, int numDestChannels, int64 startSampleInFile, int numSamples);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	AudioFormatManager &formatManager_;
+	File file_;
+	const int samplesPerChunk_;
+	int numChunks_;
+
+	// The decoded file, and a flag per chunk set (after its samples are written) by the
+	//   worker that decodes it
+	CompactSampleStore samples_;
+	std::unique_ptr<std::atomic<bool>[]> chunkReady_;
+	std::atomic<int> numChunksDone_;
+
+	// Reader for ranges that aren't decoded yet
+	CriticalSection sourceLock_;
+	std::unique_ptr<AudioFormatReader> source_;
+	AudioBuffer<float> sourceScratch_;
+
+	ThreadPool decodePool_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreloadedReader)
+};
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+  read_ahead_source.cpp -- implementation of the player's read-ahead audio source
+
+  ==============================================================================
+*/
+
+#include "read_ahead_source.h"
+
+//==============================================================================
+
+// Constructor
+ReadAheadSource::ReadAheadSource(PositionableAudioSource *source, TimeSliceThread &thread,
+                                 int numSamplesToBuffer, int numChannels)
+	: source_(*source),
+	  buffer_(source, thread, false, numSamplesToBuffer, jmax(1, numChannels)),
+	  pendingPosition_(-1),
+	  numUnderruns_(0),
+	  numBlocksRead_(0)
+{
+}
+
+
+// Destructor
+ReadAheadSource::~ReadAheadSource()
+{
+}
+
+
+/*
+ * Prepares the buffer (this also pre-fills it from the background thread, from any posted
+ *   position)
+ */
+void ReadAheadSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+	const int64 position = pendingPosition_.exchange(-1);
+	if (position >= 0)
+		buffer_.setNextReadPosition(position);
+
+	buffer_.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+
+/*
+ * Releases the buffer's memory
+ */
+void ReadAheadSource::releaseResources() {
+	buffer_.releaseResources();
+}
+
+
+/*
+ * Copies the next block out of the read-ahead buffer, after moving it to any posted
+ *   position. The readiness check uses a zero timeout, so it never waits on the background
+ *   thread - it only records whether the block had been buffered in time.
+ */
+void ReadAheadSource::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+	const int64 position = pendingPosition_.exchange(-1);
+	if (position >= 0)
+		buffer_.setNextReadPosition(position);
+
+	if (!buffer_.waitForNextAudioBlockReady(bufferToFill, 0))
+		numUnderruns_++;
+
+	numBlocksRead_++;
+	buffer_.getNextAudioBlock(bufferToFill);
+}
+
+
+/*
+ * Posts the position for the next block to hand to the buffer (any thread)
+ */
+void ReadAheadSource::setNextReadPosition(int64 newPosition) {
+	pendingPosition_.store(jmax((int64) 0, newPosition));
+}
+
+
+int64 ReadAheadSource::getNextReadPosition() const {
+	const int64 pending = pendingPosition_.load();
+	return pending >= 0 ? pending : buffer_.getNextReadPosition();
+}
+
+
+int64 ReadAheadSource::getTotalLength() const {
+	return buffer_.getTotalLength();
+}
+
+
+bool ReadAheadSource::isLooping() const {
+	return buffer_.isLooping();
+}
+
+
+/*
+ * Looping is a property of the wrapped source; the buffer just follows it
+ */
+void ReadAheadSource::setLooping(bool shouldLoop) {
+	source_.setLooping(shouldLoop);
+}
+
+
+/*
+ * Number of blocks that were requested before the background thread had buffered them
+ */
+int ReadAheadSource::getNumUnderruns() const {
+	return numUnderruns_.load();
+}
+
+
+/*
+ * Total number of blocks handed to the audio thread
+ */
+int64 ReadAheadSource::getNumBlocksRead() const {
+	return numBlocksRead_.load();
+}
+
+
+void ReadAheadSource::resetCounters() {
+	numUnderruns_ = 0;
+	numBlocksRead_ = 0;
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+  read_ahead_source.h -- interface for the player's read-ahead audio source
+	- Wraps a BufferingAudioSource so that file reads happen on a background
+	  TimeSliceThread instead of the audio callback
+	- Counts buffer underruns (blocks requested before the data was ready)
+	- Seeks are posted and handed to the buffer by the next block, so the
+	  caller never waits on the buffer's position lock
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    A PositionableAudioSource that reads ahead of the playback position on a
+    shared background thread, and keeps track of how often the audio thread
+    asked for samples that hadn't been buffered yet.
+*/
+class ReadAheadSource : public PositionableAudioSource
+{
+public:
+	// The source is not owned; it must outlive this object
+	ReadAheadSource(PositionableAudioSource *source, TimeSliceThread &thread,
+	                int numSamplesToBuffer, int numChannels);
+	~ReadAheadSource();
+
+	// Redefinitions of AudioSource methods
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+	void releaseResources() override;
+	void getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) override;
+
+	// Redefinitions of PositionableAudioSource methods
+	void setNextReadPosition(int64 newPosition) override;
+	int64 getNextReadPosition() const override;
+	int64 getTotalLength() const override;
+	bool isLooping() const override;
+	void setLooping(bool shouldLoop) override;
+
+	// Underrun counters (safe to call from any thread)
+	int getNumUnderruns() const;
+	int64 getNumBlocksRead() const;
+	void resetCounters();
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	PositionableAudioSource &source_;
+	BufferingAudioSource buffer_;
+
+	// Position posted by setNextReadPosition() for the next block (-1 for none)
+	std::atomic<int64> pendingPosition_;
+
+	std::atomic<int> numUnderruns_;
+	std::atomic<int64> numBlocksRead_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReadAheadSource)
+};
@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+  scrub_processor.cpp -- implementation of live scrubbing
+
+  ==============================================================================
+*/
+
+#include "scrub_processor.h"
+
+//==============================================================================
+
+// Constructor
+ScrubProcessor::ScrubProcessor()
+	: active_(false),
+	  scrubCount_(0),
+	  targetPosition_(0),
+	  reader_(nullptr),
+	  grainLength_(0),
+	  hopLength_(0),
+	  sourceRatio_(1.0),
+	  sourceLength_(0),
+	  samplesUntilNextGrain_(0),
+	  nextGrain_(0),
+	  lastGrainPosition_(-1),
+	  currentScrub_(-1)
+{
+}
+
+
+/*
+ * Sizes the grains for the device's sample rate (and the file audio they're converted from,
+ *   if the file's rate differs) and builds the window. A periodic Hann window overlapped by
+ *   half sums to one, so a steady drag plays at a constant level.
+ */
+void ScrubProcessor::prepare(double sampleRate, double sourceSampleRate, int numChannels, double grainSeconds) {
+	hopLength_ = jmax(16, roundToInt(sampleRate * grainSeconds * 0.5));
+	grainLength_ = hopLength_ * 2;
+
+	sourceRatio_ = (sampleRate > 0.0 && sourceSampleRate > 0.0) ? sourceSampleRate / sampleRate : 1.0;
+	if (sourceRatio_ == 1.0) {
+		sourceLength_ = grainLength_;
+		sourceSamples_.setSize(0, 0);
+	}
+	else {
+		// One extra sample for the interpolation past the last output sample
+		sourceLength_ = (int) std::ceil((grainLength_ - 1) * sourceRatio_) + 2;
+		sourceSamples_.setSize(jmax(1, numChannels), sourceLength_);
+	}
+
+	window_.allocate((size_t) grainLength_, false);
+	for (int i = 0; i < grainLength_; i++)
+		window_[i] = 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * (float) i / (float) grainLength_);
+
+	for (auto &grain : grains_) {
+		grain.samples.setSize(jmax(1, numChannels), grainLength_);
+		grain.playing = false;
+	}
+
+	currentScrub_ = -1;
+}
+
+
+/*
+ * Sets the cache grains are read from (nullptr turns scrubbing into silence)
+ */
+void ScrubProcessor::setReader(Source *reader) {
+	reader_ = reader;
+	lastGrainPosition_ = -1;
+}
+
+
+/*
+ * Starts or ends a scrub (each new scrub is counted, so the audio thread can tell it apart
+ *   from the last one)
+ */
+void ScrubProcessor::setActive(bool shouldBeActive) {
+	if (shouldBeActive)
+		scrubCount_.fetch_add(1);
+
+	active_.store(shouldBeActive);
+}
+
+
+bool ScrubProcessor::isActive() const {
+	return active_.load();
+}
+
+
+/*
+ * Posts the position the next grain should be taken from
+ */
+void ScrubProcessor::setPosition(int64 sampleInFile) {
+	targetPosition_.store(jmax((int64) 0, sampleInFile), std::memory_order_relaxed);
+}
+
+
+/*
+ * Overlap-adds the playing grains into the region, starting a new grain every hop
+ */
+void ScrubProcessor::process(AudioBuffer<float> &buffer, int startSample, int numSamples) {
+	buffer.clear(startSample, numSamples);
+
+	if (grainLength_ == 0)
+		return;
+
+	// A new scrub starts with a grain straight away, not halfway through a stale one
+	const int scrub = scrubCount_.load();
+
+	if (scrub != currentScrub_) {
+		for (auto &grain : grains_)
+			grain.playing = false;
+
+		samplesUntilNextGrain_ = 0;
+		lastGrainPosition_ = -1;
+		currentScrub_ = scrub;
+	}
+
+	for (int offset = 0; offset < numSamples;) {
+		if (samplesUntilNextGrain_ == 0) {
+			startGrain(grains_[nextGrain_]);
+			nextGrain_ = 1 - nextGrain_;
+			samplesUntilNextGrain_ = hopLength_;
+		}
+
+		const int num = jmin(numSamples - offset, samplesUntilNextGrain_);
+
+		for (auto &grain : grains_) {
+			if (!grain.playing)
+				continue;
+
+			const int numFromGrain = jmin(num, grainLength_ - grain.position);
+
+			for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+				buffer.addFrom(channel, startSample + offset, grain.samples,
+					channel % grain.samples.getNumChannels(), grain.position, numFromGrain);
+
+			grain.position += numFromGrain;
+			grain.playing = grain.position < grainLength_;
+		}
+
+		offset += num;
+		samplesUntilNextGrain_ -= num;
+	}
+}
+
+
+/*
+ * Loads and windows a grain centred on the posted position (in file samples), converting
+ *   it to the device's rate first if they differ. Nothing new is started while the thumb is
+ *   still (so holding it still falls silent, like a tape), or if the audio there isn't
+ *   cached yet - the next hop tries again.
+ */
+void ScrubProcessor::startGrain(Grain &grain) {
+	const int64 target = targetPosition_.load(std::memory_order_relaxed);
+	grain.playing = false;
+
+	if (reader_ == nullptr || target == lastGrainPosition_)
+		return;
+
+	const int64 start = jmax((int64) 0, target - (int64) std::llround(hopLength_ * sourceRatio_));
+	const int numChannels = grain.samples.getNumChannels();
+	const bool convert = sourceRatio_ != 1.0;
+	AudioBuffer<float> &destination = convert ? sourceSamples_ : grain.samples;
+
+	if (!reader_->tryReadCached(destination.getArrayOfWritePointers(), numChannels, start, sourceLength_))
+		return;
+
+	if (convert)
+		convertRate(grain);
+
+	for (int channel = 0; channel < numChannels; channel++)
+		FloatVectorOperations::multiply(grain.samples.getWritePointer(channel), window_, grainLength_);
+
+	grain.position = 0;
+	grain.playing = true;
+	lastGrainPosition_ = target;
+}
+
+
+/*
+ * Fills a grain from the file audio read for it, interpolating linearly between the file's
+ *   samples
+ */
+void ScrubProcessor::convertRate(Grain &grain) {
+	for (int channel = 0; channel < grain.samples.getNumChannels(); channel++) {
+		const float *source = sourceSamples_.getReadPointer(channel);
+		float *dest = grain.samples.getWritePointer(channel);
+
+		for (int i = 0; i < grainLength_; i++) {
+			const double sourcePosition = i * sourceRatio_;
+			const int index = (int) sourcePosition;
+			const float fraction = (float) (sourcePosition - index);
+			dest[i] = source[index] + fraction * (source[index + 1] - source[index]);
+		}
+	}
+}
+
+
+//==============================================================================
+
+// Constructor
+ScrubProcessor::MappedSource::MappedSource(MemoryMappedAudioFormatReader &reader)
+	: reader_(reader)
+{
+}
+
+
+/*
+ * Copies the range out of the mapping (past the end of the file is silence). The reader
+ *   writes integer formats as 32-bit integers, which are converted in place, the way
+ *   AudioFormatReader::read() does it.
+ */
+bool ScrubProcessor::MappedSource::tryReadCached(float *const *destChannels, int numDestChannels,
+                                                 int64 startSampleInFile, int numSamples) {
+	const int numFileChannels = jmin(numDestChannels, (int) reader_.numChannels);
+
+	if (startSampleInFile < 0 || numFileChannels <= 0)
+		return false;
+
+	if (!reader_.readSamples((int **) destChannels, numFileChannels, 0, startSampleInFile, numSamples))
+		return false;
+
+	for (int channel = 0; channel < numDestChannels; channel++) {
+		if (channel >= numFileChannels)
+			FloatVectorOperations::copy(destChannels[channel], destChannels[numFileChannels - 1], numSamples);
+		else if (!reader_.usesFloatingPointData)
+			FloatVectorOperations::convertFixedToFloat(destChannels[channel], (const int *) destChannels[channel],
+			                                           1.0f / (float) 0x7fffffff, numSamples);
+	}
+
+	return true;
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+  scrub_processor.h -- interface for live scrubbing while the progress bar is dragged
+	- The message thread posts the thumb position through an atomic; the audio
+	  thread picks it up at the start of every grain
+	- Output is a stream of short Hann-windowed grains, overlapped by half, so
+	  a new position is heard within one hop (about 20 ms) plus one block
+	- Grains are only read from audio already in memory (the block cache,
+	  which is prefetched around the thumb, a preloaded file, or a mapped
+	  one), so scrubbing never waits on a decoder or a lock (a grain that
+	  isn't in memory yet is simply silent)
+	- Grains are read at the file's sample rate and converted to the device's
+	  (by linear interpolation, which is plenty for a scrub preview) before
+	  they're windowed
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Granular scrub voice. setReader() & prepare() are called with the audio
+    thread stopped or excluded; the scrub position may be set at any time.
+*/
+class ScrubProcessor
+{
+public:
+	// Audio held in memory that can be read without blocking
+	class Source
+	{
+	public:
+		virtual ~Source() {}
+
+		// Audio thread: copies a range into float buffers if it's all in memory, without
+		//   decoding, allocating or waiting. Destination channels beyond the file's take its
+		//   last channel.
+		virtual bool tryReadCached(float *const *destChannels, int numDestChannels,
+		                           int64 startSampleInFile, int numSamples) = 0;
+	};
+
+	// A memory-mapped file, read straight out of the mapping (the reader isn't owned, and
+	//   must have its whole file mapped)
+	class MappedSource : public Source
+	{
+	public:
+		explicit MappedSource(MemoryMappedAudioFormatReader &reader);
+
+		bool tryReadCached(float *const *destChannels, int numDestChannels,
+		                   int64 startSampleInFile, int numSamples) override;
+
+	private:
+		MemoryMappedAudioFormatReader &reader_;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MappedSource)
+	};
+
+	ScrubProcessor();
+
+	// Allocates the grain buffers (message thread). Grains are played at sampleRate and read
+	//   from the file at sourceSampleRate.
+	void prepare(double sampleRate, double sourceSampleRate, int numChannels = 2, double grainSeconds = 0.04);
+	void setReader(Source *reader);
+
+	// Scrub control (message thread)
+	void setActive(bool shouldBeActive);
+	bool isActive() const;
+	void setPosition(int64 sampleInFile);
+
+	// Audio thread: replaces the region with scrub grains
+	void process(AudioBuffer<float> &buffer, int startSample, int numSamples);
+
+private:
+	struct Grain
+	{
+		AudioBuffer<float> samples;
+		int position = 0;
+		bool playing = false;
+	};
+
+	// Private helper functions
+	void startGrain(Grain &grain);
+	void convertRate(Grain &grain);
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	// Written by the message thread, read by the audio thread
+	std::atomic<bool> active_;
+	std::atomic<int> scrubCount_;
+	std::atomic<int64> targetPosition_;
+
+	// Audio thread state
+	Source *reader_;
+	Grain grains_[2];
+	HeapBlock<float> window_;
+	int grainLength_;
+	int hopLength_;
+
+	// File samples per output sample, and the file's audio for a grain before it's converted
+	//   (only used when the rates differ)
+	double sourceRatio_;
+	AudioBuffer<float> sourceSamples_;
+	int sourceLength_;
+	int samplesUntilNextGrain_;
+	int nextGrain_;
+	int64 lastGrainPosition_;
+	int currentScrub_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScrubProcessor)
+};
@@ -9,13 +9,93 @@
 */
 
 #include "sound_file_player.h"
-#include <random>
+#include "internal_effects.h"
 #include <iostream>
 
+namespace {
+	// Display refresh rates: while playing, scrubbing or a meter is falling back, while the window is
+	//   hidden or minimised, and while a preload is still decoding. With none of those the
+	//   timer is stopped and the display only changes in response to events.
+	const int playingRefreshHz = 60;
+	const int hiddenRefreshHz = 4;
+	const int preloadRefreshHz = 4;
+
+	// Width of the spectrum analyzer, to the right of the controls (Main.cpp's MIN_WIDTH
+	//   leaves the controls at least 380 wide)
+	const int analyzerWidth = 320;
+
+	// Item IDs of the channel map menu: each channel's submenu has an item for "off" and one
+	//   per output, numbered from the channel's base
+	const int defaultChannelMapId = 1;
+	const int channelMenuStride = 1000;
+
+	// Item IDs of the layers menu: each layer's submenu numbers its volume & noise levels and
+	//   its removal from the layer's base
+	const int addLayersId = 1;
+	const int clearLayersId = 2;
+	const int layerMenuStride = 100;
+	const int layerVolumeOffset = 10;
+	const int layerNoiseOffset = 20;
+	const int removeLayerOffset = 99;
+	const float layerVolumes[] = { 1.0f, 0.75f, 0.5f, 0.25f, 0.0f };
+	const float layerNoiseLevels[] = { 0.0f, 0.1f, 0.25f, 0.5f };
+
+	// Item IDs of the effects menu: each branch's submenu numbers its items from the branch's
+	//   base (the built-in effects first, then adding a plugin, removing each effect, and
+	//   removing the branch)
+	const int addBranchId = 1;
+	const int clearEffectsId = 2;
+	const int effectMenuStride = 100;
+	const int addPluginOffset = 50;
+	const int removeEffectOffset = 60;
+	const int removeBranchOffset = 99;
+
+	// Name of the nth output the device has open (which is the nth set bit of its active outputs)
+	String getActiveOutputName(AudioIODevice &device, int index) {
+		const auto active = device.getActiveOutputChannels();
+		int bit = active.findNextSetBit(0);
+
+		for (int i = 0; i < index && bit >= 0; i++)
+			bit = active.findNextSetBit(bit + 1);
+
+		const auto names = device.getOutputChannelNames();
+		return isPositiveAndBelow(bit, names.size()) && names[bit].isNotEmpty() ? names[bit] : "Output " + String(index + 1);
+	}
+
+	// Loudness normalization targets in LUFS, indexed by item ID - 1 of the normalization box
+	//   (the first item turns it off). The gain is limited so the true peak stays at or below
+	//   the ceiling, and never boosts by more than the maximum.
+	const double normalizationTargets[] = { 0.0, -23.0, -16.0, -14.0 };
+	const double truePeakCeilingDb = -1.0;
+	const double maxNormalizationBoostDb = 20.0;
+
+	// Gain in dB that brings a measured file to the target (none without a target, or for a
+	//   silent file)
+	double getNormalizationDb(const LoudnessAnalyzer::Result &result, double target) {
+		if (target >= 0.0 || !result.hasAudio)
+			return 0.0;
+
+		return jmin(target - result.integratedLufs, truePeakCeilingDb - result.truePeakDb, maxNormalizationBoostDb);
+	}
+}
+
 //==============================================================================
 
 // Constructor
 SoundFilePlayerComponent::SoundFilePlayerComponent()
+	: thumbnailCache_(5, ThumbnailDiskCache::getDefaultDirectory()),
+	  progressBar_(formatManager_, thumbnailCache_),
+	  fileInfoIsFinal_(true),
+	  loudnessAnalyzer_(formatManager_, LoudnessAnalyzer::getDefaultCacheFile(), *this),
+	  readAheadThread_("Audio read-ahead"),
+	  decodedCache_(DecodedFileCache::getDefaultDirectory(), (int64) 4 * 1024 * 1024 * 1024),
+	  fileLoader_(formatManager_, readAheadThread_, *this),
+	  playlistQueue_(engine_, formatManager_, readAheadThread_),
+	  statsPanel_(engine_, deviceManager),
+	  spectrumDisplay_(engine_.getAnalyzer()),
+	  loadProgressBar_(fileLoader_.getProgress()),
+	  lastRefreshSeconds_(0.0),
+	  lastStateVersion_(0)
 {
 	// State is initially "Stopped"
 	state_ = Stopped;
@@ -25,6 +105,30 @@ SoundFilePlayerComponent::SoundFilePlayerComponent()
 	openButton_.setButtonText("Open...");
 	openButton_.onClick = [this] { openButtonClicked(); };
 
+	// Add queue button, which adds files to play (gaplessly) after the current one
+	addAndMakeVisible(&queueButton_);
+	queueButton_.setButtonText("Queue...");
+	queueButton_.onClick = [this] { queueButtonClicked(); };
+	queueButton_.setEnabled(false);
+
+	// Add layers button, which adds files to play alongside the main one
+	addAndMakeVisible(&layersButton_);
+	layersButton_.setButtonText("Layers...");
+	layersButton_.onClick = [this] { layersButtonClicked(); };
+
+	// Add the channels button, which routes the file's channels to the device's outputs
+	addAndMakeVisible(&channelsButton_);
+	channelsButton_.setButtonText("Channels...");
+	channelsButton_.setTooltip("Choose the output each of the file's channels plays on");
+	channelsButton_.onClick = [this] { channelsButtonClicked(); };
+	channelsButton_.setEnabled(false);
+
+	// Add the effects button, which edits the effect chains
+	addAndMakeVisible(&effectsButton_);
+	effectsButton_.setButtonText("Effects...");
+	effectsButton_.setTooltip("Add built-in effects or plugins, in one or more parallel chains");
+	effectsButton_.onClick = [this] { effectsButtonClicked(); };
+
 	// Add play button, set color, text, & onClick function, and then disable
 	addAndMakeVisible(&playButton_);
 	playButton_.setButtonText("Play");
@@ -44,20 +148,70 @@ SoundFilePlayerComponent::SoundFilePlayerComponent()
 	loopToggleButton_.setButtonText("Loop");
 	loopToggleButton_.onClick = [this] { loopButtonChanged(); };
 
-	// Initialize volume slider
+	// Add the loop points button, which sets the region looped from the playback position
+	addAndMakeVisible(&loopPointsButton_);
+	loopPointsButton_.setButtonText("Loop points...");
+	loopPointsButton_.onClick = [this] { loopPointsButtonClicked(); };
+	loopPointsButton_.setEnabled(false);
+
+	// Add the memory-map toggle button (applies to the next file opened)
+	addAndMakeVisible(&memoryMapToggleButton_);
+	memoryMapToggleButton_.setButtonText("Memory-map files");
+	memoryMapToggleButton_.setTooltip("Read uncompressed files through a memory-mapped view instead of streaming them");
+
+	// Add the preload toggle button (applies to the next file opened)
+	addAndMakeVisible(&preloadToggleButton_);
+	preloadToggleButton_.setButtonText("Preload to RAM");
+	preloadToggleButton_.setTooltip("Decode compressed files into memory in the background, so playing them needs no decoding");
+
+	// Add the native-rate toggle button, which reopens the device at the file's rate (if the
+	//   device supports it) so nothing needs resampling
+	addAndMakeVisible(&nativeRateToggleButton_);
+	nativeRateToggleButton_.setButtonText("Play at file's rate");
+	nativeRateToggleButton_.setTooltip("Switch the audio device to each file's sample rate, so it isn't resampled");
+	nativeRateToggleButton_.onClick = [this] { matchDeviceToFile(); };
+
+	// Add the resampling quality box
+	for (int quality = 0; quality < PolyphaseResampler::NumQualities; quality++)
+		resamplerQualityBox_.addItem(PolyphaseResampler::getQualityName((PolyphaseResampler::Quality) quality), quality + 1);
+	resamplerQualityBox_.setSelectedId(PolyphaseResampler::Sinc16 + 1, dontSendNotification);
+	resamplerQualityBox_.setTooltip("Resampling quality, when the file's sample rate differs from the device's");
+	resamplerQualityBox_.onChange = [this] {
+		engine_.setResamplerQuality((PolyphaseResampler::Quality) (resamplerQualityBox_.getSelectedId() - 1));
+	};
+	addAndMakeVisible(&resamplerQualityBox_);
+
+	// Add the loudness normalization box & the label showing the file's loudness
+	normalizationBox_.addItem("No normalization", 1);
+	normalizationBox_.addItem("-23 LUFS (EBU R128)", 2);
+	normalizationBox_.addItem("-16 LUFS", 3);
+	normalizationBox_.addItem("-14 LUFS (streaming)", 4);
+	normalizationBox_.setSelectedId(1, dontSendNotification);
+	normalizationBox_.setTooltip("Set the playback gain from each file's measured loudness");
+	normalizationBox_.onChange = [this] { updateNormalization(); };
+	addAndMakeVisible(&normalizationBox_);
+	addAndMakeVisible(&loudnessLabel_);
+
+	// Initialize volume slider, which publishes its value to the audio thread
 	volumeSlider_.setRange(0.0, 1.0);
 	volumeSlider_.setValue(1.0, dontSendNotification);
 	volumeSlider_.setTextBoxStyle(Slider::TextBoxLeft, true, 50, 20);
+	volumeSlider_.onValueChange = [this] {
+		engine_.getParameters().setValue(PlayerParameters::Volume, (float) volumeSlider_.getValue());
+	};
 	addAndMakeVisible(&volumeSlider_);
 
 	// Initialize volume label
 	volumeLabel_.setText("Volume:", dontSendNotification);
 	addAndMakeVisible(&volumeLabel_);
 
-	// Initialize noise bar
+	// Initialize noise bar, which publishes its value to the audio thread
 	noiseSlider_.setRange(0.0, 1.0);
 	noiseSlider_.setValue(0.0, dontSendNotification);
 	noiseSlider_.setTextBoxStyle(Slider::TextBoxLeft, true, 50, 20);
+	noiseSlider_.onValueChange = [this] {
+		engine_.getParameters().setValue(PlayerParameters::Noise, (float) noiseSlider_.getValue());
+	};
 	addAndMakeVisible(&noiseSlider_);
 
 	// Initialize noise label
@@ -69,6 +223,14 @@ SoundFilePlayerComponent::SoundFilePlayerComponent()
 	progressBar_.setValue(currentProgress_, dontSendNotification);
 	progressBar_.setTextBoxStyle(Slider::TextBoxLeft, true, 50, 20);
 	progressBar_.setRange(0.0, 1.0);
+	progressBar_.onDragStart = [this] {
+		engine_.beginScrub();
+		updateRefreshRate();
+	};
+	progressBar_.onValueChange = [this] {
+		if (progressBar_.getThumbBeingDragged() >= 0)
+			engine_.setScrubPosition(progressBar_.getValue() * engine_.getLength());
+	};
 	progressBar_.onDragEnd = [this] { sliderDragEnded(); };
 	addAndMakeVisible(&progressBar_);
 	progressBar_.setEnabled(false);
@@ -77,13 +239,59 @@ SoundFilePlayerComponent::SoundFilePlayerComponent()
 	progressLabel_.setText("Progress:", dontSendNotification);
 	addAndMakeVisible(&progressLabel_);
 
-    setSize (400, 300);
+	// Add the output level meter
+	addAndMakeVisible(&levelMeter_);
+
+	// Add the spectrum analyzer, which runs for as long as the window is open
+	addAndMakeVisible(&spectrumDisplay_);
+	engine_.getAnalyzer().setActive(true);
+
+	// Initialize file info label
+	fileInfoLabel_.setText("No file loaded", dontSendNotification);
+	fileInfoLabel_.setJustificationType(Justification::centred);
+	addAndMakeVisible(&fileInfoLabel_);
+
+	// Initialize the queue label
+	queueInfoLabel_.setText("Queue empty", dontSendNotification);
+	queueInfoLabel_.setJustificationType(Justification::centred);
+	addAndMakeVisible(&queueInfoLabel_);
+
+	// Add the file loading progress bar (only shown while a file is loading)
+	loadProgressBar_.setTextToDisplay("Loading...");
+	addChildComponent(&loadProgressBar_);
+
+	// Add the audio thread statistics panel
+	addAndMakeVisible(&statsPanel_);
+
+    setSize (720, 650);
 
 	formatManager_.registerBasicFormats();
-	transportSource_.addChangeListener(this);
+
+	// Default load options: 2 s of read-ahead, a 256 MB decoded-block cache for seeking, and
+	//   up to 4 GB of decoded copies on disk for reopening compressed or remote files
+	loadOptions_.readAheadSeconds = 2.0;
+	loadOptions_.blockCacheBytes = 256 * 1024 * 1024;
+	loadOptions_.decodedCache = &decodedCache_;
+
+	playlistQueue_.addChangeListener(this);
+
+	// With a loudness target, a queued file waits until it's been measured, so it never starts
+	//   at the wrong level (one whose measurement failed goes ahead at unity gain)
+	playlistQueue_.setReadyCheck([this] (const File &file) {
+		LoudnessAnalyzer::Result result;
+		const double target = normalizationTargets[jlimit(1, 4, normalizationBox_.getSelectedId()) - 1];
+		return target >= 0.0 || loudnessAnalyzer_.findCachedResult(file, result) || !loudnessAnalyzer_.isAnalysing(file);
+	});
+	engine_.getMixer().addChangeListener(this);
+
+	// All file reads happen on this thread, ahead of the playback position
+	readAheadThread_.startThread(8);
+
+	// Files with many channels (and effect racks with several branches) share the callback's
+	//   work with a few spare cores
+	engine_.getWorkers().setNumWorkers(jmin((int) CallbackWorkerPool::maxWorkers, SystemStats::getNumCpus() - 1));
 
 	setAudioChannels(2, 2);
-	startTimer(20);
 }
 
 
@@ -91,6 +299,11 @@ SoundFilePlayerComponent::SoundFilePlayerComponent()
 SoundFilePlayerComponent::~SoundFilePlayerComponent()
 {
 	shutdownAudio();
+	fileLoader_.cancel();
+	playlistQueue_.clear();
+	engine_.getMixer().removeChangeListener(this);
+	engine_.setFile(nullptr);
+	readAheadThread_.stopThread(1000);
 }
 
 
@@ -107,12 +320,13 @@ void SoundFilePlayerComponent::changeState(TransportState newState) {
 				playButton_.setButtonText("Play");
 				stopButton_.setButtonText("Stop");
 				stopButton_.setEnabled(false);
-				transportSource_.setPosition(0.0);
+				engine_.stop();		// the layers keep going if the main file just ran out
+				engine_.setPosition(0.0);
 				progressBar_.setValue(0.0);
 				break;
 
 			case Starting:
-				transportSource_.start();
+				engine_.start();
 				break;
 
 			case Playing:
@@ -122,7 +336,7 @@ void SoundFilePlayerComponent::changeState(TransportState newState) {
 				break;
 
 			case Pausing:
-				transportSource_.stop();
+				engine_.stop();
 				break;
 
 			case Paused:
@@ -131,9 +345,12 @@ void SoundFilePlayerComponent::changeState(TransportState newState) {
 				break;
 
 			case Stopping:
-				transportSource_.stop();
+				engine_.stop();
 				break;
 		}
+
+		// Keep polling until the audio thread has applied whatever was just sent
+		updateRefreshRate();
 	}
 }
 
@@ -142,27 +359,91 @@ void SoundFilePlayerComponent::changeState(TransportState newState) {
  * Updates the player's loop setting based on the provided bool flag
  */
 void SoundFilePlayerComponent::updateLoopState(const bool &loopFlag) {
-	if (readerSource_.get() != nullptr) {
-		readerSource_->setLooping(loopFlag);
-	}
+	engine_.setLooping(loopFlag);
 }
 
 
 /*
- * Function that gets called whenever the state of the transport changes
+ * Callback run when the Loop points button is clicked: starts or ends the loop region at the
+ *   playback position, or goes back to looping the whole file
+ */
+void SoundFilePlayerComponent::loopPointsButtonClicked() {
+	PopupMenu menu;
+	menu.addItem(1, "Start loop here");
+	menu.addItem(2, "End loop here");
+	menu.addItem(3, "Loop whole file", engine_.getLoopStart() > 0.0 || engine_.getLoopEnd() > 0.0);
+
+	menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&loopPointsButton_), [this](int result) {
+		const double position = engine_.getPosition();
+		double start = engine_.getLoopStart();
+		double end = engine_.getLoopEnd();
+
+		// A new point on the wrong side of the other one moves that one to the file's edge
+		if (result == 1) {
+			start = position;
+			if (end > 0.0 && end <= start)
+				end = 0.0;
+		}
+		else if (result == 2) {
+			end = position;
+			if (start >= end)
+				start = 0.0;
+		}
+		else if (result == 3) {
+			start = end = 0.0;
+		}
+		else {
+			return;
+		}
+
+		engine_.setLoopPoints(start, end);
+		updateLoopDisplay();
+	});
+}
+
+
+/*
+ * Highlights the loop region on the waveform (nothing when it's the whole file)
+ */
+void SoundFilePlayerComponent::updateLoopDisplay() {
+	const double length = engine_.getLength();
+	const double start = engine_.getLoopStart();
+	const double end = engine_.getLoopEnd() > 0.0 ? engine_.getLoopEnd() : length;
+
+	if (length <= 0.0 || (start <= 0.0 && engine_.getLoopEnd() <= 0.0))
+		progressBar_.setLoopRegion({});
+	else
+		progressBar_.setLoopRegion(Range<double>(start / length, end / length));
+}
+
+
+/*
+ * Function that gets called whenever the playlist queue or the layers change
  */
 void SoundFilePlayerComponent::changeListenerCallback(ChangeBroadcaster *source) {
 
-	// If the source of the transport changes, either start or stop the player
-	//   (depending on whether the transport is started or stopped)
-	if (source == &transportSource_) {
-		if (transportSource_.isPlaying())
-			changeState(Playing);
-		else if ((state_ == Stopping) || (state_ == Playing))
-			changeState(Stopped);
-		else
-			changeState(Paused);
+	// Playback has moved on to the next file in the queue, or the queue has changed
+	if (source == &playlistQueue_) {
+		auto *currentFile = engine_.getFile();
+
+		if (currentFile != nullptr && !fileLoader_.isLoading() && progressBar_.getFile() != currentFile->file) {
+			loopToggleButton_.setToggleState(false, dontSendNotification);
+			showCurrentWaveform();
+			updateLoopDisplay();
+			updateFileInfo();
+		}
+
+		// Also gives a newly queued file its gain, ready for playback to reach it
+		updateNormalization();
+		updateQueueInfo();
+	}
+
+	// A layer has been added or removed
+	else if (source == &engine_.getMixer()) {
+		updateFileInfo();
 	}
+
+	updateRefreshRate();
 }
 
 
@@ -170,54 +451,161 @@ void SoundFilePlayerComponent::changeListenerCallback(ChangeBroadcaster *source)
  * Processes the next audio block from the audio source file
  */
 void SoundFilePlayerComponent::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+	engine_.getNextAudioBlock(bufferToFill);
+}
 
-	if (readerSource_.get() == nullptr) {
-		bufferToFill.clearActiveBufferRegion();
-		return;
+
+/*
+ * Refreshes the display from the state the audio thread has published, then works out
+ *   whether it's still needed
+ */
+void SoundFilePlayerComponent::timerCallback() {
+	const double now = Time::getMillisecondCounterHiRes() * 0.001;
+	float peaks[PlaybackEngine::numMeterChannels];
+
+	engine_.takePeakLevels(peaks);
+	levelMeter_.pushLevels(peaks, jmin(now - lastRefreshSeconds_, 1.0));
+	lastRefreshSeconds_ = now;
+	spectrumDisplay_.refresh();
+
+	// Catch up with the engine once it has applied everything sent to it (checked in this
+	//   order, since the version moves on before the commands count as applied)
+	if (!engine_.hasPendingCommands() && engine_.getStateVersion() != lastStateVersion_) {
+		lastStateVersion_ = engine_.getStateVersion();
+		engineStateChanged();
 	}
 
-	transportSource_.getNextAudioBlock(bufferToFill);
+	if (engine_.isPlaying())
+		updateProgress();
 
-	float volume = volumeSlider_.getValue();
-	float noiseLevel = noiseSlider_.getValue();
+	// Keep the decode progress of a preloading file up to date
+	if (!fileInfoIsFinal_)
+		updateFileInfo();
 
-	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); channel++) {
-		auto *buffer = bufferToFill.buffer->getWritePointer(channel);
+	updateRefreshRate();
+}
 
-		for (int sample = 0; sample < bufferToFill.buffer->getNumSamples(); sample++) {
-			buffer[sample] *= volume;
-			buffer[sample] *= (1 - noiseLevel + noiseLevel * random.nextFloat());
-		}
-	}
+
+/*
+ * The audio thread has applied transport commands or the transport has started/stopped:
+ *   moves on to the state it has published
+ */
+void SoundFilePlayerComponent::engineStateChanged() {
+	if (engine_.isPlaying())
+		changeState(Playing);
+	else if ((state_ == Stopping) || (state_ == Playing))
+		changeState(Stopped);
+	else if ((state_ == Starting) || (state_ == Pausing))
+		changeState(Paused);
+
+	// Show where playback stopped, since the display won't be refreshed while it's stopped
+	updateProgress();
+	updateNormalization();
 }
 
 
 /*
- * Function called periodically as a timer callback
+ * Moves the progress bar to the published playback position, unless it's being dragged or
+ *   about to move
  */
-void SoundFilePlayerComponent::timerCallback() {
+void SoundFilePlayerComponent::updateProgress() {
+	const double length = engine_.getLength();
+
+	// A queued seek (or stop, which returns to the start) would be undone by the position
+	//   published before it
+	if (length <= 0.0 || engine_.isScrubbing() || engine_.hasPendingCommands())
+		return;
 
-	if (transportSource_.isPlaying()) {
-		RelativeTime pos(transportSource_.getCurrentPosition());
+	currentProgress_ = engine_.getPosition() / length;
+	if (progressBar_.getThumbBeingDragged() < 0)
+		progressBar_.setValue(currentProgress_, dontSendNotification);
+}
 
-		// int minutes = ((int) pos.inMinutes() % 60);
-		// int seconds = ((int) pos.inSeconds() % 60);
-		// int millis  = ((int) pos.inMilliseconds() % 60);
 
-		// Get new progress value, only update its value if we aren't currently dragging it
-		currentProgress_ = transportSource_.getCurrentPosition() / transportSource_.getLengthInSeconds();
-		if (progressBar_.getThumbBeingDragged() < 0) {
-			progressBar_.setValue(currentProgress_);
-		}
+/*
+ * Picks the display refresh rate for what's going on: the display rate while playing or
+ *   scrubbing (or while the meter is still falling, or a transport command is on its way),
+ *   a trickle while the window can't be seen or a preload is decoding, and nothing at all
+ *   otherwise
+ */
+void SoundFilePlayerComponent::updateRefreshRate() {
+	int refreshHz = 0;
+
+	// The transport's state is only ever polled, so keep going until the display has caught up
+	//   with the commands sent to it
+	const bool awaitingEngine = engine_.hasPendingCommands() || engine_.getStateVersion() != lastStateVersion_;
+
+	if (engine_.isPlaying() || engine_.isScrubbing() || awaitingEngine || levelMeter_.isActive())
+		refreshHz = isShowing() ? playingRefreshHz : hiddenRefreshHz;
+	else if (!fileInfoIsFinal_)
+		refreshHz = preloadRefreshHz;
+
+	// The statistics are only polled while the transport runs and the window is showing
+	statsPanel_.setRefreshing((engine_.isPlaying() || engine_.isScrubbing()) && isShowing());
+
+	if (refreshHz == 0) {
+		stopTimer();
+	}
+	else if (!isTimerRunning() || getTimerInterval() != 1000 / refreshHz) {
+		// Restart the meter's clock if the timer was stopped
+		if (!isTimerRunning())
+			lastRefreshSeconds_ = Time::getMillisecondCounterHiRes() * 0.001;
+
+		startTimerHz(refreshHz);
 	}
 }
 
 
 /*
- * Updates the progress of the audio source when the slider is done being dragged
+ * Updates the progress of the audio source when the slider is done being dragged, then
+ *   hands playback back from the scrub grains to the transport
  */
 void SoundFilePlayerComponent::sliderDragEnded() {
-	transportSource_.setPosition(progressBar_.getValue() * transportSource_.getLengthInSeconds());
+	engine_.setPosition(progressBar_.getValue() * engine_.getLength());
+	engine_.endScrub();
+	updateRefreshRate();
+}
+
+
+/*
+ * Sets the length of the read-ahead buffer, in seconds, used for the next file opened
+ */
+void SoundFilePlayerComponent::setReadAheadSeconds(double seconds) {
+	loadOptions_.readAheadSeconds = jmax(0.1, seconds);
+}
+
+
+/*
+ * Returns the length of the read-ahead buffer, in seconds
+ */
+double SoundFilePlayerComponent::getReadAheadSeconds() const {
+	return loadOptions_.readAheadSeconds;
+}
+
+
+/*
+ * Returns the number of audio blocks the read-ahead buffer couldn't deliver in time
+ *   for the current file
+ */
+int SoundFilePlayerComponent::getBufferUnderruns() const {
+	return engine_.getBufferUnderruns();
+}
+
+
+/*
+ * Sets the memory budget of the decoded-block cache used for the next file opened (0 turns
+ *   the cache off)
+ */
+void SoundFilePlayerComponent::setBlockCacheBytes(size_t numBytes) {
+	loadOptions_.blockCacheBytes = numBytes;
+}
+
+
+/*
+ * Sets the size limit of the on-disk decoded copies (0 stops new copies being kept)
+ */
+void SoundFilePlayerComponent::setDecodedCacheBytes(int64 numBytes) {
+	decodedCache_.setMaxBytes(numBytes);
 }
 
 
@@ -226,7 +614,7 @@ void SoundFilePlayerComponent::sliderDragEnded() {
  *   sampling rate
  */
 void SoundFilePlayerComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
-	transportSource_.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	engine_.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 
@@ -234,46 +622,541 @@ void SoundFilePlayerComponent::prepareToPlay(int samplesPerBlockExpected, double
  * Releases the transport source's resources
  */
 void SoundFilePlayerComponent::releaseResources() {
-	transportSource_.releaseResources();
+	engine_.releaseResources();
 }
 
 
 /*
- * Callback run when the player's Open button is clicked
+ * Callback run when the player's Open button is clicked. The chooser runs asynchronously,
+ *   and the chosen file is loaded on a background thread; clicking the button while a file
+ *   is loading cancels the load instead.
  */
 void SoundFilePlayerComponent::openButtonClicked() {
 
+	if (fileLoader_.isLoading()) {
+		fileLoader_.cancel();
+		setLoadingUI(false);
+		showCurrentWaveform();
+		return;
+	}
+
 	// Pause player if not already paused or stopped (loading a new file while the
 	//   transport source is still playing leads to weird behavior)
-	if (transportSource_.isPlaying()) {
+	if (engine_.isPlaying()) {
 		changeState(Pausing);
 	}
 
-	// Create a file chooser that only allows wav files
-	FileChooser chooser("Select a .wav file to play...", {}, "*.wav");
+	// Create a file chooser that allows every format the format manager can read
+	fileChooser_.reset(new FileChooser("Select an audio file to play...", {}, formatManager_.getWildcardForAllFormats()));
+
+	// Open up the file chooser, and start loading the file if the user picks one
+	fileChooser_->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+		[this](const FileChooser &chooser) {
+			auto file = chooser.getResult();
+
+			if (file.existsAsFile()) {
+				// The waveform overview is built (or fetched from the cache) and the loudness
+				//   measured while the file loads
+				progressBar_.setFile(file);
+				loudnessAnalyzer_.analyse(file);
+				setLoadingUI(true);
+				loadOptions_.useMemoryMapping = memoryMapToggleButton_.getToggleState();
+				loadOptions_.preloadToMemory = preloadToggleButton_.getToggleState();
+				fileLoader_.load(file, loadOptions_, engine_.getExpectedBlockSize());
+			}
+		});
+}
 
-	// Open up the file chooser, check if the user inputs a file
-	if (chooser.browseForFileToOpen()) {
 
-		// Grab the file, try to create a reader for it
-		auto file = chooser.getResult();
-		auto *reader = formatManager_.createReaderFor(file);
+/*
+ * Callback run when the Queue button is clicked: the chosen files are played after the
+ *   current one, without a gap
+ */
+void SoundFilePlayerComponent::queueButtonClicked() {
+	fileChooser_.reset(new FileChooser("Select audio files to play next...", {}, formatManager_.getWildcardForAllFormats()));
 
-		if (reader != nullptr) {
-			// Store a reader source object for the reader in a temporary unique_ptr
-			std::unique_ptr<AudioFormatReaderSource> newSource(new AudioFormatReaderSource(reader, true));
-			transportSource_.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
+	fileChooser_->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles
+	                          | FileBrowserComponent::canSelectMultipleItems,
+		[this](const FileChooser &chooser) {
+			auto files = chooser.getResults();
 
-			// Update UI now that we have a file loaded
-			playButton_.setEnabled(true);
-			loopToggleButton_.setToggleState(false, dontSendNotification);
-			progressBar_.setValue(0.0);
-			progressBar_.setEnabled(true);
+			for (auto &file : files)
+				loudnessAnalyzer_.analyse(file);
+
+			if (!files.isEmpty())
+				playlistQueue_.addFiles(files, loadOptions_);
+		});
+}
+
+
+/*
+ * Callback run when the Layers button is clicked: offers to add files to play alongside the
+ *   main one (opened in parallel in the background), or to remove them all
+ */
+void SoundFilePlayerComponent::layersButtonClicked() {
+	auto &mixer = engine_.getMixer();
+
+	PopupMenu menu;
+	menu.addItem(addLayersId, "Add layers...", mixer.getNumVoices() < MixerEngine::maxVoices);
+	menu.addItem(clearLayersId, "Remove all layers", mixer.getNumVoices() > 0);
+
+	// Each layer's own volume & noise
+	if (mixer.getNumVoices() > 0)
+		menu.addSeparator();
+
+	for (int index = 0; index < mixer.getNumVoices(); index++) {
+		auto &parameters = mixer.getVoice(index)->getParameters();
+		const int baseId = (index + 1) * layerMenuStride;
+
+		PopupMenu layerMenu;
+		layerMenu.addSectionHeader("Volume");
+		for (int level = 0; level < numElementsInArray(layerVolumes); level++)
+			layerMenu.addItem(baseId + layerVolumeOffset + level,
+				layerVolumes[level] > 0.0f ? String(roundToInt(layerVolumes[level] * 100.0f)) + "%" : String("Mute"),
+				true, parameters.getValue(PlayerParameters::Volume) == layerVolumes[level]);
+
+		layerMenu.addSectionHeader("Noise");
+		for (int level = 0; level < numElementsInArray(layerNoiseLevels); level++)
+			layerMenu.addItem(baseId + layerNoiseOffset + level,
+				layerNoiseLevels[level] > 0.0f ? String(roundToInt(layerNoiseLevels[level] * 100.0f)) + "%" : String("Off"),
+				true, parameters.getValue(PlayerParameters::Noise) == layerNoiseLevels[level]);
+
+		layerMenu.addSeparator();
+		layerMenu.addItem(baseId + removeLayerOffset, "Remove layer");
+
+		menu.addSubMenu(String(index + 1) + ": " + mixer.getVoice(index)->getFile().file.getFileName(), layerMenu);
+	}
+
+	menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&layersButton_), [this](int result) {
+		auto &mixer = engine_.getMixer();
+
+		if (result == clearLayersId) {
+			mixer.clearVoices();
+			return;
+		}
 
-			// Now that the bookkeeping is done, set the readerSource to our new object
-			readerSource_.reset(newSource.release());
+		// A layer's item (ignored if the layer has gone since the menu was shown)
+		if (result >= layerMenuStride) {
+			auto *voice = mixer.getVoice(result / layerMenuStride - 1);
+			const int offset = result % layerMenuStride;
+
+			if (voice == nullptr)
+				return;
+
+			if (offset == removeLayerOffset)
+				mixer.removeVoice(result / layerMenuStride - 1);
+			else if (offset >= layerNoiseOffset)
+				voice->getParameters().setValue(PlayerParameters::Noise, layerNoiseLevels[offset - layerNoiseOffset]);
+			else
+				voice->getParameters().setValue(PlayerParameters::Volume, layerVolumes[offset - layerVolumeOffset]);
+			return;
 		}
+
+		if (result != addLayersId)
+			return;
+
+		fileChooser_.reset(new FileChooser("Select audio files to layer...", {}, formatManager_.getWildcardForAllFormats()));
+
+		fileChooser_->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles
+		                          | FileBrowserComponent::canSelectMultipleItems,
+			[this](const FileChooser &chooser) {
+				for (auto &file : chooser.getResults())
+					engine_.getMixer().addFile(file, loadOptions_);
+			});
+	});
+}
+
+
+/*
+ * Callback run when the Channels button is clicked: a submenu per channel of the file picks
+ *   the output it plays on (or none), named after the file's layout and the device's outputs
+ */
+void SoundFilePlayerComponent::channelsButtonClicked() {
+	auto *currentFile = engine_.getFile();
+	auto *device = deviceManager.getCurrentAudioDevice();
+
+	if (currentFile == nullptr || device == nullptr)
+		return;
+
+	const int numOutputs = device->getActiveOutputChannels().countNumberOfSetBits();
+	const auto map = engine_.getChannelMap(numOutputs);
+	const auto &layout = currentFile->channelLayout;
+
+	PopupMenu menu;
+	menu.addItem(defaultChannelMapId, "Default (channel n on output n)", true, engine_.hasDefaultChannelMap());
+	menu.addSeparator();
+
+	for (int channel = 0; channel < map.size(); channel++) {
+		const int baseId = (channel + 1) * channelMenuStride;
+		String name = "Channel " + String(channel + 1);
+
+		if (layout.size() == currentFile->numChannels && !layout.isDiscreteLayout())
+			name << " (" << AudioChannelSet::getAbbreviatedChannelTypeName(layout.getTypeOfChannel(channel)) << ")";
+
+		PopupMenu outputMenu;
+		outputMenu.addItem(baseId, "Off", true, map[channel] < 0);
+		for (int output = 0; output < jmin(numOutputs, channelMenuStride - 1); output++)
+			outputMenu.addItem(baseId + output + 1, getActiveOutputName(*device, output), true, map[channel] == output);
+
+		menu.addSubMenu(name, outputMenu);
+	}
+
+	menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&channelsButton_), [this, map](int result) {
+		if (result == defaultChannelMapId) {
+			engine_.setChannelMap({});
+		}
+		else if (result >= channelMenuStride) {
+			Array<int> newMap(map);
+			newMap.set(result / channelMenuStride - 1, result % channelMenuStride - 1);
+			engine_.setChannelMap(newMap);
+		}
+	});
+}
+
+
+/*
+ * Callback run when the Effects button is clicked: adds or removes branches, and a submenu
+ *   per branch adds a built-in effect or a plugin to the end of its chain, or removes one
+ */
+void SoundFilePlayerComponent::effectsButtonClicked() {
+	auto &effects = engine_.getEffects();
+
+	PopupMenu menu;
+	menu.addItem(addBranchId, "Add branch", effects.getNumBranches() < EffectRack::maxBranches);
+	menu.addItem(clearEffectsId, "Remove all effects", effects.getNumBranches() > 0);
+
+	if (effects.getNumBranches() > 0)
+		menu.addSeparator();
+
+	for (int branch = 0; branch < effects.getNumBranches(); branch++) {
+		const int baseId = (branch + 1) * effectMenuStride;
+		const bool hasRoom = effects.getNumEffects(branch) < EffectRack::maxEffectsPerBranch;
+		StringArray names;
+
+		PopupMenu branchMenu;
+		for (int type = 0; type < InternalEffect::NumTypes; type++)
+			branchMenu.addItem(baseId + type, "Add " + InternalEffect::getTypeName((InternalEffect::Type) type), hasRoom);
+		branchMenu.addItem(baseId + addPluginOffset, "Add plugin...", hasRoom);
+		branchMenu.addSeparator();
+
+		for (int index = 0; index < effects.getNumEffects(branch); index++) {
+			names.add(effects.getEffectName(branch, index));
+			branchMenu.addItem(baseId + removeEffectOffset + index, "Remove " + names[index]);
+		}
+		branchMenu.addItem(baseId + removeBranchOffset, "Remove branch");
+
+		menu.addSubMenu("Branch " + String(branch + 1) + ": " + (names.isEmpty() ? String("dry") : names.joinIntoString(" -> ")),
+			branchMenu);
 	}
+
+	menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&effectsButton_), [this](int result) {
+		auto &rack = engine_.getEffects();
+		const int branch = result / effectMenuStride - 1;
+		const int item = result % effectMenuStride;
+		String error;
+
+		if (result == addBranchId)
+			rack.addBranch();
+		else if (result == clearEffectsId)
+			rack.clear();
+		else if (branch < 0)
+			return;
+		else if (item < InternalEffect::NumTypes) {
+			if (!rack.addEffect(branch, InternalEffect::create((InternalEffect::Type) item), error))
+				AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Couldn't add the effect", error);
+		}
+		else if (item == addPluginOffset)
+			addPluginToBranch(branch);
+		else if (item == removeBranchOffset)
+			rack.removeBranch(branch);
+		else if (item >= removeEffectOffset)
+			rack.removeEffect(branch, item - removeEffectOffset);
+	});
+}
+
+
+/*
+ * Asks for a plugin file and adds it to the end of a branch (with a choice of plugin if the
+ *   file holds several)
+ */
+void SoundFilePlayerComponent::addPluginToBranch(int branch) {
+	fileChooser_.reset(new FileChooser("Select a plugin...", {}, "*"));
+
+	fileChooser_->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles
+	                          | FileBrowserComponent::canSelectDirectories,
+		[this, branch](const FileChooser &chooser) {
+			const auto file = chooser.getResult();
+			if (file == File())
+				return;
+
+			auto types = std::make_shared<OwnedArray<PluginDescription>>();
+			engine_.getEffects().findPluginTypes(file, *types);
+
+			auto addType = [this, branch, types](int index) {
+				if (!isPositiveAndBelow(index, types->size()))
+					return;
+
+				String error;
+				auto plugin = engine_.getEffects().createPlugin(*types->getUnchecked(index), error);
+
+				if (plugin == nullptr || !engine_.getEffects().addEffect(branch, std::move(plugin), error))
+					AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Couldn't add the plugin", error);
+			};
+
+			if (types->isEmpty()) {
+				AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Couldn't add the plugin",
+					file.getFileName() + " isn't a plugin this player can host");
+			}
+			else if (types->size() == 1) {
+				addType(0);
+			}
+			else {
+				PopupMenu menu;
+				for (int index = 0; index < types->size(); index++)
+					menu.addItem(index + 1, types->getUnchecked(index)->name);
+
+				menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&effectsButton_),
+					[addType](int result) { addType(result - 1); });
+			}
+		});
+}
+
+
+/*
+ * Shows the files queued after the current one
+ */
+void SoundFilePlayerComponent::updateQueueInfo() {
+	auto upcoming = playlistQueue_.getUpcomingFileNames();
+	String info;
+
+	if (upcoming.isEmpty())
+		info = "Queue empty";
+	else if (upcoming.size() == 1)
+		info = "Next: " + upcoming[0];
+	else
+		info = "Next: " + upcoming[0] + " (+" + String(upcoming.size() - 1) + " more)";
+
+	if (playlistQueue_.getNumFilesSkipped() > 0)
+		info << ", " << playlistQueue_.getNumFilesSkipped() << " skipped";
+
+	queueInfoLabel_.setText(info, dontSendNotification);
+}
+
+
+/*
+ * Shows or hides the load progress, and turns the Open button into a Cancel button while
+ *   a file is loading
+ */
+void SoundFilePlayerComponent::setLoadingUI(bool isLoading) {
+	openButton_.setButtonText(isLoading ? "Cancel loading" : "Open...");
+	loadProgressBar_.setVisible(isLoading);
+}
+
+
+/*
+ * Called on the message thread once the loader has built & primed the new file's sources
+ */
+void SoundFilePlayerComponent::fileLoaded(std::unique_ptr<LoadedFile> loadedFile) {
+	setLoadingUI(false);
+
+	// Update UI now that we have a file loaded
+	playButton_.setEnabled(true);
+	queueButton_.setEnabled(true);
+	channelsButton_.setEnabled(true);
+	loopToggleButton_.setToggleState(false, dontSendNotification);
+	progressBar_.setValue(0.0);
+	progressBar_.setEnabled(true);
+
+	// Now that the bookkeeping is done, swap the new file into the engine
+	engine_.setFile(std::move(loadedFile));
+	loopPointsButton_.setEnabled(true);
+	updateLoopDisplay();
+	matchDeviceToFile();
+	updateFileInfo();
+	updateQueueInfo();
+	updateNormalization();
+	updateRefreshRate();
+}
+
+
+/*
+ * Shows the loaded file's format, how much memory is mapped or decoded if it's in memory,
+ *   and the number of layers
+ */
+void SoundFilePlayerComponent::updateFileInfo() {
+	auto *currentFile = engine_.getFile();
+
+	auto &mixer = engine_.getMixer();
+	String info;
+	fileInfoIsFinal_ = true;
+
+	if (currentFile == nullptr) {
+		info = "No file loaded";
+	}
+	else {
+		info = currentFile->file.getFileName()
+			+ " - " + String(currentFile->sampleRate / 1000.0, 1) + " kHz, "
+			+ String(currentFile->numChannels) + " ch";
+
+		// Name the layout if it's more than mono or stereo (and not just numbered channels)
+		const auto &layout = currentFile->channelLayout;
+		if (currentFile->numChannels > 2 && layout.size() == currentFile->numChannels && !layout.isDiscreteLayout())
+			info << " (" << layout.getDescription() << ")";
+
+		if (currentFile->isMemoryMapped)
+			info << (currentFile->isFromDecodedCache ? ", mapped from cache (" : ", mapped (")
+			     << File::descriptionOfSizeInBytes((int64) currentFile->mappedBytes) << ")";
+
+		if (auto *preloaded = currentFile->preloaded) {
+			info << ", in RAM (" << CompactSampleStore::getFormatName(preloaded->getStoreFormat()) << ", "
+			     << File::descriptionOfSizeInBytes((int64) preloaded->getNumBytesUsed());
+			if (!preloaded->isFullyDecoded()) {
+				info << ", " << roundToInt(100.0 * preloaded->getProgress()) << "% decoded";
+				fileInfoIsFinal_ = false;
+			}
+			info << ")";
+		}
+	}
+
+	if (mixer.getNumVoices() > 0 || mixer.getNumLoading() > 0) {
+		info << " + " << mixer.getNumVoices() << " layers";
+		if (mixer.getNumLoading() > 0)
+			info << " (" << mixer.getNumLoading() << " loading)";
+	}
+
+	fileInfoLabel_.setText(info, dontSendNotification);
+}
+
+
+/*
+ * Reopens the audio device with an output for each of the current file's channels (as many
+ *   as the device has, and at least two, so a mono file plays on both speakers), and at the
+ *   file's sample rate if "Play at file's rate" is on and the device supports that rate (so
+ *   the resampler is bypassed)
+ */
+void SoundFilePlayerComponent::matchDeviceToFile() {
+	auto *currentFile = engine_.getFile();
+	auto *device = deviceManager.getCurrentAudioDevice();
+
+	if (currentFile == nullptr || device == nullptr)
+		return;
+
+	AudioDeviceManager::AudioDeviceSetup setup;
+	deviceManager.getAudioDeviceSetup(setup);
+	bool needsChange = false;
+
+	if (nativeRateToggleButton_.getToggleState() && device->getCurrentSampleRate() != currentFile->sampleRate
+	    && device->getAvailableSampleRates().contains(currentFile->sampleRate)) {
+		setup.sampleRate = currentFile->sampleRate;
+		needsChange = true;
+	}
+
+	BigInteger outputs;
+	outputs.setRange(0, jmin(jmax(2, currentFile->numChannels), device->getOutputChannelNames().size()), true);
+
+	if (device->getActiveOutputChannels() != outputs) {
+		setup.outputChannels = outputs;
+		setup.useDefaultOutputChannels = false;
+		needsChange = true;
+	}
+
+	if (!needsChange)
+		return;
+
+	auto error = deviceManager.setAudioDeviceSetup(setup, true);
+	if (error.isNotEmpty())
+		AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Couldn't change the audio device's settings", error);
+}
+
+
+/*
+ * Points the waveform overview back at the file that's actually loaded (after a load was
+ *   cancelled or failed)
+ */
+void SoundFilePlayerComponent::showCurrentWaveform() {
+	if (auto *currentFile = engine_.getFile())
+		progressBar_.setFile(currentFile->file);
+	else
+		progressBar_.clearWaveform();
+}
+
+
+/*
+ * Called on the message thread if the chosen file couldn't be opened
+ */
+void SoundFilePlayerComponent::fileLoadFailed(const File &file) {
+	setLoadingUI(false);
+	showCurrentWaveform();
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Couldn't open file",
+		"\"" + file.getFullPathName() + "\" isn't an audio file this player can read.");
+}
+
+
+/*
+ * Called on the message thread once a file's loudness has been measured (it might be the
+ *   current file, or one that's queued)
+ */
+void SoundFilePlayerComponent::loudnessAnalysisFinished(const File &, bool) {
+	updateNormalization();
+}
+
+
+/*
+ * Sets the normalization gains for the current file & the queued one from their measured
+ *   loudness, and shows the current file's figures. The queued file's gain is switched to by
+ *   the audio thread as playback moves on to it. With a target set, a stopped or paused file
+ *   can't be played until it's been measured, so it never starts at the wrong level.
+ */
+void SoundFilePlayerComponent::updateNormalization() {
+	auto *currentFile = engine_.getFile();
+	const double target = normalizationTargets[jlimit(1, 4, normalizationBox_.getSelectedId()) - 1];
+	LoudnessAnalyzer::Result result;
+	float gain = 1.0f;
+	String info;
+	bool isWaiting = false;
+
+	if (currentFile == nullptr) {
+		info = {};
+	}
+	else if (loudnessAnalyzer_.findCachedResult(currentFile->file, result)) {
+		if (!result.hasAudio) {
+			info = "Silent";
+		}
+		else {
+			info = String(result.integratedLufs, 1) + " LUFS, LRA " + String(result.rangeLu, 1) + " LU, "
+				+ String(result.truePeakDb, 1) + " dBTP";
+
+			if (target < 0.0) {
+				const double gainDb = getNormalizationDb(result, target);
+				gain = Decibels::decibelsToGain((float) gainDb);
+				info << ", gain " << (gainDb >= 0.0 ? "+" : "") << String(gainDb, 1) << " dB";
+			}
+		}
+	}
+	else if (loudnessAnalyzer_.isAnalysing(currentFile->file)) {
+		info = "Measuring loudness...";
+		isWaiting = target < 0.0;
+	}
+	else {
+		info = "Loudness unknown";
+	}
+
+	if (currentFile != nullptr)
+		engine_.setNormalization(*currentFile, gain);
+
+	// The queued file's gain (unity if it couldn't be measured; with a target, the playlist
+	//   queue holds it back until it has been)
+	if (auto *nextFile = engine_.getNextFile()) {
+		LoudnessAnalyzer::Result nextResult;
+		const double gainDb = loudnessAnalyzer_.findCachedResult(nextFile->file, nextResult)
+		                    ? getNormalizationDb(nextResult, target) : 0.0;
+		engine_.setNormalization(*nextFile, Decibels::decibelsToGain((float) gainDb));
+	}
+
+	loudnessLabel_.setText(info, dontSendNotification);
+
+	if (currentFile != nullptr && (state_ == Stopped || state_ == Paused))
+		playButton_.setEnabled(!isWaiting);
 }
 
 
@@ -312,18 +1195,37 @@ void SoundFilePlayerComponent::loopButtonChanged() {
  */
 void SoundFilePlayerComponent::resized()
 {
-	openButton_.setBounds(10, 10, getWidth() - 20, 20);
-	playButton_.setBounds(10, 40, getWidth() - 20, 20);
-	stopButton_.setBounds(10, 70, getWidth() - 20, 20);
-
-	progressLabel_.setBounds(10, 100, 70, 20);
-	volumeLabel_.setBounds(10, 130, 70, 20);
-	noiseLabel_.setBounds(10, 160, 70, 20);
-
-	progressBar_.setBounds(80, 100, getWidth() - 90, 20);
-	volumeSlider_.setBounds(80, 130, getWidth() - 90, 20);
-	noiseSlider_.setBounds(80, 160, getWidth() - 90, 20);
-	loopToggleButton_.setBounds((getWidth() / 2) - 35, 190, 70, 20);
+	const int controlsWidth = getWidth() - analyzerWidth;
+
+	openButton_.setBounds(10, 10, controlsWidth - 290, 20);
+	queueButton_.setBounds(controlsWidth - 270, 10, 80, 20);
+	layersButton_.setBounds(controlsWidth - 180, 10, 80, 20);
+	effectsButton_.setBounds(controlsWidth - 90, 10, 80, 20);
+	playButton_.setBounds(10, 40, controlsWidth - 20, 20);
+	stopButton_.setBounds(10, 70, controlsWidth - 20, 20);
+
+	progressLabel_.setBounds(10, 110, 70, 20);
+	volumeLabel_.setBounds(10, 150, 70, 20);
+	noiseLabel_.setBounds(10, 180, 70, 20);
+
+	progressBar_.setBounds(80, 100, controlsWidth - 90, 40);
+	volumeSlider_.setBounds(80, 150, controlsWidth - 90, 20);
+	noiseSlider_.setBounds(80, 180, controlsWidth - 90, 20);
+	loopToggleButton_.setBounds(10, 210, 70, 20);
+	preloadToggleButton_.setBounds(90, 210, 130, 20);
+	memoryMapToggleButton_.setBounds(controlsWidth - 150, 210, 140, 20);
+	nativeRateToggleButton_.setBounds(10, 240, 170, 20);
+	resamplerQualityBox_.setBounds(controlsWidth - 150, 240, 140, 20);
+	loopPointsButton_.setBounds(10, 270, 120, 20);
+	channelsButton_.setBounds(140, 270, 90, 20);
+	levelMeter_.setBounds(240, 272, controlsWidth - 250, 16);
+	normalizationBox_.setBounds(10, 300, 170, 20);
+	loudnessLabel_.setBounds(190, 300, controlsWidth - 200, 20);
+	loadProgressBar_.setBounds(10, 330, getWidth() - 20, 20);
+	fileInfoLabel_.setBounds(10, 360, getWidth() - 20, 20);
+	queueInfoLabel_.setBounds(10, 380, getWidth() - 20, 20);
+	statsPanel_.setBounds(10, 410, getWidth() - 20, getHeight() - 420);
+	spectrumDisplay_.setBounds(controlsWidth, 10, analyzerWidth - 10, 310);
 }
 
 
@@ -10,6 +10,15 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "file_loader.h"
+#include "level_meter.h"
+#include "loudness_analyzer.h"
+#include "playback_engine.h"
+#include "playlist_queue.h"
+#include "spectrum_display.h"
+#include "stats_panel.h"
+#include "thumbnail_disk_cache.h"
+#include "waveform_slider.h"
 
 //==============================================================================
 /*
@@ -18,7 +27,9 @@
 */
 class SoundFilePlayerComponent : public AudioAppComponent,
 						         public ChangeListener,
-								 public Timer
+								 public Timer,
+								 private FileLoader::Listener,
+								 private LoudnessAnalyzer::Listener
 {
 public:
 	SoundFilePlayerComponent();
@@ -36,6 +47,13 @@ public:
 	// Callback function for progress bar listeners
 	void sliderDragEnded();
 
+	// Read-ahead buffer & cache settings (these apply to the next file opened)
+	void setReadAheadSeconds(double seconds);
+	double getReadAheadSeconds() const;
+	void setBlockCacheBytes(size_t numBytes);
+	void setDecodedCacheBytes(int64 numBytes);
+	int getBufferUnderruns() const;
+
     void resized() override;
 
 private:
@@ -49,21 +67,64 @@ private:
 	// Private helper functions
 	void changeState(TransportState newState);
 	void openButtonClicked();
+	void queueButtonClicked();
+	void layersButtonClicked();
+	void channelsButtonClicked();
+	void effectsButtonClicked();
+	void addPluginToBranch(int branch);
+	void updateQueueInfo();
+	void setLoadingUI(bool isLoading);
+	void updateFileInfo();
+	void matchDeviceToFile();
+	void showCurrentWaveform();
 	void playButtonClicked();
 	void stopButtonClicked();
 	void loopButtonChanged();
 	void updateLoopState(const bool &loopFlag);
+	void loopPointsButtonClicked();
+	void updateLoopDisplay();
+	void engineStateChanged();
+	void updateProgress();
+	void updateRefreshRate();
+	void updateNormalization();
+
+	// Callbacks from the background file loader
+	void fileLoaded(std::unique_ptr<LoadedFile> loadedFile) override;
+	void fileLoadFailed(const File &file) override;
+
+	// Callback from the loudness analyzer
+	void loudnessAnalysisFinished(const File &file, bool succeeded) override;
 
 	// ===== PRIVATE MEMBER VARIABLES =====
 
+	// Format manager & waveform overview cache (declared before the progress bar, whose
+	//   thumbnail uses them, and everything else that reads files)
+	AudioFormatManager formatManager_;
+	ThumbnailDiskCache thumbnailCache_;
+
 	// Interface buttons
 	TextButton openButton_;
+	TextButton queueButton_;
+	TextButton layersButton_;
+	TextButton channelsButton_;
+	TextButton effectsButton_;
 	TextButton playButton_;
 	TextButton stopButton_;
 	ToggleButton loopToggleButton_;
+	TextButton loopPointsButton_;
+	ToggleButton memoryMapToggleButton_;
+	ToggleButton preloadToggleButton_;
+	ToggleButton nativeRateToggleButton_;
+
+	// Resampling quality (used when the file's rate differs from the device's)
+	ComboBox resamplerQualityBox_;
+
+	// Loudness normalization target, and the current file's loudness
+	ComboBox normalizationBox_;
+	Label loudnessLabel_;
 	
-	// Progress bar and progress value
-	Slider progressBar_;
+	// Progress bar (with the file's waveform overview) and progress value
+	WaveformSlider progressBar_;
 	double currentProgress_;
 	Label progressLabel_;
 
@@ -75,12 +136,41 @@ private:
 	Slider noiseSlider_;
 	Label noiseLabel_;
 
-	// Managers, sources, random generator, & transport state
-	Random random;
-	AudioFormatManager formatManager_;
-	std::unique_ptr<AudioFormatReaderSource> readerSource_;
-	AudioTransportSource transportSource_;
+	// Output level of the last few blocks
+	LevelMeter levelMeter_;
+
+	// Details of the loaded file & the files queued after it (the file info is final unless
+	//   it shows the progress of a preload)
+	Label fileInfoLabel_;
+	Label queueInfoLabel_;
+	bool fileInfoIsFinal_;
+
+	// Loudness analysis, processing chain, & transport state (the read-ahead thread must
+	//   outlive the engine, which holds the current file's read-ahead buffer)
+	LoudnessAnalyzer loudnessAnalyzer_;
+	TimeSliceThread readAheadThread_;
+	DecodedFileCache decodedCache_;
+	LoadOptions loadOptions_;
+	PlaybackEngine engine_;
+	FileLoader fileLoader_;
+	PlaylistQueue playlistQueue_;
+
+	// Audio thread statistics & spectrum (both show the engine's figures, so they're
+	//   declared after it)
+	StatsPanel statsPanel_;
+	SpectrumDisplay spectrumDisplay_;
+
+	// File chooser & load progress (the chooser is kept alive while it's open, and the
+	//   progress bar watches the loader's progress value)
+	std::unique_ptr<FileChooser> fileChooser_;
+	ProgressBar loadProgressBar_;
 	TransportState state_;
 
+	// When the display was last refreshed (for the level meter's fall-back)
+	double lastRefreshSeconds_;
+
+	// Version of the engine's published state the display last caught up with
+	uint32 lastStateVersion_;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SoundFilePlayerComponent)
 };
@@ -0,0 +1,291 @@
+/*
+  ==============================================================================
+
+  spectrum_analyzer.cpp -- implementation of the player's background spectrum analyzer
+
+  ==============================================================================
+*/
+
+#include "spectrum_analyzer.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// FIFO length in samples (over a second at 48 kHz, several of the largest FFTs)
+	const int fifoSize = 1 << 16;
+
+	// Time constant of the magnitude averaging, and the floor of the published levels
+	const double averagingSeconds = 0.1;
+	const float minimumDb = -120.0f;
+
+	// How long the thread sleeps once samples have stopped arriving, and how many polls
+	//   that find nothing new it waits for before slowing down
+	const int idleWaitMs = 100;
+	const int numPollsBeforeIdle = 4;
+
+	// Smoothing applied to the published cost figures
+	const float costSmoothing = 0.1f;
+
+	/*
+	 * Writes the average of the buffer's channels to dest
+	 */
+	void mixToMono(const AudioBuffer<float> &buffer, int startSample, float *dest, int numSamples) {
+		if (numSamples <= 0)
+			return;
+
+		const int numChannels = buffer.getNumChannels();
+		FloatVectorOperations::copy(dest, buffer.getReadPointer(0, startSample), numSamples);
+
+		for (int channel = 1; channel < numChannels; channel++)
+			FloatVectorOperations::add(dest, buffer.getReadPointer(channel, startSample), numSamples);
+
+		if (numChannels > 1)
+			FloatVectorOperations::multiply(dest, 1.0f / (float) numChannels, numSamples);
+	}
+}
+
+//==============================================================================
+
+// Constructor
+SpectrumAnalyzer::SpectrumAnalyzer()
+	: Thread("Spectrum analyzer"),
+	  fifo_(fifoSize),
+	  fifoData_((size_t) fifoSize, true),
+	  active_(false),
+	  sampleRate_(44100.0),
+	  numDropped_(0),
+	  fftOrder_(11),
+	  overlap_(4),
+	  currentOrder_(0),
+	  currentOverlap_(0),
+	  microsPerFrame_(0.0f),
+	  loadPercent_(0.0f)
+{
+}
+
+
+// Destructor
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+	setActive(false);
+}
+
+
+void SpectrumAnalyzer::prepare(double sampleRate) {
+	sampleRate_ = sampleRate;
+}
+
+
+/*
+ * Starts or stops the analysis thread. While inactive the audio thread pushes nothing.
+ */
+void SpectrumAnalyzer::setActive(bool shouldBeActive) {
+	active_ = shouldBeActive;
+
+	if (shouldBeActive)
+		startThread(3);
+	else
+		stopThread(1000);
+}
+
+
+bool SpectrumAnalyzer::isActive() const {
+	return active_.load();
+}
+
+
+/*
+ * Copies a mono mix of the block into the FIFO, or drops the whole block if there isn't room
+ *   for it (the analysis thread has fallen behind, or isn't running)
+ */
+void SpectrumAnalyzer::pushSamples(const AudioBuffer<float> &buffer, int startSample, int numSamples) {
+	if (!active_.load(std::memory_order_relaxed) || numSamples <= 0 || buffer.getNumChannels() == 0)
+		return;
+
+	int start1, size1, start2, size2;
+	fifo_.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+	if (size1 + size2 < numSamples) {
+		numDropped_ += numSamples;
+		return;
+	}
+
+	mixToMono(buffer, startSample, fifoData_ + start1, size1);
+	mixToMono(buffer, startSample + size1, fifoData_ + start2, size2);
+	fifo_.finishedWrite(numSamples);
+}
+
+
+void SpectrumAnalyzer::setFftOrder(int order) {
+	fftOrder_ = jlimit((int) minFftOrder, (int) maxFftOrder, order);
+}
+
+
+int SpectrumAnalyzer::getFftOrder() const {
+	return fftOrder_.load();
+}
+
+
+void SpectrumAnalyzer::setOverlap(int overlap) {
+	overlap_ = jlimit(1, (int) maxOverlap, nextPowerOfTwo(overlap));
+}
+
+
+int SpectrumAnalyzer::getOverlap() const {
+	return overlap_.load();
+}
+
+
+/*
+ * Copies the latest frame into the one passed in, unless it's already that frame
+ */
+bool SpectrumAnalyzer::copyLatestFrame(Frame &frame) const {
+	const ScopedLock sl(frameLock_);
+
+	if (frame.number == latest_.number)
+		return false;
+
+	frame = latest_;
+	return true;
+}
+
+
+/*
+ * Time taken to compute each frame (window, FFT, averaging & publishing), smoothed
+ */
+double SpectrumAnalyzer::getMicrosPerFrame() const {
+	return microsPerFrame_.load(std::memory_order_relaxed);
+}
+
+
+/*
+ * Time taken to compute each frame, as a % of the time between frames (i.e. of one core)
+ */
+double SpectrumAnalyzer::getLoadPercent() const {
+	return loadPercent_.load(std::memory_order_relaxed);
+}
+
+
+int SpectrumAnalyzer::getNumDroppedSamples() const {
+	return numDropped_.load();
+}
+
+
+/*
+ * Analysis thread: computes a frame each time a hop's worth of new samples is in the FIFO.
+ *   It polls at about twice the frame rate while samples are arriving, and slows down once
+ *   they stop, so a stopped player costs almost nothing.
+ */
+void SpectrumAnalyzer::run() {
+	// Anything left from before the thread was last stopped is stale
+	fifo_.finishedRead(fifo_.getNumReady());
+
+	int numIdlePolls = 0;
+	int lastReady = 0;
+
+	while (!threadShouldExit()) {
+		const int order = fftOrder_.load();
+		const int overlap = overlap_.load();
+
+		if (order != currentOrder_ || overlap != currentOverlap_)
+			configure(order, overlap);
+
+		const int fftSize = 1 << currentOrder_;
+		const int hopSize = fftSize / currentOverlap_;
+		const int ready = fifo_.getNumReady();
+
+		if (ready < hopSize) {
+			numIdlePolls = ready == lastReady ? numIdlePolls + 1 : 0;
+			lastReady = ready;
+
+			const int pollMs = jlimit(1, idleWaitMs, (int) (500.0 * hopSize / sampleRate_.load()));
+			wait(numIdlePolls > numPollsBeforeIdle ? idleWaitMs : pollMs);
+			continue;
+		}
+
+		// Slide the history along by a hop and append the new samples
+		std::memmove(history_.get(), history_ + hopSize, sizeof(float) * (size_t) (fftSize - hopSize));
+
+		int start1, size1, start2, size2;
+		fifo_.prepareToRead(hopSize, start1, size1, start2, size2);
+		FloatVectorOperations::copy(history_ + fftSize - hopSize, fifoData_ + start1, size1);
+		FloatVectorOperations::copy(history_ + fftSize - hopSize + size1, fifoData_ + start2, size2);
+		fifo_.finishedRead(size1 + size2);
+
+		lastReady = fifo_.getNumReady();
+		numIdlePolls = 0;
+
+		analyseFrame();
+	}
+}
+
+
+/*
+ * Rebuilds the FFT, window & buffers for new settings, starting again from silence
+ */
+void SpectrumAnalyzer::configure(int order, int overlap) {
+	const int fftSize = 1 << order;
+
+	fft_.reset(new dsp::FFT(order));
+	window_.reset(new dsp::WindowingFunction<float>((size_t) fftSize, dsp::WindowingFunction<float>::hann, true));
+	history_.calloc((size_t) fftSize);
+	fftData_.calloc((size_t) (2 * fftSize));
+	averagePower_.calloc((size_t) (fftSize / 2));
+
+	currentOrder_ = order;
+	currentOverlap_ = overlap;
+}
+
+
+/*
+ * Windows the history, transforms it and folds the magnitudes into the running average,
+ *   then publishes the result and what it cost
+ */
+void SpectrumAnalyzer::analyseFrame() {
+	const int64 startTicks = Time::getHighResolutionTicks();
+
+	const int fftSize = 1 << currentOrder_;
+	const int numBins = fftSize / 2;
+	const double hopSeconds = (double) (fftSize / currentOverlap_) / sampleRate_.load();
+
+	FloatVectorOperations::copy(fftData_, history_, fftSize);
+	window_->multiplyWithWindowingTable(fftData_, (size_t) fftSize);
+	fft_->performFrequencyOnlyForwardTransform(fftData_);
+
+	// The window has a mean of 1, so a full-scale sine's bin comes out at fftSize / 2
+	const float scale = 2.0f / (float) fftSize;
+	const float decay = (float) std::exp(-hopSeconds / averagingSeconds);
+
+	for (int bin = 0; bin < numBins; bin++) {
+		const float magnitude = fftData_[bin] * scale;
+		averagePower_[bin] = decay * averagePower_[bin] + (1.0f - decay) * magnitude * magnitude;
+	}
+
+	publishFrame();
+
+	const float micros = (float) (Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1.0e6);
+	const float load = (float) (100.0 * micros / (1.0e6 * hopSeconds));
+	const float lastMicros = microsPerFrame_.load(std::memory_order_relaxed);
+	const float lastLoad = loadPercent_.load(std::memory_order_relaxed);
+
+	microsPerFrame_.store(lastMicros + costSmoothing * (micros - lastMicros), std::memory_order_relaxed);
+	loadPercent_.store(lastLoad + costSmoothing * (load - lastLoad), std::memory_order_relaxed);
+}
+
+
+/*
+ * Converts the averages to dB as the latest frame
+ */
+void SpectrumAnalyzer::publishFrame() {
+	const int fftSize = 1 << currentOrder_;
+	const int numBins = fftSize / 2;
+
+	const ScopedLock sl(frameLock_);
+
+	latest_.levelsDb.resize(numBins);
+	for (int bin = 0; bin < numBins; bin++)
+		latest_.levelsDb.set(bin, Decibels::gainToDecibels(std::sqrt(averagePower_[bin]), minimumDb));
+
+	latest_.binHz = sampleRate_.load() / fftSize;
+	latest_.number++;
+}
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+  spectrum_analyzer.h -- interface for the player's background spectrum analyzer
+	- The audio thread copies a mono mix of each block into a lock-free FIFO
+	  and never waits; a block that doesn't fit is dropped and counted
+	- A thread of its own runs Hann-windowed FFTs (juce::dsp::FFT) over the
+	  FIFO, with a selectable size (512 to 16384 points) and overlap (1x to 8x)
+	- Magnitudes are averaged over about 100 ms and published as a frame of
+	  dB levels, along with the time each frame took to compute
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    Spectrum analysis off the audio thread. Only does any work while it's
+    active and the audio thread is pushing samples.
+*/
+class SpectrumAnalyzer : private Thread
+{
+public:
+	enum {
+		minFftOrder = 9,		// 512 points
+		maxFftOrder = 14,		// 16384 points
+		maxOverlap = 8
+	};
+
+	// One published spectrum: a level per bin from DC up to (not including) Nyquist
+	struct Frame
+	{
+		Array<float> levelsDb;
+		double binHz = 0.0;
+		int number = 0;			// 0 until the first frame is published
+	};
+
+	SpectrumAnalyzer();
+	~SpectrumAnalyzer();
+
+	// Message thread. The sample rate is that of the audio being pushed; the thread only
+	//   runs while the analyzer is active.
+	void prepare(double sampleRate);
+	void setActive(bool shouldBeActive);
+	bool isActive() const;
+
+	// Audio thread: adds a mono mix of the buffer's channels to the FIFO
+	void pushSamples(const AudioBuffer<float> &buffer, int startSample, int numSamples);
+
+	// Settings (message thread): FFT size as a power of 2, and how many FFTs overlap each
+	//   sample (1, 2, 4 or 8). They're picked up before the next frame.
+	void setFftOrder(int order);
+	int getFftOrder() const;
+	void setOverlap(int overlap);
+	int getOverlap() const;
+
+	// Results (message thread). copyLatestFrame() returns false if the frame passed in is
+	//   already the latest.
+	bool copyLatestFrame(Frame &frame) const;
+	double getMicrosPerFrame() const;
+	double getLoadPercent() const;
+	int getNumDroppedSamples() const;
+
+private:
+	// Redefinition of Thread method
+	void run() override;
+
+	// Private helper functions
+	void configure(int order, int overlap);
+	void analyseFrame();
+	void publishFrame();
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	// Mono samples from the audio thread
+	AbstractFifo fifo_;
+	HeapBlock<float> fifoData_;
+	std::atomic<bool> active_;
+	std::atomic<double> sampleRate_;
+	std::atomic<int> numDropped_;
+
+	// Requested settings
+	std::atomic<int> fftOrder_;
+	std::atomic<int> overlap_;
+
+	// Analysis state (analysis thread only, rebuilt by configure())
+	std::unique_ptr<dsp::FFT> fft_;
+	std::unique_ptr<dsp::WindowingFunction<float>> window_;
+	int currentOrder_;
+	int currentOverlap_;
+	HeapBlock<float> history_;		// the last fftSize samples
+	HeapBlock<float> fftData_;		// 2 * fftSize, as dsp::FFT needs
+	HeapBlock<float> averagePower_;	// fftSize / 2 bins
+
+	// Latest published frame & its cost (smoothed)
+	CriticalSection frameLock_;
+	Frame latest_;
+	std::atomic<float> microsPerFrame_;
+	std::atomic<float> loadPercent_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzer)
+};
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+  spectrum_display.cpp -- implementation of the player's spectrum analyzer view
+
+  ==============================================================================
+*/
+
+#include "spectrum_display.h"
+#include <cmath>
+
+namespace {
+	// Ranges plotted
+	const double minHz = 20.0;
+	const double maxHz = 20000.0;
+	const float minDb = -100.0f;
+	const float maxDb = 0.0f;
+
+	// Marks a pixel column no bin falls in
+	const float emptyColumn = -1000.0f;
+
+	// Height of the settings row under the plot
+	const int controlsHeight = 20;
+}
+
+//==============================================================================
+
+// Constructor
+SpectrumDisplay::SpectrumDisplay(SpectrumAnalyzer &analyzer)
+	: analyzer_(analyzer)
+{
+	// FFT size choices, with the FFT order as the item ID
+	addAndMakeVisible(&sizeBox_);
+	for (int order = SpectrumAnalyzer::minFftOrder; order <= SpectrumAnalyzer::maxFftOrder; order++)
+		sizeBox_.addItem(String(1 << order), order);
+	sizeBox_.setSelectedId(analyzer_.getFftOrder(), dontSendNotification);
+	sizeBox_.setTooltip("FFT size (points)");
+	sizeBox_.onChange = [this] { settingsChanged(); };
+
+	// Overlap choices, with the overlap as the item ID
+	addAndMakeVisible(&overlapBox_);
+	for (int overlap = 1; overlap <= SpectrumAnalyzer::maxOverlap; overlap *= 2)
+		overlapBox_.addItem(String(overlap) + "x", overlap);
+	overlapBox_.setSelectedId(analyzer_.getOverlap(), dontSendNotification);
+	overlapBox_.setTooltip("Overlap between successive FFTs");
+	overlapBox_.onChange = [this] { settingsChanged(); };
+}
+
+
+// Destructor
+SpectrumDisplay::~SpectrumDisplay()
+{
+}
+
+
+/*
+ * Copies the analyzer's latest frame & cost figures, if it has published a new frame
+ */
+void SpectrumDisplay::refresh() {
+	if (!analyzer_.copyLatestFrame(frame_))
+		return;
+
+	costInfo_ = String(analyzer_.getMicrosPerFrame(), 1) + " us/frame ("
+		+ String(analyzer_.getLoadPercent(), 2) + "%)";
+
+	if (analyzer_.getNumDroppedSamples() > 0)
+		costInfo_ << ", " << analyzer_.getNumDroppedSamples() << " dropped";
+
+	repaint();
+}
+
+
+/*
+ * Draws the grid and the spectrum, taking the loudest bin under each pixel column
+ */
+void SpectrumDisplay::paint(Graphics &g) {
+	const auto plot = getPlotArea();
+	const double topHz = jmin(maxHz, frame_.binHz * frame_.levelsDb.size());
+	const double logRange = std::log(maxHz / minHz);
+
+	auto xForHz = [&](double hz) { return plot.getX() + plot.getWidth() * (float) (std::log(hz / minHz) / logRange); };
+	auto yForDb = [&](float db) { return jmap(jlimit(minDb, maxDb, db), minDb, maxDb, plot.getBottom(), plot.getY()); };
+
+	g.setColour(Colours::black.withAlpha(0.3f));
+	g.fillRect(plot);
+
+	// Grid: decades of frequency, every 20 dB
+	g.setColour(Colours::white.withAlpha(0.15f));
+	for (double hz = 100.0; hz < maxHz; hz *= 10.0)
+		g.drawVerticalLine(roundToInt(xForHz(hz)), plot.getY(), plot.getBottom());
+	for (float db = maxDb - 20.0f; db > minDb; db -= 20.0f)
+		g.drawHorizontalLine(roundToInt(yForDb(db)), plot.getX(), plot.getRight());
+
+	g.setFont(10.0f);
+	g.drawText("100", roundToInt(xForHz(100.0)) + 2, (int) plot.getBottom() - 12, 30, 12, Justification::left);
+	g.drawText("1k", roundToInt(xForHz(1000.0)) + 2, (int) plot.getBottom() - 12, 30, 12, Justification::left);
+	g.drawText("10k", roundToInt(xForHz(10000.0)) + 2, (int) plot.getBottom() - 12, 30, 12, Justification::left);
+
+	// Spectrum
+	const int numColumns = (int) plot.getWidth();
+
+	if (frame_.number > 0 && numColumns > 0) {
+		HeapBlock<float> columns((size_t) numColumns);
+		FloatVectorOperations::fill(columns, emptyColumn, numColumns);
+
+		for (int bin = 1; bin < frame_.levelsDb.size(); bin++) {
+			const double hz = bin * frame_.binHz;
+
+			if (hz < minHz)
+				continue;
+			if (hz > topHz)
+				break;
+
+			const int column = jmin(numColumns - 1, (int) (xForHz(hz) - plot.getX()));
+			columns[column] = jmax(columns[column], frame_.levelsDb.getUnchecked(bin));
+		}
+
+		// Columns no bin falls in (at the low end, with small FFTs) are skipped, and the line
+		//   joins their neighbours
+		Path spectrum;
+		for (int column = 0; column < numColumns; column++) {
+			if (columns[column] == emptyColumn)
+				continue;
+
+			const Point<float> point(plot.getX() + column, yForDb(columns[column]));
+			if (spectrum.isEmpty())
+				spectrum.startNewSubPath(point);
+			else
+				spectrum.lineTo(point);
+		}
+
+		g.setColour(Colours::limegreen);
+		g.strokePath(spectrum, PathStrokeType(1.0f));
+	}
+
+	g.setColour(getLookAndFeel().findColour(Label::textColourId));
+	g.setFont(12.0f);
+	g.drawText(costInfo_, sizeBox_.getWidth() + overlapBox_.getWidth() + 10, getHeight() - controlsHeight,
+		getWidth() - (sizeBox_.getWidth() + overlapBox_.getWidth() + 10), controlsHeight, Justification::centredRight);
+}
+
+
+/*
+ * Callback run when the view is resized
+ */
+void SpectrumDisplay::resized() {
+	sizeBox_.setBounds(0, getHeight() - controlsHeight, 75, controlsHeight);
+	overlapBox_.setBounds(80, getHeight() - controlsHeight, 55, controlsHeight);
+}
+
+
+void SpectrumDisplay::settingsChanged() {
+	analyzer_.setFftOrder(sizeBox_.getSelectedId());
+	analyzer_.setOverlap(overlapBox_.getSelectedId());
+}
+
+
+Rectangle<float> SpectrumDisplay::getPlotArea() const {
+	return getLocalBounds().withTrimmedBottom(controlsHeight + 5).toFloat();
+}
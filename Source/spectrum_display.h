@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+  spectrum_display.h -- interface for the player's spectrum analyzer view
+	- Plots the analyzer's latest frame on log frequency & dB scales
+	- Lets the FFT size and overlap be chosen, and shows what each frame costs
+	  to compute
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "spectrum_analyzer.h"
+
+//==============================================================================
+/*
+    View of a SpectrumAnalyzer. Its owner calls refresh() whenever the display
+    is updated, so it has no timer of its own.
+*/
+class SpectrumDisplay : public Component
+{
+public:
+	explicit SpectrumDisplay(SpectrumAnalyzer &analyzer);
+	~SpectrumDisplay();
+
+	// Picks up the analyzer's latest frame, repainting if there's a new one
+	void refresh();
+
+	void paint(Graphics &g) override;
+	void resized() override;
+
+private:
+	// Private helper functions
+	void settingsChanged();
+	Rectangle<float> getPlotArea() const;
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	SpectrumAnalyzer &analyzer_;
+	SpectrumAnalyzer::Frame frame_;
+	String costInfo_;
+
+	ComboBox sizeBox_;
+	ComboBox overlapBox_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumDisplay)
+};
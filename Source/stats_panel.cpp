@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+  stats_panel.cpp -- implementation of the player's audio thread statistics panel
+
+  ==============================================================================
+*/
+
+#include "stats_panel.h"
+
+namespace {
+	const int refreshIntervalMs = 200;
+	const int lineHeight = 16;
+
+	// Effects listed (the ones taking the most of the deadline)
+	const int maxEffectLines = 4;
+}
+
+//==============================================================================
+
+// Constructor
+StatsPanel::StatsPanel(PlaybackEngine &engine, AudioDeviceManager &deviceManager)
+	: engine_(engine),
+	  deviceManager_(deviceManager),
+	  deviceXRuns_(-1),
+	  bufferUnderruns_(0),
+	  refreshing_(false)
+{
+	// Add reset button, which clears the worst-case figures & counters
+	addAndMakeVisible(&resetButton_);
+	resetButton_.setButtonText("Reset");
+	resetButton_.onClick = [this] {
+		engine_.getStats().reset();
+		engine_.getEffects().resetTimings();
+		timerCallback();
+	};
+
+	// Add the log toggle button
+	addAndMakeVisible(&logToggleButton_);
+	logToggleButton_.setButtonText("Log to file");
+	logToggleButton_.onClick = [this] { logButtonChanged(); };
+
+	timerCallback();
+}
+
+
+// Destructor
+StatsPanel::~StatsPanel()
+{
+	stopTimer();
+}
+
+
+/*
+ * Draws the latest figures, one line each
+ */
+void StatsPanel::paint(Graphics &g) {
+	g.setColour(getLookAndFeel().findColour(Label::textColourId));
+	g.setFont(Font(Font::getDefaultMonospacedFontName(), 12.0f, Font::plain));
+
+	for (int line = 0; line < lines_.size(); line++)
+		g.drawText(lines_[line], 0, line * lineHeight, getWidth() - 90, lineHeight, Justification::centredLeft);
+}
+
+
+/*
+ * Callback run when the panel is resized
+ */
+void StatsPanel::resized() {
+	resetButton_.setBounds(getWidth() - 80, 0, 80, 20);
+	logToggleButton_.setBounds(getWidth() - 80, 25, 80, 20);
+}
+
+
+/*
+ * Starts or stops polling, reading the figures one last time when it stops
+ */
+void StatsPanel::setRefreshing(bool shouldRefresh) {
+	if (refreshing_ == shouldRefresh)
+		return;
+
+	refreshing_ = shouldRefresh;
+	updatePolling();
+
+	if (!refreshing_)
+		timerCallback();
+}
+
+
+/*
+ * Reads the published figures, repaints if any have changed, and appends them to the log if
+ *   it's open
+ */
+void StatsPanel::timerCallback() {
+	snapshot_ = engine_.getStats().getSnapshot();
+	bufferUnderruns_ = engine_.getBufferUnderruns();
+	blockCacheStats_ = engine_.getBlockCacheStats();
+
+	auto &resampler = engine_.getResampler();
+	if (resampler.isBypassed())
+		resamplerInfo_ = "Resampler: off (file plays at " + String(resampler.getOutputSampleRate() / 1000.0, 1) + " kHz)";
+	else
+		resamplerInfo_ = "Resampler: " + PolyphaseResampler::getQualityName(resampler.getQuality()) + ", "
+			+ String(resampler.getInputSampleRate() / 1000.0, 1) + " -> " + String(resampler.getOutputSampleRate() / 1000.0, 1)
+			+ " kHz, " + String(resampler.getMicrosPerBlock(), 1) + " us (" + String(resampler.getLoadPercent(), 2) + "%)";
+
+	struct HeaviestFirst
+	{
+		static int compareElements(const EffectRack::Timing &a, const EffectRack::Timing &b) {
+			return a.loadPercent > b.loadPercent ? -1 : (a.loadPercent < b.loadPercent ? 1 : 0);
+		}
+	} heaviestFirst;
+
+	effectTimings_ = engine_.getEffects().getTimings();
+	effectTimings_.sort(heaviestFirst, true);
+
+	auto *device = deviceManager_.getCurrentAudioDevice();
+	deviceXRuns_ = device != nullptr ? device->getXRunCount() : -1;
+
+	auto lines = getLines();
+	if (lines != lines_) {
+		lines_.swapWith(lines);
+		repaint();
+	}
+
+	if (logger_ != nullptr)
+		logger_->logMessage(Time::getCurrentTime().toString(false, true, true, true) + " | "
+			+ lines_.joinIntoString(" | "));
+}
+
+
+/*
+ * Opens or closes the log file (a new date-stamped file in the app's log directory)
+ */
+void StatsPanel::logButtonChanged() {
+	if (logToggleButton_.getToggleState()) {
+		logger_.reset(FileLogger::createDateStampedLogger("SoundFilePlayer", "audio_stats_", ".log",
+			"Sound File Player audio thread statistics"));
+		logToggleButton_.setTooltip(logger_->getLogFile().getFullPathName());
+	}
+	else {
+		logger_.reset();
+		logToggleButton_.setTooltip({});
+	}
+
+	updatePolling();
+}
+
+
+/*
+ * Polls while refreshing or logging (a log keeps its regular entries while playback is
+ *   stopped)
+ */
+void StatsPanel::updatePolling() {
+	if (refreshing_ || logger_ != nullptr) {
+		if (!isTimerRunning())
+			startTimer(refreshIntervalMs);
+	}
+	else {
+		stopTimer();
+	}
+}
+
+
+/*
+ * Formats the current figures as lines of text
+ */
+StringArray StatsPanel::getLines() const {
+	StringArray lines;
+
+	lines.add("Load: " + String(snapshot_.loadPercent, 1) + "% of deadline (worst "
+		+ String(snapshot_.worstLoadPercent, 1) + "%)");
+
+	for (int stage = 0; stage < AudioThreadStats::NumStages; stage++)
+		lines.add(AudioThreadStats::getStageName((AudioThreadStats::Stage) stage) + ": "
+			+ String(snapshot_.lastMicros[stage], 1) + " us (worst " + String(snapshot_.worstMicros[stage], 1) + " us)");
+
+	lines.add("Worst callback: " + String(snapshot_.worstCallbackMicros, 1) + " us");
+	lines.add("Overruns: " + String(snapshot_.numOverruns)
+		+ "   Missed deadlines: " + String(snapshot_.numMissedDeadlines));
+	lines.add("Device xruns: " + (deviceXRuns_ >= 0 ? String(deviceXRuns_) : String("n/a"))
+		+ "   Read-ahead underruns: " + String(bufferUnderruns_));
+
+	lines.add("Block cache: " + String(blockCacheStats_.hits) + " hits, " + String(blockCacheStats_.misses)
+		+ " misses (" + String(100.0 * blockCacheStats_.getHitRate(), 1) + "%), "
+		+ String(blockCacheStats_.prefetches) + " prefetched, "
+		+ File::descriptionOfSizeInBytes((int64) blockCacheStats_.bytesUsed) + " / "
+		+ File::descriptionOfSizeInBytes((int64) blockCacheStats_.budgetBytes));
+	lines.add(resamplerInfo_);
+
+	for (int index = 0; index < jmin(maxEffectLines, effectTimings_.size()); index++) {
+		const auto &timing = effectTimings_.getReference(index);
+		lines.add("Branch " + String(timing.branch + 1) + ", " + timing.name + ": " + String(timing.lastMicros, 1) + " us, "
+			+ String(timing.loadPercent, 2) + "% (worst " + String(timing.worstMicros, 1) + " us)");
+	}
+
+	return lines;
+}
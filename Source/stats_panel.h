@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+  stats_panel.h -- interface for the player's audio thread statistics panel
+	- Shows callback load, per-stage & worst-case times, overruns, missed
+	  deadlines, device xruns, read-ahead underruns, block cache hit rates, the
+	  resampler's cost and the heaviest effects in the effect rack
+	- Can append the same figures to a log file
+	- Only polls while the player asks it to (while playing) or while logging,
+	  and only repaints when a figure has changed
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "playback_engine.h"
+
+//==============================================================================
+/*
+    Panel that polls the engine's AudioThreadStats a few times a second
+    while refreshing is on.
+*/
+class StatsPanel : public Component,
+                   private Timer
+{
+public:
+	StatsPanel(PlaybackEngine &engine, AudioDeviceManager &deviceManager);
+	~StatsPanel();
+
+	void paint(Graphics &g) override;
+	void resized() override;
+
+	// Starts or stops polling (message thread); the figures are read once more on stopping,
+	//   so the panel shows where they ended up
+	void setRefreshing(bool shouldRefresh);
+
+private:
+	// Private helper functions
+	void timerCallback() override;
+	void logButtonChanged();
+	void updatePolling();
+	StringArray getLines() const;
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	PlaybackEngine &engine_;
+	AudioDeviceManager &deviceManager_;
+
+	AudioThreadStats::Snapshot snapshot_;
+	int deviceXRuns_;
+	int bufferUnderruns_;
+	BlockCacheReader::Stats blockCacheStats_;
+	String resamplerInfo_;
+	Array<EffectRack::Timing> effectTimings_;		// heaviest first
+	StringArray lines_;								// as last painted
+	bool refreshing_;
+
+	TextButton resetButton_;
+	ToggleButton logToggleButton_;
+	std::unique_ptr<FileLogger> logger_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StatsPanel)
+};
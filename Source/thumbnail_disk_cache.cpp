@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+  thumbnail_disk_cache.cpp -- implementation of the on-disk waveform overview cache
+
+  ==============================================================================
+*/
+
+#include "thumbnail_disk_cache.h"
+
+//==============================================================================
+
+// Constructor
+ThumbnailDiskCache::ThumbnailDiskCache(int maxThumbsInMemory, const File &directory)
+	: AudioThumbnailCache(maxThumbsInMemory),
+	  directory_(directory)
+{
+	directory_.createDirectory();
+}
+
+
+File ThumbnailDiskCache::getDefaultDirectory() {
+	return File::getSpecialLocation(File::userApplicationDataDirectory)
+		.getChildFile("SoundFilePlayer")
+		.getChildFile("Thumbnails");
+}
+
+
+const File &ThumbnailDiskCache::getDirectory() const {
+	return directory_;
+}
+
+
+/*
+ * Called when a thumbnail isn't in the memory cache: loads it from disk if it was saved
+ *   before. Returns false (so the file gets scanned) if there's no usable saved copy.
+ */
+bool ThumbnailDiskCache::loadNewThumb(AudioThumbnailBase &thumb, int64 hashCode) {
+	File file = getFileForHash(hashCode);
+
+	if (!file.existsAsFile())
+		return false;
+
+	FileInputStream input(file);
+	if (input.openedOk() && thumb.loadFrom(input))
+		return true;
+
+	// Unreadable (e.g. truncated) - drop it so it gets rebuilt
+	file.deleteFile();
+	return false;
+}
+
+
+/*
+ * Called on the thumbnail thread once a file has been fully scanned. The data is written
+ *   to a temporary file first, so a crash can't leave a half-written thumbnail behind.
+ */
+void ThumbnailDiskCache::saveNewlyFinishedThumbnail(const AudioThumbnailBase &thumb, int64 hashCode) {
+	TemporaryFile temp(getFileForHash(hashCode));
+
+	{
+		FileOutputStream output(temp.getFile());
+		if (output.failedToOpen())
+			return;
+
+		thumb.saveTo(output);
+	}
+
+	temp.overwriteTargetFileWithTemporary();
+}
+
+
+File ThumbnailDiskCache::getFileForHash(int64 hashCode) const {
+	return directory_.getChildFile(String::toHexString(hashCode) + ".thumb");
+}
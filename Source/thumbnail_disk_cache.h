@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+  thumbnail_disk_cache.h -- interface for the on-disk waveform overview cache
+	- An AudioThumbnailCache that also saves every finished overview to disk,
+	  keyed by the source's hash (which covers the file & its modification time)
+	- Reopening a file loads its overview from disk instead of rescanning it
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    AudioThumbnailCache backed by a directory of saved thumbnails.
+*/
+class ThumbnailDiskCache : public AudioThumbnailCache
+{
+public:
+	ThumbnailDiskCache(int maxThumbsInMemory, const File &directory);
+
+	// Default location: <app data>/SoundFilePlayer/Thumbnails
+	static File getDefaultDirectory();
+
+	const File &getDirectory() const;
+
+protected:
+	// Redefinitions of AudioThumbnailCache methods
+	bool loadNewThumb(AudioThumbnailBase &thumb, int64 hashCode) override;
+	void saveNewlyFinishedThumbnail(const AudioThumbnailBase &thumb, int64 hashCode) override;
+
+private:
+	// Private helper functions
+	File getFileForHash(int64 hashCode) const;
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	File directory_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailDiskCache)
+};
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+  transport_command_queue.cpp -- implementation of the player's transport command queue
+
+  ==============================================================================
+*/
+
+#include "transport_command_queue.h"
+
+//==============================================================================
+
+// Constructor
+TransportCommandQueue::TransportCommandQueue()
+	: fifo_(capacity)
+{
+}
+
+
+// Destructor
+TransportCommandQueue::~TransportCommandQueue()
+{
+}
+
+
+bool TransportCommandQueue::push(const Command &command) {
+	int start1, size1, start2, size2;
+	fifo_.prepareToWrite(1, start1, size1, start2, size2);
+
+	if (size1 + size2 < 1)
+		return false;
+
+	commands_[size1 > 0 ? start1 : start2] = command;
+	fifo_.finishedWrite(1);
+	return true;
+}
+
+
+bool TransportCommandQueue::pop(Command &command) {
+	int start1, size1, start2, size2;
+	fifo_.prepareToRead(1, start1, size1, start2, size2);
+
+	if (size1 + size2 < 1)
+		return false;
+
+	command = commands_[size1 > 0 ? start1 : start2];
+	fifo_.finishedRead(1);
+	return true;
+}
+
+
+int TransportCommandQueue::getNumPending() const {
+	return fifo_.getNumReady();
+}
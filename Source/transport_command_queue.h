@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+  transport_command_queue.h -- interface for the player's transport command queue
+	- A fixed-size, lock-free FIFO of transport commands (start, stop, seek)
+	  from the message thread to the audio thread
+	- Commands are applied at the start of an audio block, so the message
+	  thread never takes a lock the audio thread holds
+	- Single producer, single consumer: nothing is allocated once it's built
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Wait-free queue of transport commands, built on AbstractFifo.
+*/
+class TransportCommandQueue
+{
+public:
+	struct Command
+	{
+		enum Type {
+			Start = 0,
+			Stop,
+			Seek
+		};
+
+		Type type;
+		double seconds;		// Seek only
+		bool fadeIn = true;	// Start only
+	};
+
+	enum { capacity = 64 };
+
+	TransportCommandQueue();
+	~TransportCommandQueue();
+
+	// Producer (message thread): returns false if the queue is full
+	bool push(const Command &command);
+
+	// Consumer (audio thread): returns false if the queue is empty
+	bool pop(Command &command);
+
+	int getNumPending() const;
+
+private:
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	AbstractFifo fifo_;
+	Command commands_[capacity];
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportCommandQueue)
+};
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+  waveform_slider.cpp -- implementation of the progress slider's waveform overview
+
+  ==============================================================================
+*/
+
+#include "waveform_slider.h"
+
+namespace {
+	// Source samples per overview point
+	const int samplesPerThumbSample = 1024;
+}
+
+//==============================================================================
+
+// Constructor
+WaveformSlider::WaveformSlider(AudioFormatManager &formatManager, AudioThumbnailCache &cache)
+	: thumbnail_(samplesPerThumbSample, formatManager, cache)
+{
+	thumbnail_.addChangeListener(this);
+}
+
+
+// Destructor
+WaveformSlider::~WaveformSlider()
+{
+	thumbnail_.removeChangeListener(this);
+}
+
+
+/*
+ * Points the overview at a new file. If the cache already has it (in memory or on disk)
+ *   it appears straight away; otherwise it's scanned in the background.
+ */
+void WaveformSlider::setFile(const File &file) {
+	file_ = file;
+	thumbnail_.setSource(new FileInputSource(file));
+	repaint();
+}
+
+
+void WaveformSlider::clearWaveform() {
+	file_ = File();
+	thumbnail_.clear();
+	repaint();
+}
+
+
+/*
+ * Returns the file whose overview is shown (or a default File if there isn't one)
+ */
+const File &WaveformSlider::getFile() const {
+	return file_;
+}
+
+
+void WaveformSlider::setLoopRegion(Range<double> proportions) {
+	if (proportions != loopRegion_) {
+		loopRegion_ = proportions;
+		repaint();
+	}
+}
+
+
+/*
+ * Draws the overview behind the slider's track, up to the point that's been scanned so far
+ */
+void WaveformSlider::paint(Graphics &g) {
+	auto area = getLocalBounds().withTrimmedLeft(getTextBoxWidth()).reduced(2);
+	const double length = thumbnail_.getTotalLength();
+
+	if (thumbnail_.getNumChannels() > 0 && length > 0.0 && !area.isEmpty()) {
+		auto colour = findColour(Slider::trackColourId);
+		g.setColour(colour.withAlpha(isEnabled() ? 0.45f : 0.2f));
+
+		// Parts that haven't been scanned yet come out flat, so the overview fills in
+		//   from left to right as the background thread works through the file
+		thumbnail_.drawChannels(g, area, 0.0, length, 1.0f);
+	}
+
+	if (!loopRegion_.isEmpty() && !area.isEmpty()) {
+		const float left = area.getX() + (float) loopRegion_.getStart() * area.getWidth();
+		const float right = area.getX() + (float) loopRegion_.getEnd() * area.getWidth();
+
+		g.setColour(findColour(Slider::thumbColourId).withAlpha(0.2f));
+		g.fillRect(left, (float) area.getY(), right - left, (float) area.getHeight());
+	}
+
+	Slider::paint(g);
+}
+
+
+void WaveformSlider::changeListenerCallback(ChangeBroadcaster *) {
+	repaint();
+}
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+  waveform_slider.h -- interface for the progress slider's waveform overview
+	- A Slider that draws an AudioThumbnail of the loaded file behind its track
+	- The overview is built on the thumbnail cache's background thread and is
+	  redrawn as each part of the file is scanned
+	- Highlights the loop region, if one is set
+
+  ==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Progress slider with a waveform overview of the current file.
+*/
+class WaveformSlider : public Slider,
+                       private ChangeListener
+{
+public:
+	WaveformSlider(AudioFormatManager &formatManager, AudioThumbnailCache &cache);
+	~WaveformSlider();
+
+	// Starts building (or loading from the cache) the overview of a file
+	void setFile(const File &file);
+	void clearWaveform();
+	const File &getFile() const;
+
+	// Highlights part of the overview, as proportions of the file's length (an empty range
+	//   removes the highlight)
+	void setLoopRegion(Range<double> proportions);
+
+	void paint(Graphics &g) override;
+
+private:
+	// Repaints as the thumbnail is filled in
+	void changeListenerCallback(ChangeBroadcaster *source) override;
+
+	// ===== PRIVATE MEMBER VARIABLES =====
+
+	AudioThumbnail thumbnail_;
+	File file_;
+	Range<double> loopRegion_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformSlider)
+};